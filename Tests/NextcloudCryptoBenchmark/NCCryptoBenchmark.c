@@ -0,0 +1,598 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Headless benchmark of the primitives behind NCEndToEndEncryption, with plain OpenSSL.
+// The file cipher is the same NCEndToEndFileCipher.c compiled into the app; the other
+// operations repeat the OpenSSL call sequences of NCEndToEndEncryption.m (CommonCrypto
+// PBKDF2 is replaced by PKCS5_PBKDF2_HMAC, same parameters).
+//
+// usage: nc-crypto-benchmark [--quick] [--directory <tmp dir>] [--output <file.json>]
+//
+// Every result is the best and the mean time per operation over `iterations` runs.
+// Exit status is 1 when a primitive fails or a round trip does not give back the input.
+
+#include "NCEndToEndFileCipher.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+
+#include <openssl/cms.h>
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rand.h>
+#include <openssl/rsa.h>
+#include <openssl/x509.h>
+
+#define MIB                     (1024 * 1024)
+#define MAX_RESULTS             128
+#define PBKDF2_ITERATIONS       600000
+#define PBKDF2_ITERATIONS_OLD   1024
+
+typedef struct {
+    char name[48];
+    char params[160];           // JSON object body
+    int iterations;
+    double best;                // seconds per operation
+    double mean;
+    uint64_t bytes;             // bytes processed per operation (0 = not a throughput test)
+} bench_result;
+
+static bench_result results[MAX_RESULTS];
+static int resultCount = 0;
+static int failures = 0;
+
+// MARK: - Helpers
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void fail(const char *what)
+{
+    fprintf(stderr, "FAILED: %s\n", what);
+    ERR_print_errors_fp(stderr);
+    failures++;
+}
+
+static bench_result *begin_result(const char *name, int iterations, uint64_t bytes, const char *format, ...)
+    __attribute__((format(printf, 4, 5)));
+
+static bench_result *begin_result(const char *name, int iterations, uint64_t bytes, const char *format, ...)
+{
+    if (resultCount == MAX_RESULTS) return NULL;
+    bench_result *result = &results[resultCount++];
+    memset(result, 0, sizeof(*result));
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    va_list args;
+    va_start(args, format);
+    vsnprintf(result->params, sizeof(result->params), format, args);
+    va_end(args);
+    result->iterations = iterations;
+    result->bytes = bytes;
+    result->best = -1;
+    return result;
+}
+
+static void add_sample(bench_result *result, double seconds)
+{
+    if (!result) return;
+    if (result->best < 0 || seconds < result->best) result->best = seconds;
+    result->mean += seconds / result->iterations;
+}
+
+static int write_random_file(const char *path, uint64_t size)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file) return 0;
+    unsigned char *buffer = malloc(MIB);
+    int success = buffer != NULL;
+    for (uint64_t written = 0; success && written < size; written += MIB) {
+        size_t length = size - written < MIB ? (size_t)(size - written) : MIB;
+        success = RAND_bytes(buffer, (int)length) == 1 && fwrite(buffer, 1, length, file) == length;
+    }
+    free(buffer);
+    if (fclose(file) != 0) success = 0;
+    return success;
+}
+
+static int same_file(const char *path1, const char *path2)
+{
+    nc_e2ee_digest digest1, digest2;
+    if (!nc_e2ee_file_digest(path1, NC_E2EE_DIGEST_SHA256, 0, &digest1)) return 0;
+    if (!nc_e2ee_file_digest(path2, NC_E2EE_DIGEST_SHA256, 0, &digest2)) return 0;
+    return digest1.bytes == digest2.bytes && memcmp(digest1.sha256, digest2.sha256, sizeof(digest1.sha256)) == 0;
+}
+
+static EVP_PKEY *generate_rsa_key(void)
+{
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
+    EVP_PKEY *pkey = NULL;
+    if (ctx && EVP_PKEY_keygen_init(ctx) > 0 && EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, 2048) > 0) {
+        EVP_PKEY_keygen(ctx, &pkey);
+    }
+    EVP_PKEY_CTX_free(ctx);
+    return pkey;
+}
+
+// Same certificate as generateCertificateX509WithUserId:
+static X509 *create_certificate(EVP_PKEY *pkey, const char *userId)
+{
+    X509 *x509 = X509_new();
+    if (!x509) return NULL;
+
+    ASN1_INTEGER_set(X509_get_serialNumber(x509), 1);
+    X509_gmtime_adj(X509_getm_notBefore(x509), 0);
+    X509_gmtime_adj(X509_getm_notAfter(x509), 60L * 60 * 24 * 365 * 10);
+    X509_set_pubkey(x509, pkey);
+
+    X509_NAME *name = X509_get_subject_name(x509);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *)userId, -1, -1, 0);
+    X509_NAME_add_entry_by_txt(name, "O", MBSTRING_ASC, (const unsigned char *)"Nextcloud", -1, -1, 0);
+    X509_NAME_add_entry_by_txt(name, "L", MBSTRING_ASC, (const unsigned char *)"Stuttgart", -1, -1, 0);
+    X509_NAME_add_entry_by_txt(name, "ST", MBSTRING_ASC, (const unsigned char *)"Baden-Wuerttemberg", -1, -1, 0);
+    X509_NAME_add_entry_by_txt(name, "C", MBSTRING_ASC, (const unsigned char *)"DE", -1, -1, 0);
+    X509_set_issuer_name(x509, name);
+
+    if (X509_sign(x509, pkey, EVP_sha256()) <= 0) {
+        X509_free(x509);
+        return NULL;
+    }
+    return x509;
+}
+
+static char *pem_private_key(EVP_PKEY *pkey)
+{
+    BIO *bio = BIO_new(BIO_s_mem());
+    char *pem = NULL;
+    if (bio && PEM_write_bio_PKCS8PrivateKey(bio, pkey, NULL, NULL, 0, NULL, NULL) == 1) {
+        int length = BIO_pending(bio);
+        pem = calloc(1, (size_t)length + 1);
+        if (pem) BIO_read(bio, pem, length);
+    }
+    BIO_free(bio);
+    return pem;
+}
+
+// MARK: - AES-GCM files
+
+static void bench_file(const char *directory, uint64_t fileSize, size_t blockSize, int iterations)
+{
+    char plain[1024], cipher[1024], decrypted[1024];
+    snprintf(plain, sizeof(plain), "%s/nc-bench-plain", directory);
+    snprintf(cipher, sizeof(cipher), "%s/nc-bench-cipher", directory);
+    snprintf(decrypted, sizeof(decrypted), "%s/nc-bench-decrypted", directory);
+
+    unsigned char key[16], iv[12], tag[NC_E2EE_FILE_TAG_LENGTH];
+    RAND_bytes(key, sizeof(key));
+    RAND_bytes(iv, sizeof(iv));
+
+    if (!write_random_file(plain, fileSize)) {
+        fail("write plaintext file");
+        return;
+    }
+
+    bench_result *encrypt = begin_result("gcm_file_encrypt", iterations, fileSize, "\"fileSize\": %llu, \"blockSize\": %zu", (unsigned long long)fileSize, blockSize);
+    for (int i = 0; i < iterations; i++) {
+        double start = now();
+        if (!nc_e2ee_file_encrypt(plain, cipher, key, sizeof(key), iv, sizeof(iv), tag, blockSize, NULL)) {
+            fail("gcm_file_encrypt");
+            break;
+        }
+        add_sample(encrypt, now() - start);
+    }
+
+    bench_result *decrypt = begin_result("gcm_file_decrypt", iterations, fileSize, "\"fileSize\": %llu, \"blockSize\": %zu", (unsigned long long)fileSize, blockSize);
+    for (int i = 0; i < iterations; i++) {
+        double start = now();
+        if (!nc_e2ee_file_decrypt(cipher, decrypted, key, sizeof(key), iv, sizeof(iv), tag, sizeof(tag), blockSize, NULL)) {
+            fail("gcm_file_decrypt");
+            break;
+        }
+        add_sample(decrypt, now() - start);
+    }
+    if (!same_file(plain, decrypted)) fail("gcm_file round trip");
+
+    bench_result *digest = begin_result("file_digest_sha256_sha512", iterations, fileSize, "\"fileSize\": %llu, \"blockSize\": %zu", (unsigned long long)fileSize, blockSize);
+    for (int i = 0; i < iterations; i++) {
+        nc_e2ee_digest fileDigest;
+        double start = now();
+        if (!nc_e2ee_file_digest(plain, NC_E2EE_DIGEST_SHA256 | NC_E2EE_DIGEST_SHA512, blockSize, &fileDigest)) {
+            fail("file_digest");
+            break;
+        }
+        add_sample(digest, now() - start);
+    }
+
+    unlink(plain);
+    unlink(cipher);
+    unlink(decrypted);
+}
+
+// Chunks of `chunkSize` bytes, the tag in the last one: their concatenation is the single file ciphertext
+static void bench_file_chunks(const char *directory, uint64_t fileSize, uint64_t chunkSize, size_t blockSize, int iterations)
+{
+    char plain[1024], cipher[1024], joined[1024], chunks[1024], path[1100];
+    snprintf(plain, sizeof(plain), "%s/nc-bench-chunks-plain", directory);
+    snprintf(cipher, sizeof(cipher), "%s/nc-bench-chunks-cipher", directory);
+    snprintf(joined, sizeof(joined), "%s/nc-bench-chunks-joined", directory);
+    snprintf(chunks, sizeof(chunks), "%s/nc-bench-chunks", directory);
+
+    unsigned char key[16], iv[12], tag[NC_E2EE_FILE_TAG_LENGTH], chunksTag[NC_E2EE_FILE_TAG_LENGTH];
+    RAND_bytes(key, sizeof(key));
+    RAND_bytes(iv, sizeof(iv));
+
+    size_t maxChunks = (size_t)((fileSize + NC_E2EE_FILE_TAG_LENGTH) / chunkSize + 2);
+    uint64_t *chunkSizes = calloc(maxChunks, sizeof(uint64_t));
+    size_t chunkCount = 0;
+    if (!chunkSizes || !write_random_file(plain, fileSize) || (mkdir(chunks, 0700) != 0 && access(chunks, W_OK) != 0)) {
+        fail("write chunks plaintext file");
+        free(chunkSizes);
+        return;
+    }
+
+    bench_result *result = begin_result("gcm_file_encrypt_chunks", iterations, fileSize, "\"fileSize\": %llu, \"chunkSize\": %llu, \"blockSize\": %zu", (unsigned long long)fileSize, (unsigned long long)chunkSize, blockSize);
+    for (int i = 0; i < iterations; i++) {
+        double start = now();
+        if (!nc_e2ee_file_encrypt_chunks(plain, chunks, chunkSize, key, sizeof(key), iv, sizeof(iv), chunksTag, blockSize, chunkSizes, maxChunks, &chunkCount, NULL)) {
+            fail("gcm_file_encrypt_chunks");
+            break;
+        }
+        add_sample(result, now() - start);
+    }
+
+    // Every chunk is full but the last one, which ends with the tag
+    int sizesMatch = chunkCount > 0;
+    uint64_t total = 0;
+    for (size_t i = 0; i < chunkCount; i++) {
+        if (i + 1 < chunkCount ? chunkSizes[i] != chunkSize : chunkSizes[i] > chunkSize + NC_E2EE_FILE_TAG_LENGTH) sizesMatch = 0;
+        total += chunkSizes[i];
+    }
+    if (!sizesMatch || total != fileSize + NC_E2EE_FILE_TAG_LENGTH) fail("gcm_file_encrypt_chunks sizes");
+
+    FILE *out = fopen(joined, "wb");
+    unsigned char *buffer = malloc(MIB);
+    int copied = out != NULL && buffer != NULL;
+    for (size_t i = 1; copied && i <= chunkCount; i++) {
+        snprintf(path, sizeof(path), "%s/%zu", chunks, i);
+        FILE *in = fopen(path, "rb");
+        if (!in) {
+            copied = 0;
+            break;
+        }
+        size_t length;
+        while ((length = fread(buffer, 1, MIB, in)) > 0) {
+            if (fwrite(buffer, 1, length, out) != length) copied = 0;
+        }
+        fclose(in);
+        unlink(path);
+    }
+    if (out && fclose(out) != 0) copied = 0;
+    free(buffer);
+
+    if (!nc_e2ee_file_encrypt(plain, cipher, key, sizeof(key), iv, sizeof(iv), tag, blockSize, NULL)) {
+        fail("gcm_file_encrypt");
+    } else if (!copied || !same_file(cipher, joined) || memcmp(tag, chunksTag, sizeof(tag)) != 0) {
+        fail("gcm_file_encrypt_chunks same as single file");
+    }
+
+    unlink(plain);
+    unlink(cipher);
+    unlink(joined);
+    rmdir(chunks);
+    free(chunkSizes);
+}
+
+static void bench_file_batch(const char *directory, int files, uint64_t fileSize, int iterations)
+{
+    nc_e2ee_file_job *jobs = calloc((size_t)files, sizeof(nc_e2ee_file_job));
+    char (*paths)[2][1024] = calloc((size_t)files, sizeof(*paths));
+    unsigned char key[16], iv[12];
+    RAND_bytes(key, sizeof(key));
+    RAND_bytes(iv, sizeof(iv));
+    if (!jobs || !paths) {
+        fail("batch allocation");
+        free(jobs);
+        free(paths);
+        return;
+    }
+
+    for (int i = 0; i < files; i++) {
+        snprintf(paths[i][0], sizeof(paths[i][0]), "%s/nc-bench-batch-%d", directory, i);
+        snprintf(paths[i][1], sizeof(paths[i][1]), "%s/nc-bench-batch-%d.cipher", directory, i);
+        if (!write_random_file(paths[i][0], fileSize)) fail("write batch file");
+    }
+
+    bench_result *result = begin_result("gcm_file_batch_encrypt", iterations, fileSize * (uint64_t)files, "\"files\": %d, \"fileSize\": %llu, \"workers\": 0", files, (unsigned long long)fileSize);
+    for (int n = 0; n < iterations; n++) {
+        for (int i = 0; i < files; i++) {
+            memset(&jobs[i], 0, sizeof(jobs[i]));
+            jobs[i].operation = NC_E2EE_FILE_ENCRYPT;
+            jobs[i].source = paths[i][0];
+            jobs[i].destination = paths[i][1];
+            jobs[i].key = key;
+            jobs[i].keyLen = sizeof(key);
+            jobs[i].iv = iv;
+            jobs[i].ivLen = sizeof(iv);
+        }
+        double start = now();
+        if (nc_e2ee_file_batch(jobs, (size_t)files, 0, 0) != (size_t)files) {
+            fail("gcm_file_batch_encrypt");
+            break;
+        }
+        add_sample(result, now() - start);
+    }
+
+    for (int i = 0; i < files; i++) {
+        unlink(paths[i][0]);
+        unlink(paths[i][1]);
+    }
+    free(jobs);
+    free(paths);
+}
+
+// MARK: - RSA-OAEP
+
+// Same parameters as asymmetricData:key:encrypt: (OAEP, SHA-256, MGF1 SHA-256)
+static int rsa_oaep(EVP_PKEY *pkey, int encrypt, const unsigned char *in, size_t inLength, unsigned char *out, size_t *outLength)
+{
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(pkey, NULL);
+    int success = ctx
+        && (encrypt ? EVP_PKEY_encrypt_init(ctx) : EVP_PKEY_decrypt_init(ctx)) > 0
+        && EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_OAEP_PADDING) > 0
+        && EVP_PKEY_CTX_set_rsa_oaep_md(ctx, EVP_sha256()) > 0
+        && EVP_PKEY_CTX_set_rsa_mgf1_md(ctx, EVP_sha256()) > 0
+        && (encrypt ? EVP_PKEY_encrypt(ctx, out, outLength, in, inLength) : EVP_PKEY_decrypt(ctx, out, outLength, in, inLength)) > 0;
+    EVP_PKEY_CTX_free(ctx);
+    return success;
+}
+
+static void bench_rsa(EVP_PKEY *pkey, const char *privateKeyPEM, int iterations)
+{
+    unsigned char metadataKey[16], wrapped[512], unwrapped[512];
+    size_t wrappedLength = sizeof(wrapped), unwrappedLength = sizeof(unwrapped);
+    RAND_bytes(metadataKey, sizeof(metadataKey));
+
+    bench_result *wrap = begin_result("rsa_oaep_wrap", iterations, 0, "\"bits\": 2048, \"keyLength\": 16");
+    for (int i = 0; i < iterations; i++) {
+        wrappedLength = sizeof(wrapped);
+        double start = now();
+        if (!rsa_oaep(pkey, 1, metadataKey, sizeof(metadataKey), wrapped, &wrappedLength)) {
+            fail("rsa_oaep_wrap");
+            return;
+        }
+        add_sample(wrap, now() - start);
+    }
+
+    bench_result *unwrap = begin_result("rsa_oaep_unwrap", iterations, 0, "\"bits\": 2048, \"parsedKey\": true");
+    for (int i = 0; i < iterations; i++) {
+        unwrappedLength = sizeof(unwrapped);
+        double start = now();
+        if (!rsa_oaep(pkey, 0, wrapped, wrappedLength, unwrapped, &unwrappedLength)) {
+            fail("rsa_oaep_unwrap");
+            return;
+        }
+        add_sample(unwrap, now() - start);
+    }
+    if (unwrappedLength != sizeof(metadataKey) || memcmp(unwrapped, metadataKey, sizeof(metadataKey)) != 0) fail("rsa_oaep round trip");
+
+    // What every call paid before the parsed key cache
+    bench_result *unwrapPEM = begin_result("rsa_oaep_unwrap", iterations, 0, "\"bits\": 2048, \"parsedKey\": false");
+    for (int i = 0; i < iterations; i++) {
+        unwrappedLength = sizeof(unwrapped);
+        double start = now();
+        BIO *bio = BIO_new_mem_buf(privateKeyPEM, -1);
+        EVP_PKEY *parsed = bio ? PEM_read_bio_PrivateKey(bio, NULL, NULL, NULL) : NULL;
+        int success = parsed && rsa_oaep(parsed, 0, wrapped, wrappedLength, unwrapped, &unwrappedLength);
+        EVP_PKEY_free(parsed);
+        BIO_free(bio);
+        if (!success) {
+            fail("rsa_oaep_unwrap pem");
+            return;
+        }
+        add_sample(unwrapPEM, now() - start);
+    }
+}
+
+// MARK: - CMS
+
+static void bench_cms(EVP_PKEY *pkey, X509 *x509, size_t dataLength, int iterations)
+{
+    unsigned char *data = malloc(dataLength);
+    if (!data) return;
+    RAND_bytes(data, (int)dataLength);
+
+    unsigned char *signature = NULL;
+    int signatureLength = 0;
+
+    bench_result *sign = begin_result("cms_sign", iterations, 0, "\"dataLength\": %zu", dataLength);
+    for (int i = 0; i < iterations; i++) {
+        OPENSSL_free(signature);
+        signature = NULL;
+        double start = now();
+        BIO *dataBIO = BIO_new_mem_buf(data, (int)dataLength);
+        CMS_ContentInfo *contentInfo = CMS_sign(x509, pkey, NULL, dataBIO, CMS_DETACHED);
+        signatureLength = contentInfo ? i2d_CMS_ContentInfo(contentInfo, &signature) : -1;
+        CMS_ContentInfo_free(contentInfo);
+        BIO_free(dataBIO);
+        if (signatureLength <= 0) {
+            fail("cms_sign");
+            free(data);
+            return;
+        }
+        add_sample(sign, now() - start);
+    }
+
+    bench_result *verify = begin_result("cms_verify", iterations, 0, "\"dataLength\": %zu", dataLength);
+    for (int i = 0; i < iterations; i++) {
+        double start = now();
+        BIO *dataBIO = BIO_new_mem_buf(data, (int)dataLength);
+        const unsigned char *p = signature;
+        CMS_ContentInfo *contentInfo = d2i_CMS_ContentInfo(NULL, &p, signatureLength);
+        int verified = contentInfo && CMS_verify(contentInfo, NULL, NULL, dataBIO, NULL, CMS_DETACHED | CMS_NO_SIGNER_CERT_VERIFY) == 1;
+        CMS_ContentInfo_free(contentInfo);
+        BIO_free(dataBIO);
+        if (!verified) {
+            fail("cms_verify");
+            break;
+        }
+        add_sample(verify, now() - start);
+    }
+
+    OPENSSL_free(signature);
+    free(data);
+}
+
+// MARK: - PBKDF2
+
+static void bench_pbkdf2(const char *name, const EVP_MD *md, int rounds, int iterations)
+{
+    const char *passphrase = "moreoverpassphraseboardorchestratwelvewordsgrandnotchwaterfallfixture";
+    unsigned char salt[40], key[32];
+    RAND_bytes(salt, sizeof(salt));
+
+    bench_result *result = begin_result(name, iterations, 0, "\"rounds\": %d, \"keyLength\": 32", rounds);
+    for (int i = 0; i < iterations; i++) {
+        double start = now();
+        if (PKCS5_PBKDF2_HMAC(passphrase, (int)strlen(passphrase), salt, sizeof(salt), rounds, md, sizeof(key), key) != 1) {
+            fail(name);
+            return;
+        }
+        add_sample(result, now() - start);
+    }
+}
+
+// MARK: - Certificate / CSR
+
+static void bench_certificate(int iterations)
+{
+    bench_result *result = begin_result("certificate_csr_generation", iterations, 0, "\"bits\": 2048");
+    for (int i = 0; i < iterations; i++) {
+        double start = now();
+        EVP_PKEY *pkey = generate_rsa_key();
+        X509 *x509 = pkey ? create_certificate(pkey, "benchmark") : NULL;
+        X509_REQ *request = x509 ? X509_to_X509_REQ(x509, pkey, EVP_sha256()) : NULL;
+        char *pem = request ? pem_private_key(pkey) : NULL;
+        BIO *bio = BIO_new(BIO_s_mem());
+        int success = pem && bio && PEM_write_bio_X509_REQ(bio, request) == 1 && PEM_write_bio_PUBKEY(bio, pkey) == 1;
+        double elapsed = now() - start;
+
+        BIO_free(bio);
+        free(pem);
+        X509_REQ_free(request);
+        X509_free(x509);
+        EVP_PKEY_free(pkey);
+        if (!success) {
+            fail("certificate_csr_generation");
+            return;
+        }
+        add_sample(result, elapsed);
+    }
+}
+
+// MARK: - JSON
+
+static int write_json(FILE *out, int quick)
+{
+    struct utsname system;
+    uname(&system);
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"nc-crypto-benchmark\",\n");
+    fprintf(out, "  \"version\": 1,\n");
+    fprintf(out, "  \"quick\": %s,\n", quick ? "true" : "false");
+    fprintf(out, "  \"openssl\": \"%s\",\n", OpenSSL_version(OPENSSL_VERSION));
+    fprintf(out, "  \"system\": \"%s %s\",\n", system.sysname, system.machine);
+    fprintf(out, "  \"cpus\": %ld,\n", sysconf(_SC_NPROCESSORS_ONLN));
+    fprintf(out, "  \"failures\": %d,\n", failures);
+    fprintf(out, "  \"results\": [\n");
+    for (int i = 0; i < resultCount; i++) {
+        bench_result *result = &results[i];
+        double best = result->best < 0 ? 0 : result->best;
+        fprintf(out, "    {\"name\": \"%s\", \"params\": {%s}, \"iterations\": %d, \"bestSeconds\": %.9f, \"meanSeconds\": %.9f",
+                result->name, result->params, result->iterations, best, result->mean);
+        if (result->bytes > 0 && best > 0) {
+            fprintf(out, ", \"megabytesPerSecond\": %.2f", ((double)result->bytes / MIB) / best);
+        }
+        fprintf(out, "}%s\n", i + 1 < resultCount ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+    return ferror(out) == 0;
+}
+
+int main(int argc, char **argv)
+{
+    int quick = 0;
+    const char *directory = "/tmp";
+    const char *output = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            quick = 1;
+        } else if (strcmp(argv[i], "--directory") == 0 && i + 1 < argc) {
+            directory = argv[++i];
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--quick] [--directory <tmp dir>] [--output <file.json>]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    const uint64_t fileSizes[] = { 1 * MIB, 16 * MIB, 128 * MIB };
+    const uint64_t quickFileSizes[] = { 256 * 1024, 4 * MIB };
+    const size_t blockSizes[] = { 64 * 1024, 256 * 1024, 1 * MIB, 4 * MIB };
+    const size_t quickBlockSizes[] = { 64 * 1024, 1 * MIB };
+
+    size_t fileSizeCount = quick ? sizeof(quickFileSizes) / sizeof(quickFileSizes[0]) : sizeof(fileSizes) / sizeof(fileSizes[0]);
+    size_t blockSizeCount = quick ? sizeof(quickBlockSizes) / sizeof(quickBlockSizes[0]) : sizeof(blockSizes) / sizeof(blockSizes[0]);
+
+    for (size_t f = 0; f < fileSizeCount; f++) {
+        for (size_t b = 0; b < blockSizeCount; b++) {
+            uint64_t fileSize = quick ? quickFileSizes[f] : fileSizes[f];
+            bench_file(directory, fileSize, quick ? quickBlockSizes[b] : blockSizes[b], quick ? 2 : (fileSize > 16 * MIB ? 3 : 10));
+        }
+    }
+    bench_file_batch(directory, quick ? 8 : 64, quick ? 64 * 1024 : 512 * 1024, quick ? 2 : 5);
+    // Chunks smaller than a block, then the usual chunk size over blocks that do not divide it
+    bench_file_chunks(directory, quick ? 100 * 1000 + 7 : 4 * MIB + 7, 10000, 16 * 1024, quick ? 2 : 5);
+    bench_file_chunks(directory, quick ? 4 * MIB + 7 : 128 * MIB + 7, quick ? 1 * MIB + 3 : 10 * MIB, 256 * 1024, quick ? 2 : 3);
+
+    EVP_PKEY *pkey = generate_rsa_key();
+    X509 *x509 = pkey ? create_certificate(pkey, "benchmark") : NULL;
+    char *privateKeyPEM = pkey ? pem_private_key(pkey) : NULL;
+    if (!pkey || !x509 || !privateKeyPEM) {
+        fail("test key material");
+    } else {
+        bench_rsa(pkey, privateKeyPEM, quick ? 5 : 200);
+        bench_cms(pkey, x509, 4096, quick ? 5 : 200);
+    }
+    free(privateKeyPEM);
+    X509_free(x509);
+    EVP_PKEY_free(pkey);
+
+    bench_pbkdf2("pbkdf2_hmac_sha256", EVP_sha256(), quick ? 10000 : PBKDF2_ITERATIONS, quick ? 1 : 5);
+    bench_pbkdf2("pbkdf2_hmac_sha1", EVP_sha1(), PBKDF2_ITERATIONS_OLD, quick ? 5 : 100);
+    bench_certificate(quick ? 1 : 10);
+
+    FILE *out = output ? fopen(output, "w") : stdout;
+    if (!out) {
+        perror(output);
+        return 1;
+    }
+    int written = write_json(out, quick);
+    if (output && fclose(out) != 0) written = 0;
+
+    return failures == 0 && written ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+# SPDX-FileCopyrightText: Nextcloud GmbH
+# SPDX-FileCopyrightText: 2026 Marino Faggiana
+# SPDX-License-Identifier: GPL-3.0-or-later
+"""Compare two nc-crypto-benchmark JSON files.
+
+usage: compare_benchmarks.py [--tolerance 0.15] [--check] baseline.json current.json
+
+Results are matched by name and params; the best time per operation is compared.
+Exit status is 1 when a result is slower than the baseline by more than the tolerance,
+when the current run reports failures, or (with --check) when the files are malformed.
+"""
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    for key in ("results", "failures"):
+        if key not in data:
+            raise ValueError("%s: missing '%s'" % (path, key))
+    return data
+
+
+def key(result):
+    return result["name"] + " " + json.dumps(result["params"], sort_keys=True)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--tolerance", type=float, default=0.15, help="allowed slowdown, 0.15 = 15%%")
+    parser.add_argument("--check", action="store_true", help="only validate the files")
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    args = parser.parse_args()
+
+    try:
+        baseline = load(args.baseline)
+        current = load(args.current)
+    except (OSError, ValueError) as error:
+        print(error, file=sys.stderr)
+        return 1
+
+    if current["failures"]:
+        print("current run reports %d failures" % current["failures"], file=sys.stderr)
+        return 1
+    if args.check:
+        return 0
+
+    base = {key(r): r for r in baseline["results"]}
+    regressions = 0
+    for result in current["results"]:
+        reference = base.get(key(result))
+        if not reference or reference["bestSeconds"] <= 0:
+            print("%-70s   new" % key(result))
+            continue
+        ratio = result["bestSeconds"] / reference["bestSeconds"]
+        flag = ""
+        if ratio > 1 + args.tolerance:
+            flag = "  REGRESSION"
+            regressions += 1
+        print("%-70s %8.3fx%s" % (key(result), ratio, flag))
+
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
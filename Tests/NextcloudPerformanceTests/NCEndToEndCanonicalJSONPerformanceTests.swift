@@ -0,0 +1,53 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import XCTest
+@testable import Nextcloud
+
+/// Signature payload of a folder with 10k files, serialized with JSONEncoder, parsed back and
+/// re-serialized with sorted keys (before) and with the canonical writer (after).
+final class NCEndToEndCanonicalJSONPerformanceTests: XCTestCase {
+    typealias Signature = NCEndToEndMetadata.E2eeV2Signature
+
+    private static let files = 10_000
+    private static let iterations = 20
+
+    private var signature: Signature!
+
+    override func setUp() {
+        // About 200 bytes of gzipped, encrypted, Base64 ciphertext per file
+        let bytes = (0..<(Self.files * 150)).map { UInt8(truncatingIfNeeded: ($0 &* 2_654_435_761) >> 13) }
+        signature = Signature(metadata: Signature.Metadata(ciphertext: Data(bytes).base64EncodedString() + "|aXY=", nonce: "bm9uY2U=", authenticationTag: "dGFn/+=="),
+                              users: (0..<10).map { Signature.Users(userId: "user\($0)", certificate: String(repeating: "MIIC\n", count: 200), encryptedMetadataKey: "a2V5") },
+                              version: "2.0")
+    }
+
+    private static func legacyData(_ signature: Signature) throws -> Data {
+        let json = try JSONEncoder().encode(signature)
+        let object = try JSONSerialization.jsonObject(with: json, options: [])
+        return try JSONSerialization.data(withJSONObject: object, options: [.sortedKeys, .withoutEscapingSlashes]).base64EncodedData()
+    }
+
+    func testLegacySerialization() throws {
+        let signature = signature!
+
+        measure(metrics: [XCTClockMetric(), XCTMemoryMetric()]) {
+            for _ in 0..<Self.iterations {
+                XCTAssertNoThrow(try Self.legacyData(signature))
+            }
+        }
+    }
+
+    func testCanonicalWriter() throws {
+        let signature = signature!
+        XCTAssertEqual(NCEndToEndMetadata.CanonicalJSONWriter.shared.signatureData(signature), try Self.legacyData(signature))
+
+        measure(metrics: [XCTClockMetric(), XCTMemoryMetric()]) {
+            for _ in 0..<Self.iterations {
+                XCTAssertFalse(NCEndToEndMetadata.CanonicalJSONWriter.shared.signatureData(signature).isEmpty)
+            }
+        }
+    }
+}
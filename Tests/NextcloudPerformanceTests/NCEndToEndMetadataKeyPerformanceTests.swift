@@ -0,0 +1,97 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import XCTest
+@testable import Nextcloud
+
+/// Key operations of one Metadata V2 encode and decode for a shared folder, with the parsed key cache
+/// (warm) and with every PEM parsed again as before the cache (cold).
+///
+/// Encode wraps the metadata key for every user and signs; decode unwraps the metadata key and every
+/// filedrop key with the private key and verifies the signature against every user certificate.
+final class NCEndToEndMetadataKeyPerformanceTests: XCTestCase {
+    private static let users = 10
+    private static let filedrops = 50
+
+    private var encryption: NCEndToEndEncryption!
+    private var certificates: [String] = []
+    private var privateKey = ""
+    private var directory: URL!
+
+    override func setUpWithError() throws {
+        // Loads the OpenSSL providers once
+        _ = NCEndToEndEncryption.shared()
+        encryption = NCEndToEndEncryption()
+        directory = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString)
+
+        // Every user has its own key pair; the first one is the current user
+        for index in 0..<Self.users {
+            let userDirectory = directory.appendingPathComponent("\(index)")
+            try FileManager.default.createDirectory(at: userDirectory, withIntermediateDirectories: true)
+            XCTAssertNotNil(NCEndToEndEncryption().createCSR("user\(index)", directory: userDirectory.path))
+            certificates.append(try String(contentsOf: userDirectory.appendingPathComponent("cert.pem"), encoding: .utf8))
+            if index == 0 {
+                privateKey = try String(contentsOf: userDirectory.appendingPathComponent("privateKey.pem"), encoding: .utf8)
+            }
+        }
+    }
+
+    override func tearDownWithError() throws {
+        try? FileManager.default.removeItem(at: directory)
+    }
+
+    private func encodeFolder(cold: Bool) -> Data? {
+        let metadataKey = encryption.generateKey()
+        for certificate in certificates {
+            if cold { encryption.invalidateKeyCache() }
+            XCTAssertNotNil(encryption.encryptAsymmetricData(metadataKey, certificate: certificate))
+        }
+        if cold { encryption.invalidateKeyCache() }
+        return encryption.generateSignatureCMS(Data("metadata".utf8), certificate: certificates[0], privateKey: privateKey, userId: "user0")
+    }
+
+    private func decodeFolder(wrappedKeys: [Data], signature: Data, cold: Bool) {
+        for wrappedKey in wrappedKeys {
+            if cold { encryption.invalidateKeyCache() }
+            XCTAssertNotNil(encryption.decryptAsymmetricData(wrappedKey, privateKey: privateKey))
+        }
+        if cold { encryption.invalidateKeyCache() }
+        XCTAssertTrue(encryption.verifySignatureCMS(signature, data: Data("metadata".utf8), certificates: certificates))
+    }
+
+    private func measureEncode(cold: Bool) {
+        _ = encodeFolder(cold: cold)
+        measure(metrics: [XCTClockMetric()]) {
+            XCTAssertNotNil(encodeFolder(cold: cold))
+        }
+    }
+
+    private func measureDecode(cold: Bool) throws {
+        let wrappedKeys = try (0...Self.filedrops).map { _ in
+            try XCTUnwrap(encryption.encryptAsymmetricData(encryption.generateKey(), certificate: certificates[0]))
+        }
+        let signature = try XCTUnwrap(encodeFolder(cold: false))
+        decodeFolder(wrappedKeys: wrappedKeys, signature: signature, cold: cold)
+        measure(metrics: [XCTClockMetric()]) {
+            decodeFolder(wrappedKeys: wrappedKeys, signature: signature, cold: cold)
+        }
+    }
+
+    func testEncodeWithKeyCache() {
+        measureEncode(cold: false)
+    }
+
+    func testEncodeParsingEveryKey() {
+        measureEncode(cold: true)
+    }
+
+    func testDecodeWithKeyCache() throws {
+        try measureDecode(cold: false)
+    }
+
+    func testDecodeParsingEveryKey() throws {
+        try measureDecode(cold: true)
+    }
+}
@@ -0,0 +1,96 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import XCTest
+import NextcloudKit
+import RealmSwift
+@testable import Nextcloud
+
+/// A 100k rows directory read as detached copies of every row (before) and as a columnar snapshot
+/// that materializes only the first screen (after).
+final class NCMetadataListingPerformanceTests: XCTestCase {
+    private static let rows = 100_000
+
+    private var configuration: Realm.Configuration!
+    private var realm: Realm!
+
+    override func setUpWithError() throws {
+        configuration = Realm.Configuration(inMemoryIdentifier: "NCMetadataListingPerformanceTests-\(UUID().uuidString)")
+        realm = try Realm(configuration: configuration)
+        let start = Date(timeIntervalSinceReferenceDate: 0)
+
+        try realm.write {
+            for index in 0..<Self.rows {
+                let metadata = tableMetadata()
+                metadata.ocId = "ocId-\(index)"
+                metadata.fileId = "\(index)"
+                metadata.fileName = "file\(index).jpg"
+                metadata.fileNameView = metadata.fileName
+                metadata.directory = index % 20 == 0
+                metadata.favorite = index % 97 == 0
+                metadata.classFile = metadata.directory ? NKTypeClassFile.directory.rawValue : (index % 3 == 0 ? NKTypeClassFile.image.rawValue : NKTypeClassFile.document.rawValue)
+                metadata.size = Int64(index)
+                metadata.etag = "etag-\(index)"
+                metadata.account = "account"
+                metadata.serverUrl = "https://cloud.example.com/remote.php/dav/files/user/Photos"
+                metadata.date = start.addingTimeInterval(TimeInterval(index)) as NSDate
+                realm.add(metadata)
+            }
+        }
+    }
+
+    override func tearDown() {
+        realm = nil
+    }
+
+    private var results: Results<tableMetadata> {
+        realm.objects(tableMetadata.self).filter("account == %@", "account")
+    }
+
+    func testDetachedCopies() {
+        measure(metrics: [XCTClockMetric(), XCTMemoryMetric()]) {
+            let metadatas = results.map { $0.detachedCopy() }
+            XCTAssertEqual(metadatas.count, Self.rows)
+        }
+    }
+
+    func testColumnarSnapshot() {
+        let configuration = configuration!
+
+        measure(metrics: [XCTClockMetric(), XCTMemoryMetric()]) {
+            let listing = NCMetadataListing(columns: NCMetadataListing.Columns(results),
+                                            sort: "date",
+                                            ascending: false,
+                                            favoriteOnTop: true,
+                                            directoryOnTop: true,
+                                            loader: { ocIds in
+                                                guard let realm = try? Realm(configuration: configuration) else {
+                                                    return []
+                                                }
+                                                return realm.objects(tableMetadata.self)
+                                                    .filter("ocId IN %@", ocIds)
+                                                    .map { $0.detachedCopy() }
+                                            })
+            // First screen
+            let visible = (0..<30).compactMap { listing.metadata(at: $0) }
+            XCTAssertEqual(listing.count, Self.rows)
+            XCTAssertEqual(visible.count, 30)
+        }
+    }
+
+    func testSortByName() {
+        let columns = NCMetadataListing.Columns(results)
+
+        measure(metrics: [XCTClockMetric()]) {
+            let listing = NCMetadataListing(columns: columns,
+                                            sort: "fileName",
+                                            ascending: true,
+                                            favoriteOnTop: true,
+                                            directoryOnTop: true,
+                                            loader: { _ in [] })
+            XCTAssertEqual(listing.count, Self.rows)
+        }
+    }
+}
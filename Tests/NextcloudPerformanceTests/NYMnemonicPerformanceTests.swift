@@ -0,0 +1,39 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import XCTest
+@testable import Nextcloud
+
+/// Passphrase generation and recovery check, as the E2EE setup does them, per batch of mnemonics
+final class NYMnemonicPerformanceTests: XCTestCase {
+    private static let iterations = 1000
+
+    override func setUp() {
+        // Loads the wordlist outside the measures
+        _ = NYMnemonic.generateString(128, language: "english")
+    }
+
+    func testGenerateAndValidate() {
+        measure(metrics: [XCTClockMetric(), XCTMemoryMetric()]) {
+            for _ in 0..<Self.iterations {
+                let mnemonic = NYMnemonic.generateString(128, language: "english")
+                XCTAssertTrue(NYMnemonic.isValidMnemonic(mnemonic ?? "", language: "english"))
+            }
+        }
+    }
+
+    func testEntropyRoundTrip() {
+        let entropies = (0..<Self.iterations).map { _ in
+            Data((0..<32).map { _ in UInt8.random(in: 0...255) })
+        }
+
+        measure(metrics: [XCTClockMetric()]) {
+            for entropy in entropies {
+                let mnemonic = NYMnemonic.mnemonicString(fromEntropy: entropy, language: "english")
+                XCTAssertEqual(NYMnemonic.entropy(fromMnemonic: mnemonic ?? "", language: "english"), entropy)
+            }
+        }
+    }
+}
@@ -0,0 +1,100 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import Testing
+@testable import Nextcloud
+
+@Suite("NCCameraRollPrefetcher pipeline")
+struct NCCameraRollPrefetcherTests {
+    /// Extractor taking a fixed time per asset, recording how far it ran ahead of the consumer
+    private final class SlowExtractor: CameraRollExtractor, @unchecked Sendable {
+        private let lock = NSLock()
+        private(set) var extracted: [String] = []
+
+        func extractCameraRoll(from metadatas: [tableMetadata], progress: NCCameraRoll.ProgressHandler?) async -> [tableMetadata] {
+            metadatas
+        }
+
+        func extractCameraRoll(from metadata: tableMetadata) async -> [tableMetadata] {
+            try? await Task.sleep(nanoseconds: 20_000_000)
+            lock.lock()
+            extracted.append(metadata.ocId)
+            lock.unlock()
+            return [metadata]
+        }
+
+        var count: Int {
+            lock.lock()
+            defer { lock.unlock() }
+            return extracted.count
+        }
+    }
+
+    private static func metadatas(_ count: Int, size: Int64 = 1024) -> [tableMetadata] {
+        (0..<count).map {
+            let metadata = tableMetadata()
+            metadata.ocId = "ocId\($0)"
+            metadata.size = size
+            return metadata
+        }
+    }
+
+    @Test("Items come back in order and extraction overlaps the consumer")
+    func order() async {
+        let extractor = SlowExtractor()
+        let prefetcher = NCCameraRollPrefetcher(metadatas: Self.metadatas(6), extractor: extractor, lookahead: 2)
+        var ocIds: [String] = []
+
+        while let item = await prefetcher.next() {
+            ocIds.append(item.metadata.ocId)
+            // Upload hand-off
+            try? await Task.sleep(nanoseconds: 20_000_000)
+        }
+
+        let report = prefetcher.report()
+        #expect(ocIds == (0..<6).map { "ocId\($0)" })
+        #expect(report.items == 6)
+        #expect(report.overlap > 0)
+    }
+
+    @Test("The producer stops at the lookahead and at the disk budget")
+    func bounded() async throws {
+        let extractor = SlowExtractor()
+        let prefetcher = NCCameraRollPrefetcher(metadatas: Self.metadatas(10), extractor: extractor, lookahead: 3)
+        _ = await prefetcher.next()
+        try await Task.sleep(nanoseconds: 300_000_000)
+        #expect(extractor.count == 4)
+        prefetcher.cancel()
+
+        let budgetExtractor = SlowExtractor()
+        let budgeted = NCCameraRollPrefetcher(metadatas: Self.metadatas(10, size: 100), extractor: budgetExtractor, lookahead: 8, diskBudget: 150)
+        _ = await budgeted.next()
+        try await Task.sleep(nanoseconds: 300_000_000)
+        #expect(budgetExtractor.count == 3)
+        budgeted.cancel()
+    }
+
+    @Test("Cancelling the consumer task stops the prefetch")
+    func cancellation() async throws {
+        let extractor = SlowExtractor()
+        let prefetcher = NCCameraRollPrefetcher(metadatas: Self.metadatas(100), extractor: extractor, lookahead: 2)
+
+        let consumer = Task {
+            var count = 0
+            while await prefetcher.next() != nil {
+                count += 1
+                try? await Task.sleep(nanoseconds: 10_000_000)
+            }
+            return count
+        }
+        try await Task.sleep(nanoseconds: 100_000_000)
+        consumer.cancel()
+
+        let consumed = await consumer.value
+        try await Task.sleep(nanoseconds: 100_000_000)
+        #expect(consumed < 100)
+        #expect(extractor.count <= consumed + 3)
+    }
+}
@@ -0,0 +1,59 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import Testing
+@testable import Nextcloud
+
+@Suite("NCChunkUpload parallel window")
+struct NCChunkUploadWindowTests {
+    // Sends `count` chunks of 10 MB at the given aggregate throughput, one window at a time
+    private static func send(_ window: inout NCChunkUpload.Window, count: Int, throughput: (Int) -> Double, now: inout Date) {
+        for _ in 0..<count {
+            let width = window.width
+            let seconds = Double(10_000_000 * width) / throughput(width)
+            for _ in 0..<width {
+                now = now.addingTimeInterval(seconds / Double(width))
+                window.success(bytes: 10_000_000, now: now)
+            }
+        }
+    }
+
+    @Test("Width grows while the throughput scales and stops at the plateau")
+    func growsToPlateau() {
+        var now = Date()
+        var window = NCChunkUpload.Window(maximum: 8, now: now)
+
+        // The uplink saturates at four parallel PUTs
+        Self.send(&window, count: 20, throughput: { Double(min($0, 4)) * 1_000_000 }, now: &now)
+
+        #expect(window.width >= 4 && window.width <= 5)
+    }
+
+    @Test("Width is bounded and halved on failure")
+    func boundedAndHalved() {
+        var now = Date()
+        var window = NCChunkUpload.Window(maximum: 6, now: now)
+
+        Self.send(&window, count: 20, throughput: { Double($0) * 1_000_000 }, now: &now)
+        #expect(window.width == 6)
+
+        window.failure(now: now)
+        #expect(window.width == 3)
+        window.failure(now: now)
+        window.failure(now: now)
+        #expect(window.width == 1)
+    }
+
+    @Test("Chunks written ahead are sent as they are when MKCOL creates the folder")
+    func prewrittenChunksFreshFolder() {
+        // E2EE: the chunks were persisted by the encryption, no attempt created the folder yet
+        #expect(NCChunkUpload.start(resuming: true, folderCreatedBefore: false, folderCreatedNow: true) == .resume)
+        // Relaunch while the folder is still on the server
+        #expect(NCChunkUpload.start(resuming: true, folderCreatedBefore: true, folderCreatedNow: false) == .resume)
+        // The folder a previous attempt created has expired
+        #expect(NCChunkUpload.start(resuming: true, folderCreatedBefore: true, folderCreatedNow: true) == .restart)
+        #expect(NCChunkUpload.start(resuming: false, folderCreatedBefore: false, folderCreatedNow: true) == .split)
+    }
+}
@@ -0,0 +1,55 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import Testing
+@testable import Nextcloud
+
+@Suite("NCE2eeCiphertextCache deltas")
+struct NCE2eeCiphertextCacheTests {
+    private static func entry(_ fileNameIdentifier: String, fileName: String, mimeType: String = "image/jpeg") -> tableE2eEncryption {
+        let object = tableE2eEncryption(account: "account", ocIdServerUrl: "ocId", fileNameIdentifier: fileNameIdentifier)
+        object.fileName = fileName
+        object.mimeType = mimeType
+        object.key = "key-" + fileNameIdentifier
+        object.initializationVector = "iv-" + fileNameIdentifier
+        object.authenticationTag = "tag-" + fileNameIdentifier
+        return object
+    }
+
+    @Test("Adds, renames and removes are applied to a cached folder")
+    func deltas() {
+        let cache = NCE2eeCiphertextCache()
+        var folder = NCE2eeCiphertextCache.Folder()
+        folder.insert(Self.entry("A", fileName: "a.jpg"))
+        cache.store(folder, account: "account", serverUrl: "/e2ee", generation: cache.folder(account: "account", serverUrl: "/e2ee").generation)
+
+        cache.update(account: "account", serverUrl: "/e2ee") { $0.insert(Self.entry("B", fileName: "b", mimeType: "httpd/unix-directory")) }
+        cache.update(account: "account", serverUrl: "/e2ee") { $0.rename(fileNameIdentifier: "A", newFileName: "renamed.jpg") }
+        cache.update(account: "account", serverUrl: "/e2ee") { $0.insert(Self.entry("C", fileName: "c.jpg")) }
+        cache.update(account: "account", serverUrl: "/e2ee") { $0.remove(fileNameIdentifier: "C") }
+
+        let cached = cache.folder(account: "account", serverUrl: "/e2ee").folder
+        #expect(cached?.files.keys.sorted() == ["A"])
+        #expect(cached?.files["A"]?.fileName == "renamed.jpg")
+        #expect(cached?.files["A"]?.key == "key-A")
+        #expect(cached?.folders == ["B": "b"])
+    }
+
+    @Test("A folder read before a concurrent change is not stored")
+    func staleReadIsDiscarded() {
+        let cache = NCE2eeCiphertextCache()
+        let generation = cache.folder(account: "account", serverUrl: "/e2ee").generation
+
+        cache.update(account: "account", serverUrl: "/e2ee") { $0.remove(fileNameIdentifier: "A") }
+        cache.store(NCE2eeCiphertextCache.Folder(), account: "account", serverUrl: "/e2ee", generation: generation)
+        #expect(cache.folder(account: "account", serverUrl: "/e2ee").folder == nil)
+
+        cache.store(NCE2eeCiphertextCache.Folder(), account: "account", serverUrl: "/e2ee", generation: cache.folder(account: "account", serverUrl: "/e2ee").generation)
+        #expect(cache.folder(account: "account", serverUrl: "/e2ee").folder != nil)
+
+        cache.invalidate(account: "account")
+        #expect(cache.folder(account: "account", serverUrl: "/e2ee").folder == nil)
+    }
+}
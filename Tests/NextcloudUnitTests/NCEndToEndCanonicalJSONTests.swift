@@ -0,0 +1,65 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import Testing
+@testable import Nextcloud
+
+@Suite("E2EE metadata canonical JSON")
+struct NCEndToEndCanonicalJSONTests {
+    typealias Signature = NCEndToEndMetadata.E2eeV2Signature
+
+    // The serialization used before the canonical writer: encode, parse back, re-serialize with sorted keys
+    private static func legacyData(_ signature: Signature) throws -> Data {
+        let json = try JSONEncoder().encode(signature)
+        let object = try JSONSerialization.jsonObject(with: json, options: [])
+        return try JSONSerialization.data(withJSONObject: object, options: [.sortedKeys, .withoutEscapingSlashes])
+    }
+
+    private static func signature(ciphertext: String, users: [Signature.Users]?) -> Signature {
+        Signature(metadata: Signature.Metadata(ciphertext: ciphertext, nonce: "bm9uY2U=", authenticationTag: "dGFn/+=="),
+                  users: users,
+                  version: "2.0")
+    }
+
+    @Test("Small signature matches the golden bytes")
+    func golden() {
+        let signature = Self.signature(ciphertext: "YWJj|aXY=",
+                                       users: [Signature.Users(userId: "alice", certificate: "-----BEGIN CERTIFICATE-----\nMII/\n", encryptedMetadataKey: "a2V5"),
+                                               Signature.Users(userId: "bob", certificate: "cert", encryptedMetadataKey: nil)])
+        let expected = #"{"metadata":{"authenticationTag":"dGFn/+==","ciphertext":"YWJj|aXY=","nonce":"bm9uY2U="},"#
+            + #""users":[{"certificate":"-----BEGIN CERTIFICATE-----\nMII/\n","encryptedMetadataKey":"a2V5","userId":"alice"},"#
+            + #"{"certificate":"cert","userId":"bob"}],"version":"2.0"}"#
+
+        let data = NCEndToEndMetadata.CanonicalJSONWriter.shared.data(signature)
+
+        #expect(String(data: data, encoding: .utf8) == expected)
+        #expect(NCEndToEndMetadata.CanonicalJSONWriter.shared.signatureData(signature) == data.base64EncodedData())
+    }
+
+    @Test("Byte-identical to the JSONSerialization output, escaping included",
+          arguments: ["plain", "quote \" backslash \\ slash /", "tab\tnew\nline\rreturn", "\u{08}\u{0C}\u{01}\u{1F}\u{7F}",
+                      "àèìòù €", "emoji 🔐👩‍💻", "\u{2028}\u{2029}", ""])
+    func matchesLegacy(value: String) throws {
+        let withUsers = Self.signature(ciphertext: value,
+                                       users: [Signature.Users(userId: value, certificate: value, encryptedMetadataKey: value),
+                                               Signature.Users(userId: "u", certificate: "c", encryptedMetadataKey: nil)])
+        let withoutUsers = Self.signature(ciphertext: value, users: nil)
+
+        #expect(NCEndToEndMetadata.CanonicalJSONWriter.shared.data(withUsers) == (try Self.legacyData(withUsers)))
+        #expect(NCEndToEndMetadata.CanonicalJSONWriter.shared.data(withoutUsers) == (try Self.legacyData(withoutUsers)))
+    }
+
+    @Test("Byte-identical for a folder with 10k files")
+    func largeFolder() throws {
+        // About 200 bytes of gzipped, encrypted, Base64 ciphertext per file
+        let bytes = (0..<(10_000 * 150)).map { UInt8(truncatingIfNeeded: ($0 &* 2_654_435_761) >> 13) }
+        let signature = Self.signature(ciphertext: Data(bytes).base64EncodedString() + "|aXY=",
+                                       users: (0..<10).map { Signature.Users(userId: "user\($0)", certificate: String(repeating: "MIIC\n", count: 200), encryptedMetadataKey: "a2V5") })
+        let legacy = try Self.legacyData(signature).base64EncodedData()
+        let canonical = NCEndToEndMetadata.CanonicalJSONWriter.shared.signatureData(signature)
+
+        #expect(canonical == legacy)
+    }
+}
@@ -0,0 +1,150 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import Testing
+import NextcloudKit
+import RealmSwift
+@testable import Nextcloud
+
+@Suite("NCMetadataListing snapshot")
+struct NCMetadataListingTests {
+    private static func metadata(_ name: String,
+                                 directory: Bool = false,
+                                 favorite: Bool = false,
+                                 classFile: NKTypeClassFile = .document,
+                                 size: Int64 = 0,
+                                 session: String = "",
+                                 fileId: String? = nil,
+                                 livePhotoFile: String = "") -> tableMetadata {
+        let metadata = tableMetadata()
+        metadata.ocId = "ocId-" + name + session
+        metadata.fileId = fileId ?? name
+        metadata.fileName = name
+        metadata.fileNameView = name
+        metadata.directory = directory
+        metadata.favorite = favorite
+        metadata.classFile = directory ? NKTypeClassFile.directory.rawValue : classFile.rawValue
+        metadata.size = size
+        metadata.session = session
+        metadata.livePhotoFile = livePhotoFile
+        metadata.etag = "etag-" + name
+        return metadata
+    }
+
+    private static func listing(_ metadatas: [tableMetadata], sort: String = "fileName", ascending: Bool = true) -> NCMetadataListing {
+        let byOcId = Dictionary(metadatas.map { ($0.ocId, $0) }) { first, _ in first }
+        return NCMetadataListing(columns: NCMetadataListing.Columns(metadatas),
+                                 sort: sort,
+                                 ascending: ascending,
+                                 favoriteOnTop: true,
+                                 directoryOnTop: true,
+                                 loader: { ocIds in ocIds.compactMap { byOcId[$0]?.detachedCopy() } })
+    }
+
+    @Test("Rows are ordered favorite directories, favorite files, directories, files")
+    func order() {
+        let listing = Self.listing([
+            Self.metadata("b.txt", size: 10),
+            Self.metadata("Docs", directory: true),
+            Self.metadata("a.txt", size: 20),
+            Self.metadata("Starred", directory: true, favorite: true),
+            Self.metadata("c.txt", favorite: true, size: 5),
+            Self.metadata("Archive", directory: true)
+        ])
+
+        #expect(listing.fileNames == ["Starred", "c.txt", "Archive", "Docs", "a.txt", "b.txt"])
+        let footer = listing.footerInformation()
+        #expect(footer.directories == 3)
+        #expect(footer.files == 3)
+        #expect(footer.size == 35)
+        #expect(listing.index(ocId: "ocId-Docs") == 3)
+    }
+
+    @Test("Names are sorted like the Finder, numbers by value")
+    func nameOrder() {
+        let names = ["file10.txt", "File1.txt", "file2.txt", "file100.txt", "file20.txt"]
+
+        #expect(Self.listing(names.map { Self.metadata($0) }).fileNames == ["File1.txt", "file2.txt", "file10.txt", "file20.txt", "file100.txt"])
+        #expect(Self.listing(names.map { Self.metadata($0) }, ascending: false).fileNames == ["file100.txt", "file20.txt", "file10.txt", "file2.txt", "File1.txt"])
+    }
+
+    @Test("Live Photo videos and rows replaced by an upload are dropped")
+    func normalization() {
+        let listing = Self.listing([
+            Self.metadata("live.heic", classFile: .image, fileId: "1", livePhotoFile: "2"),
+            Self.metadata("live.mov", classFile: .video, fileId: "2", livePhotoFile: "1"),
+            Self.metadata("broken.heic", classFile: .image, fileId: "3", livePhotoFile: "99"),
+            Self.metadata("orphan.mov", classFile: .video, fileId: "4", livePhotoFile: "98"),
+            Self.metadata("report.pdf"),
+            Self.metadata("report.pdf", session: "upload")
+        ])
+
+        #expect(listing.fileNames == ["broken.heic", "live.heic", "report.pdf"])
+        #expect(listing.ocIds.last == "ocId-report.pdfupload")
+        #expect(listing.flags[1].contains(.livePhoto))
+        #expect(listing.flags[0].contains(.livePhotoBroken))
+        #expect(listing.metadata(at: 0)?.livePhotoFile == "")
+        #expect(listing.metadata(at: 1)?.livePhotoFile == "2")
+        #expect(listing.ocIds(classFiles: [NKTypeClassFile.image.rawValue]) == ["ocId-broken.heic", "ocId-live.heic"])
+    }
+
+    @Test("Only the block of the requested row is materialized")
+    func materialization() {
+        let metadatas = (0..<200).map { Self.metadata(String(format: "file%03d", $0)) }
+        let listing = Self.listing(metadatas)
+
+        #expect(listing.materialized == 0)
+        #expect(listing.metadata(at: 70)?.fileNameView == "file070")
+        #expect(listing.materialized == NCMetadataListing.materializeBlock)
+        #expect(listing.metadata(at: 100)?.fileNameView == "file100")
+        #expect(listing.materialized == NCMetadataListing.materializeBlock)
+        #expect(listing.metadata(at: 200) == nil)
+    }
+
+    @Test("A 100k rows snapshot materializes only the first screen")
+    func largeListing() throws {
+        let configuration = Realm.Configuration(inMemoryIdentifier: "NCMetadataListingTests-\(UUID().uuidString)")
+        let realm = try Realm(configuration: configuration)
+        let rows = 100_000
+        let start = Date(timeIntervalSinceReferenceDate: 0)
+
+        try realm.write {
+            for index in 0..<rows {
+                let metadata = Self.metadata("file\(index).jpg",
+                                             directory: index % 20 == 0,
+                                             favorite: index % 97 == 0,
+                                             classFile: index % 3 == 0 ? .image : .document,
+                                             size: Int64(index))
+                metadata.account = "account"
+                metadata.serverUrl = "https://cloud.example.com/remote.php/dav/files/user/Photos"
+                metadata.date = start.addingTimeInterval(TimeInterval(index)) as NSDate
+                realm.add(metadata)
+            }
+        }
+        let results = realm.objects(tableMetadata.self).filter("account == %@", "account")
+
+        let listing = NCMetadataListing(columns: NCMetadataListing.Columns(results),
+                                        sort: "date",
+                                        ascending: false,
+                                        favoriteOnTop: true,
+                                        directoryOnTop: true,
+                                        loader: { ocIds in
+                                            guard let realm = try? Realm(configuration: configuration) else {
+                                                return []
+                                            }
+                                            return realm.objects(tableMetadata.self)
+                                                .filter("ocId IN %@", ocIds)
+                                                .map { $0.detachedCopy() }
+                                        })
+
+        // First screen
+        let visible = (0..<30).compactMap { listing.metadata(at: $0) }
+
+        #expect(listing.count == rows)
+        #expect(visible.count == 30)
+        #expect(visible.allSatisfy { $0.realm == nil })
+        #expect(listing.materialized == NCMetadataListing.materializeBlock)
+    }
+}
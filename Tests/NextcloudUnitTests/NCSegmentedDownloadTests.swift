@@ -0,0 +1,69 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import Testing
+@testable import Nextcloud
+
+@Suite("NCSegmentedDownload segment bitmap")
+struct NCSegmentedDownloadTests {
+    @Test("Ranges cover the file, the last one is shorter")
+    func ranges() {
+        let state = NCSegmentedDownload.State(etag: "etag", size: 25, segmentSize: 10)
+
+        #expect(state.count == 3)
+        #expect(state.range(of: 0) == 0..<10)
+        #expect(state.range(of: 2) == 20..<25)
+        #expect(state.missing == [0, 1, 2])
+    }
+
+    @Test("Received segments survive a round trip through the persisted state")
+    func persistence() throws {
+        var state = NCSegmentedDownload.State(etag: "etag", size: 100 * 8 + 3, segmentSize: 8)
+        for index in [0, 7, 8, 100] {
+            state.setReceived(index)
+        }
+
+        let decoded = try JSONDecoder().decode(NCSegmentedDownload.State.self, from: JSONEncoder().encode(state))
+
+        #expect(decoded == state)
+        #expect(decoded.count == 101)
+        #expect(decoded.missing.count == 97)
+        #expect(!decoded.missing.contains(8))
+        #expect(decoded.receivedBytes == 8 * 3 + 3)
+    }
+
+    @Test("Only a partial file of the same version is resumable, discard removes it")
+    func resumable() throws {
+        let directory = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+        defer {
+            try? FileManager.default.removeItem(at: directory)
+        }
+        let fileNameLocalPath = directory.appendingPathComponent("video.mov").path
+        let metadata = tableMetadata()
+        metadata.etag = "etag"
+        metadata.size = 3 * NCSegmentedDownload.segmentSize
+        let segmentedDownload = { NCSegmentedDownload(metadata: metadata, fileNameLocalPath: fileNameLocalPath, queue: .main) }
+
+        #expect(!segmentedDownload().isResumable)
+
+        var state = NCSegmentedDownload.State(etag: "etag", size: metadata.size, segmentSize: NCSegmentedDownload.segmentSize)
+        state.setReceived(0)
+        try JSONEncoder().encode(state).write(to: URL(fileURLWithPath: fileNameLocalPath + ".segments"))
+        #expect(FileManager.default.createFile(atPath: fileNameLocalPath + ".part", contents: nil))
+        let fileHandle = try FileHandle(forWritingTo: URL(fileURLWithPath: fileNameLocalPath + ".part"))
+        try fileHandle.truncate(atOffset: UInt64(metadata.size))
+        try fileHandle.close()
+
+        #expect(segmentedDownload().isResumable)
+
+        metadata.etag = "changed"
+        #expect(!segmentedDownload().isResumable)
+
+        segmentedDownload().discard()
+        #expect(!FileManager.default.fileExists(atPath: fileNameLocalPath + ".part"))
+        #expect(!FileManager.default.fileExists(atPath: fileNameLocalPath + ".segments"))
+    }
+}
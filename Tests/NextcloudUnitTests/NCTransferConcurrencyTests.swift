@@ -0,0 +1,95 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import Testing
+import NextcloudKit
+@testable import Nextcloud
+
+@Suite("NCTransferConcurrency AIMD")
+struct NCTransferConcurrencyTests {
+    private static func metadata(_ name: String, host: String = "cloud.example.com", size: Int64 = 1024) -> tableMetadata {
+        let metadata = tableMetadata()
+        metadata.urlBase = "https://" + host
+        metadata.serverUrlFileName = "https://\(host)/remote.php/dav/files/user/" + name
+        metadata.size = size
+        metadata.status = NCGlobal.shared.metadataStatusUploading
+        return metadata
+    }
+
+    private static func limit(_ controller: NCTransferConcurrency, _ sizeClass: NCTransferConcurrency.SizeClass) -> Int? {
+        controller.statistics().first { $0.sizeClass == sizeClass }?.limit
+    }
+
+    @Test("Steady small transfers raise the limit up to the maximum")
+    func additiveIncrease() {
+        let controller = NCTransferConcurrency(maximumSmall: 6, maximumLarge: 2)
+        let start = Date()
+
+        for index in 0..<100 {
+            let metadata = Self.metadata("file\(index)")
+            controller.begin(metadata, now: start)
+            controller.finish(serverUrlFileName: metadata.serverUrlFileName, bytes: metadata.size, error: .success, now: start.addingTimeInterval(0.2))
+        }
+
+        #expect(Self.limit(controller, .small) == 6)
+        #expect(Self.limit(controller, .large) == nil)
+    }
+
+    @Test("A network failure halves the limit once per window")
+    func multiplicativeDecrease() {
+        let controller = NCTransferConcurrency(maximumSmall: 16, maximumLarge: 2)
+        let start = Date()
+
+        for index in 0..<60 {
+            let metadata = Self.metadata("file\(index)")
+            controller.begin(metadata, now: start)
+            controller.finish(serverUrlFileName: metadata.serverUrlFileName, bytes: metadata.size, error: .success, now: start.addingTimeInterval(0.2))
+        }
+        let grown = Self.limit(controller, .small) ?? 0
+        #expect(grown > 4)
+
+        let timeout = NKError(errorCode: NSURLErrorTimedOut, errorDescription: "timeout")
+        for index in 0..<2 {
+            let metadata = Self.metadata("failed\(index)")
+            controller.begin(metadata, now: start.addingTimeInterval(10))
+            controller.finish(serverUrlFileName: metadata.serverUrlFileName, bytes: 0, error: timeout, now: start.addingTimeInterval(10.5))
+        }
+
+        #expect(Self.limit(controller, .small) == max(1, grown / 2))
+        #expect(controller.statistics().first?.failed == 2)
+    }
+
+    @Test("Small and large files have separate budgets per host")
+    func budgets() {
+        let controller = NCTransferConcurrency(maximumSmall: 8, maximumLarge: 2)
+        let large = Self.metadata("large", size: NCTransferConcurrency.largeFileSize)
+        let other = Self.metadata("other", host: "other.example.com")
+        var slots = controller.availableSlots(metadatas: [large, Self.metadata("large2", size: NCTransferConcurrency.largeFileSize)])
+
+        #expect(!slots.take(controller.key(for: large)))
+        #expect(slots.take(controller.key(for: Self.metadata("small"))))
+        #expect(slots.take(controller.key(for: other)))
+        #expect(slots.hasAny(host: "cloud.example.com"))
+    }
+
+    @Test("Transfers begun before their status is written hold their slot")
+    func begunTransfers() {
+        let controller = NCTransferConcurrency(maximumSmall: 4, maximumLarge: 2)
+        let key = controller.key(for: Self.metadata("small"))
+        for index in 0..<4 {
+            let metadata = Self.metadata("file\(index)")
+            metadata.status = NCGlobal.shared.metadataStatusWaitUpload
+            controller.begin(metadata)
+        }
+
+        var slots = controller.availableSlots(metadatas: [])
+        #expect(!slots.take(key))
+
+        controller.discard(serverUrlFileName: Self.metadata("file0").serverUrlFileName)
+        slots = controller.availableSlots(metadatas: [])
+        #expect(slots.take(key))
+        #expect(!slots.take(key))
+    }
+}
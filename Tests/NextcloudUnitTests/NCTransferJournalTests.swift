@@ -0,0 +1,91 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import Testing
+@testable import Nextcloud
+
+@Suite("NCTransferJournal replay")
+struct NCTransferJournalTests {
+    private static let foregroundSessions: Set<String> = ["download", "upload"]
+
+    private static func url() -> URL {
+        FileManager.default.temporaryDirectory.appendingPathComponent("TransferJournal-\(UUID().uuidString).jsonl")
+    }
+
+    @Test("A relaunch replays only the transfers not ended")
+    func replay() async {
+        let url = Self.url()
+        defer { try? FileManager.default.removeItem(at: url) }
+
+        let journal = NCTransferJournal(url: url, launch: "first")
+        for index in 0..<3 {
+            await journal.start(ocId: "ocId\(index)", account: "account", session: "uploadBackground", serverUrlFileName: "https://cloud.example.com/file\(index)", taskIdentifier: index)
+        }
+        await journal.checkpoint(serverUrlFileName: "https://cloud.example.com/file1", bytes: 1024)
+        await journal.end(ocId: "ocId0")
+
+        let relaunched = NCTransferJournal(url: url, launch: "second")
+        let entries = await relaunched.entriesToVerify(foregroundSessions: Self.foregroundSessions)
+        let statistics = await relaunched.statistics()
+
+        #expect(Set(entries.map(\.ocId)) == ["ocId1", "ocId2"])
+        #expect(entries.first { $0.ocId == "ocId1" }?.bytes == 1024)
+        #expect(entries.allSatisfy { $0.launch == "first" })
+        #expect(statistics.replayedRecords == 5)
+        #expect(statistics.active == 2)
+    }
+
+    @Test("Only stalled background transfers of this launch are verified")
+    func stalled() async {
+        let url = Self.url()
+        defer { try? FileManager.default.removeItem(at: url) }
+
+        let journal = NCTransferJournal(url: url, launch: "launch", stallInterval: 60)
+        let start = Date()
+        await journal.start(ocId: "foreground", account: "account", session: "download", serverUrlFileName: "https://cloud.example.com/a", taskIdentifier: 1, now: start)
+        await journal.start(ocId: "background", account: "account", session: "downloadBackground", serverUrlFileName: "https://cloud.example.com/b", taskIdentifier: 2, now: start)
+
+        #expect(await journal.entriesToVerify(foregroundSessions: Self.foregroundSessions, now: start.addingTimeInterval(30)).isEmpty)
+
+        let stalled = await journal.entriesToVerify(foregroundSessions: Self.foregroundSessions, now: start.addingTimeInterval(90))
+        #expect(stalled.map(\.ocId) == ["background"])
+
+        await journal.verified(ocId: "background", now: start.addingTimeInterval(90))
+        #expect(await journal.entriesToVerify(foregroundSessions: Self.foregroundSessions, now: start.addingTimeInterval(120)).isEmpty)
+    }
+
+    @Test("The transfers missing from the journal are checked periodically")
+    func unjournaled() async {
+        let url = Self.url()
+        defer { try? FileManager.default.removeItem(at: url) }
+
+        let journal = NCTransferJournal(url: url, launch: "launch", unjournaledInterval: 60)
+        let start = Date()
+
+        #expect(await journal.claimUnjournaledCheck(now: start))
+        #expect(await !journal.claimUnjournaledCheck(now: start.addingTimeInterval(30)))
+        #expect(await journal.claimUnjournaledCheck(now: start.addingTimeInterval(60)))
+        #expect(await !journal.claimUnjournaledCheck(now: start.addingTimeInterval(90)))
+    }
+
+    @Test("Ended transfers are compacted away")
+    func compaction() async throws {
+        let url = Self.url()
+        defer { try? FileManager.default.removeItem(at: url) }
+
+        let journal = NCTransferJournal(url: url)
+        await journal.start(ocId: "kept", account: "account", session: "uploadBackground", serverUrlFileName: "https://cloud.example.com/kept", taskIdentifier: 0)
+        for index in 0..<500 {
+            await journal.start(ocId: "ocId\(index)", account: "account", session: "uploadBackground", serverUrlFileName: "https://cloud.example.com/file\(index)", taskIdentifier: index)
+            await journal.end(ocId: "ocId\(index)")
+        }
+
+        let statistics = await journal.statistics()
+        let lines = try String(contentsOf: url, encoding: .utf8).split(separator: "\n").count
+        #expect(statistics.compactions > 0)
+        #expect(lines < 300)
+        #expect(await NCTransferJournal(url: url).isActive(ocId: "kept"))
+    }
+}
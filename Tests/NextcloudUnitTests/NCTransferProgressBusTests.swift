@@ -0,0 +1,72 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import Testing
+@testable import Nextcloud
+
+@Suite("NCTransferProgressBus coalescing")
+struct NCTransferProgressBusTests {
+    /// Records the delivered batches
+    private final class Recorder: @unchecked Sendable {
+        private let lock = NSLock()
+        private(set) var batches: [[NCTransferProgressBus.Update]] = []
+
+        func append(_ updates: [NCTransferProgressBus.Update]) {
+            lock.lock()
+            batches.append(updates)
+            lock.unlock()
+        }
+
+        var last: [String: Float] {
+            lock.lock()
+            defer { lock.unlock() }
+            var last: [String: Float] = [:]
+            for update in batches.joined() {
+                last[update.fileName] = update.progress
+            }
+            return last
+        }
+    }
+
+    @Test("Bursts of updates are merged into few batches keeping the latest progress")
+    func coalescing() async throws {
+        let recorder = Recorder()
+        let bus = NCTransferProgressBus(interval: 0.05) { updates in
+            recorder.append(updates)
+        }
+
+        for step in 1...1000 {
+            for file in 0..<20 {
+                bus.post(progress: Float(step) / 1000, totalBytes: Int64(step), totalBytesExpected: 1000, fileName: "file\(file)", serverUrl: "https://cloud.example.com")
+            }
+        }
+        try await Task.sleep(nanoseconds: 300_000_000)
+
+        let statistics = bus.statistics()
+        #expect(statistics.posted == 20_000)
+        #expect(statistics.posted == statistics.filtered + statistics.merged + statistics.delivered)
+        #expect(statistics.batches == recorder.batches.count)
+        #expect(statistics.batches < 10)
+        #expect(recorder.last.count == 20)
+        #expect(recorder.last.values.allSatisfy { $0 == 1 })
+    }
+
+    @Test("Updates within the same percent are filtered")
+    func quantization() async throws {
+        let recorder = Recorder()
+        let bus = NCTransferProgressBus(interval: 0.01) { updates in
+            recorder.append(updates)
+        }
+
+        for step in 0..<10 {
+            bus.post(progress: 0.5 + Float(step) / 10_000, totalBytes: 0, totalBytesExpected: 0, fileName: "file", serverUrl: "https://cloud.example.com")
+            try await Task.sleep(nanoseconds: 20_000_000)
+        }
+
+        let statistics = bus.statistics()
+        #expect(statistics.filtered == 9)
+        #expect(statistics.delivered == 1)
+    }
+}
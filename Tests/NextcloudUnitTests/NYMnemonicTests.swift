@@ -0,0 +1,66 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import Testing
+@testable import Nextcloud
+
+@Suite("NYMnemonic BIP-39 encoder and validation")
+struct NYMnemonicTests {
+    // Reference vectors from the BIP-39 specification (english wordlist)
+    private let vectors: [(entropy: String, mnemonic: String)] = [
+        ("00000000000000000000000000000000", "abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon about"),
+        ("7f7f7f7f7f7f7f7f7f7f7f7f7f7f7f7f", "legal winner thank year wave sausage worth useful legal winner thank yellow"),
+        ("80808080808080808080808080808080", "letter advice cage absurd amount doctor acoustic avoid letter advice cage above"),
+        ("ffffffffffffffffffffffffffffffff", "zoo zoo zoo zoo zoo zoo zoo zoo zoo zoo zoo wrong"),
+        ("9e885d952ad362caeb4efe34a8e91bd2", "ozone drill grab fiber curtain grace pudding thank cruise elder eight picnic"),
+        ("68a79eaca2324873eacc50cb9c6eca8cc68ea5d936f98787c60c7ebc74e6ce7c",
+         "hamster diagram private dutch cause delay private meat slide toddler razor book happy fancy gospel tennis maple dilemma loan word shrug inflict delay length")
+    ]
+
+    private static func data(hex: String) -> Data {
+        var data = Data()
+        var index = hex.startIndex
+        while index < hex.endIndex {
+            let next = hex.index(index, offsetBy: 2)
+            data.append(UInt8(hex[index..<next], radix: 16) ?? 0)
+            index = next
+        }
+        return data
+    }
+
+    @Test("Entropy encodes to the reference mnemonic and back")
+    func referenceVectors() {
+        for vector in vectors {
+            let entropy = Self.data(hex: vector.entropy)
+
+            #expect(NYMnemonic.mnemonicString(fromEntropy: entropy, language: "english") == vector.mnemonic)
+            #expect(NYMnemonic.entropy(fromMnemonic: vector.mnemonic, language: "english") == entropy)
+        }
+    }
+
+    @Test("Unknown words, wrong word counts and bad checksums are rejected")
+    func validation() {
+        #expect(NYMnemonic.isValidMnemonic("Legal Winner thank year wave sausage worth useful legal winner thank  yellow", language: "english"))
+        #expect(!NYMnemonic.isValidMnemonic(Array(repeating: "abandon", count: 12).joined(separator: " "), language: "english"))
+        #expect(!NYMnemonic.isValidMnemonic("abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon about", language: "english"))
+        #expect(!NYMnemonic.isValidMnemonic("abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon nextcloud", language: "english"))
+        #expect(!NYMnemonic.isValidMnemonic("", language: "english"))
+    }
+
+    @Test("Generated passphrases are valid")
+    func generation() {
+        let iterations = 1000
+        var valid = 0
+
+        for _ in 0..<iterations {
+            if let mnemonic = NYMnemonic.generateString(128, language: "english"),
+               NYMnemonic.isValidMnemonic(mnemonic, language: "english") {
+                valid += 1
+            }
+        }
+
+        #expect(valid == iterations)
+    }
+}
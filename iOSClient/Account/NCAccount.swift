@@ -161,6 +161,7 @@ class NCAccount: NSObject {
         // Remove keychain security
         NCPreferences().setPassword(account: account, password: nil)
         NCPreferences().clearAllKeysEndToEnd(account: account)
+        NCEndToEndEncryption.shared().invalidateKeyCache()
         NCPreferences().clearAllKeysPushNotification(account: account)
         // Remove Account Server in Error
         NCNetworking.shared.removeServerErrorAccount(account)
@@ -14,6 +14,10 @@ class tableChunk: Object {
     @Persisted var fileName: Int = 0
     @Persisted var ocId = ""
     @Persisted var size: Int64 = 0
+    /// OC-Total-Length of the upload, the chunks may be all there is of the file (E2EE)
+    @Persisted var totalSize: Int64 = 0
+    /// The chunk folder was created on the server by a previous attempt
+    @Persisted var folderCreated: Bool = false
 }
 
 extension NCManageDatabase {
@@ -39,7 +43,7 @@ extension NCManageDatabase {
         }
     }
 
-    func addChunksAsync(account: String, ocId: String, chunkFolder: String, filesChunk: [(fileName: String, size: Int64)]) async {
+    func addChunksAsync(account: String, ocId: String, chunkFolder: String, filesChunk: [(fileName: String, size: Int64)], totalSize: Int64 = 0, folderCreated: Bool = false) async {
         await core.performRealmWriteAsync { realm in
             let results = realm.objects(tableChunk.self)
                 .filter("account == %@ AND ocId == %@", account, ocId)
@@ -53,6 +57,8 @@ extension NCManageDatabase {
                 object.index = ocId + fileChunk.fileName
                 object.ocId = ocId
                 object.size = fileChunk.size
+                object.totalSize = totalSize
+                object.folderCreated = folderCreated
                 realm.add(object, update: .all)
             }
         }
@@ -120,6 +126,16 @@ extension NCManageDatabase {
         } ?? UUID().uuidString
     }
 
+    /// Total length and chunk folder state of the persisted chunks, nil when there are none
+    func getChunkUploadState(account: String, ocId: String) -> (totalSize: Int64, folderCreated: Bool)? {
+        core.performRealmRead { realm in
+            realm.objects(tableChunk.self)
+                .filter("account == %@ AND ocId == %@", account, ocId)
+                .first
+                .map { (totalSize: $0.totalSize, folderCreated: $0.folderCreated) }
+        }
+    }
+
     func getChunks(account: String, ocId: String) -> [(fileName: String, size: Int64)] {
         core.performRealmRead { realm in
             realm.objects(tableChunk.self)
@@ -17,6 +17,8 @@ class tableDirectory: Object {
     @objc dynamic var lastSyncDate: NSDate?
     @objc dynamic var ocId = ""
     @objc dynamic var offline: Bool = false
+    /// Etag of the folder when its offline subtree was last found fully downloaded
+    @objc dynamic var offlineEtag = ""
     @objc dynamic var permissions = ""
     @objc dynamic var richWorkspace: String?
     @objc dynamic var serverUrl = ""
@@ -244,6 +246,11 @@ extension NCManageDatabase {
     /// - Note: The operation is performed asynchronously and thread-safely within `performRealmWriteAsync`.
     func setDirectoryAsync(serverUrl: String, offline: Bool, metadata: tableMetadata) async {
         await core.performRealmWriteAsync { realm in
+            // The subtree is verified again by the next offline synchronization
+            realm.objects(tableDirectory.self)
+                .filter("account == %@ AND (serverUrl == %@ OR serverUrl BEGINSWITH %@)", metadata.account, serverUrl, serverUrl + "/")
+                .forEach { $0.offlineEtag = "" }
+
             if let result = realm.objects(tableDirectory.self)
                 .filter("account == %@ AND serverUrl == %@", metadata.account, serverUrl)
                 .first {
@@ -264,6 +271,16 @@ extension NCManageDatabase {
         }
     }
 
+    /// Records the etag at which the offline subtree of the directory was found fully downloaded.
+    func setDirectoryOfflineEtagAsync(account: String, serverUrl: String, etag: String) async {
+        await core.performRealmWriteAsync { realm in
+            realm.objects(tableDirectory.self)
+                .filter("account == %@ AND serverUrl == %@", account, serverUrl)
+                .first?
+                .offlineEtag = etag
+        }
+    }
+
     /// Asynchronously updates the `richWorkspace` field of a directory entry in the database.
     ///
     /// This function performs the following steps inside a Realm write transaction:
@@ -380,6 +397,21 @@ extension NCManageDatabase {
         }
     }
 
+    /// Offline etags recorded for the given directories, in one query
+    func getDirectoryOfflineEtagsAsync(account: String, serverUrls: [String]) async -> [String: String] {
+        guard !serverUrls.isEmpty else {
+            return [:]
+        }
+
+        return await core.performRealmReadAsync { realm in
+            var etags: [String: String] = [:]
+            for directory in realm.objects(tableDirectory.self).filter("account == %@ AND serverUrl IN %@", account, serverUrls) {
+                etags[directory.serverUrl] = directory.offlineEtag
+            }
+            return etags
+        } ?? [:]
+    }
+
     func getTablesDirectoryAsync(predicate: NSPredicate, sorted: String, ascending: Bool) async -> [tableDirectory] {
         await core.performRealmReadAsync { realm in
             realm.objects(tableDirectory.self)
@@ -60,6 +60,105 @@ class tableE2eEncryptionV4: Object {
      }
 }
 
+// MARK: -
+// MARK: Ciphertext cache
+
+/// Decrypted `files` / `folders` of each encrypted folder, as stored in tableE2eEncryption.
+/// The table mutations below apply their changes here as deltas, so encoding the metadata after a single
+/// upload, rename or delete does not read and copy every row of the folder again.
+final class NCE2eeCiphertextCache: @unchecked Sendable {
+    static let shared = NCE2eeCiphertextCache()
+
+    struct File: Equatable {
+        let authenticationTag: String
+        let fileName: String
+        let key: String
+        let initializationVector: String
+        let mimeType: String
+    }
+
+    struct Folder: Equatable {
+        var files: [String: File] = [:]
+        var folders: [String: String] = [:]
+
+        mutating func insert(_ object: tableE2eEncryption) {
+            if object.mimeType == "httpd/unix-directory" {
+                files.removeValue(forKey: object.fileNameIdentifier)
+                folders[object.fileNameIdentifier] = object.fileName
+            } else {
+                folders.removeValue(forKey: object.fileNameIdentifier)
+                files[object.fileNameIdentifier] = File(authenticationTag: object.authenticationTag,
+                                                        fileName: object.fileName,
+                                                        key: object.key,
+                                                        initializationVector: object.initializationVector,
+                                                        mimeType: object.mimeType)
+            }
+        }
+
+        mutating func remove(fileNameIdentifier: String) {
+            files.removeValue(forKey: fileNameIdentifier)
+            folders.removeValue(forKey: fileNameIdentifier)
+        }
+
+        mutating func rename(fileNameIdentifier: String, newFileName: String) {
+            if let file = files[fileNameIdentifier] {
+                files[fileNameIdentifier] = File(authenticationTag: file.authenticationTag,
+                                                 fileName: newFileName,
+                                                 key: file.key,
+                                                 initializationVector: file.initializationVector,
+                                                 mimeType: file.mimeType)
+            } else if folders[fileNameIdentifier] != nil {
+                folders[fileNameIdentifier] = newFileName
+            }
+        }
+    }
+
+    private var cache: [String: Folder] = [:]
+    // Bumped by every mutation: a folder read from the database is only stored if nothing changed meanwhile
+    private var generation: UInt64 = 0
+    private let lock = NSLock()
+
+    private func key(account: String, serverUrl: String) -> String {
+        return account + "|" + serverUrl
+    }
+
+    func folder(account: String, serverUrl: String) -> (folder: Folder?, generation: UInt64) {
+        lock.lock()
+        defer { lock.unlock() }
+        return (cache[key(account: account, serverUrl: serverUrl)], generation)
+    }
+
+    func store(_ folder: Folder, account: String, serverUrl: String, generation: UInt64) {
+        lock.lock()
+        defer { lock.unlock() }
+        guard generation == self.generation else { return }
+        cache[key(account: account, serverUrl: serverUrl)] = folder
+    }
+
+    // Deltas are idempotent, so applying one to a folder that was read after the write is harmless
+    func update(account: String, serverUrl: String, _ delta: (inout Folder) -> Void) {
+        lock.lock()
+        defer { lock.unlock() }
+        generation &+= 1
+        let key = key(account: account, serverUrl: serverUrl)
+        if var folder = cache[key] {
+            delta(&folder)
+            cache[key] = folder
+        }
+    }
+
+    func invalidate(account: String? = nil) {
+        lock.lock()
+        defer { lock.unlock() }
+        generation &+= 1
+        if let account {
+            cache = cache.filter { !$0.key.hasPrefix(account + "|") }
+        } else {
+            cache.removeAll()
+        }
+    }
+}
+
 // MARK: -
 // MARK: Table V1, V1.2
 
@@ -92,6 +191,25 @@ class tableE2eMetadataV2: Object {
      }
 }
 
+/// Last V2 metadata of a folder that was verified and decoded into the tables above, identified by the SHA-256
+/// of the metadata and signature as served. Holds no key material or file names: those stay in tableE2eEncryption.
+/// Any local change to the folder's tableE2eEncryption rows removes it.
+class tableE2eMetadataVerified: Object {
+    @Persisted(primaryKey: true) var primaryKey = ""
+    @Persisted var account = ""
+    @Persisted var date = Date()
+    @Persisted var fingerprint = ""
+    @Persisted var ocIdServerUrl = ""
+    @Persisted var serverUrl = ""
+
+    convenience init(account: String, ocIdServerUrl: String) {
+        self.init()
+        self.account = account
+        self.ocIdServerUrl = ocIdServerUrl
+        self.primaryKey = account + ocIdServerUrl
+     }
+}
+
 class tableE2eCounter: Object {
     @Persisted(primaryKey: true) var primaryKey: String
     @Persisted var account: String
@@ -130,17 +248,59 @@ extension NCManageDatabase {
     // MARK: -
     // MARK: tableE2eEncryption
     func addE2eEncryptionAsync(_ object: tableE2eEncryption) async {
+        let account = object.account
+        let serverUrl = object.serverUrl
+        let delta = tableE2eEncryption(value: object)
+
         await core.performRealmWriteAsync { realm in
             realm.add(object, update: .all)
+            realm.delete(realm.objects(tableE2eMetadataVerified.self).filter("account == %@ AND serverUrl == %@", account, serverUrl))
         }
+
+        NCE2eeCiphertextCache.shared.update(account: account, serverUrl: serverUrl) { $0.insert(delta) }
     }
 
     func deleteE2eEncryptionAsync(predicate: NSPredicate) async {
+        var deleted: [(account: String, serverUrl: String, fileNameIdentifier: String)] = []
+
         await core.performRealmWriteAsync { realm in
             let results = realm.objects(tableE2eEncryption.self)
                 .filter(predicate)
+            deleted = results.map { ($0.account, $0.serverUrl, $0.fileNameIdentifier) }
+            realm.delete(realm.objects(tableE2eMetadataVerified.self)
+                .filter("account IN %@ AND serverUrl IN %@", Set(deleted.map { $0.account }), Set(deleted.map { $0.serverUrl })))
             realm.delete(results)
         }
+
+        for entry in deleted {
+            NCE2eeCiphertextCache.shared.update(account: entry.account, serverUrl: entry.serverUrl) {
+                $0.remove(fileNameIdentifier: entry.fileNameIdentifier)
+            }
+        }
+    }
+
+    /// Files and folders of an encrypted folder for the V2 metadata, served from the ciphertext cache
+    func getE2eCiphertextAsync(account: String, serverUrl: String) async -> NCE2eeCiphertextCache.Folder {
+        let cache = NCE2eeCiphertextCache.shared
+        let cached = cache.folder(account: account, serverUrl: serverUrl)
+
+        if let folder = cached.folder {
+            return folder
+        }
+
+        guard let folder = await core.performRealmReadAsync({ realm in
+            var folder = NCE2eeCiphertextCache.Folder()
+            for result in realm.objects(tableE2eEncryption.self).filter("account == %@ AND serverUrl == %@", account, serverUrl) {
+                folder.insert(result)
+            }
+            return folder
+        }) else {
+            return NCE2eeCiphertextCache.Folder()
+        }
+
+        cache.store(folder, account: account, serverUrl: serverUrl, generation: cached.generation)
+
+        return folder
     }
 
     func getE2eEncryption(predicate: NSPredicate) -> tableE2eEncryption? {
@@ -179,6 +339,11 @@ extension NCManageDatabase {
             result.fileName = newFileName
 
             realm.add(result, update: .all)
+            realm.delete(realm.objects(tableE2eMetadataVerified.self).filter("account == %@ AND serverUrl == %@", account, serverUrl))
+        }
+
+        NCE2eeCiphertextCache.shared.update(account: account, serverUrl: serverUrl) {
+            $0.rename(fileNameIdentifier: fileNameIdentifier, newFileName: newFileName)
         }
     }
     // MARK: -
@@ -338,6 +503,35 @@ extension NCManageDatabase {
         }
     }
 
+    // MARK: -
+    // MARK: Verified metadata
+
+    func setE2eMetadataVerifiedAsync(account: String, serverUrl: String, ocIdServerUrl: String, fingerprint: String) async {
+        await core.performRealmWriteAsync { realm in
+            let object = tableE2eMetadataVerified(account: account, ocIdServerUrl: ocIdServerUrl)
+
+            object.fingerprint = fingerprint
+            object.serverUrl = serverUrl
+
+            realm.add(object, update: .all)
+        }
+    }
+
+    func getE2eMetadataVerifiedAsync(account: String, ocIdServerUrl: String) async -> String? {
+        await core.performRealmReadAsync { realm in
+            realm.objects(tableE2eMetadataVerified.self)
+                .filter("account == %@ AND ocIdServerUrl == %@", account, ocIdServerUrl)
+                .first?
+                .fingerprint
+        }
+    }
+
+    func deleteE2eMetadataVerifiedAsync(account: String, ocIdServerUrl: String) async {
+        await core.performRealmWriteAsync { realm in
+            realm.delete(realm.objects(tableE2eMetadataVerified.self).filter("account == %@ AND ocIdServerUrl == %@", account, ocIdServerUrl))
+        }
+    }
+
     func getCounterE2eMetadataAsync(account: String, ocIdServerUrl: String) async -> Int? {
         await core.performRealmReadAsync { realm in
             realm.objects(tableE2eCounter.self)
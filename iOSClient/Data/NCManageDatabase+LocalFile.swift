@@ -164,6 +164,21 @@ extension NCManageDatabase {
         } ?? []
     }
 
+    /// Etags of the local files of the given ocIds, in one query
+    func getLocalFileEtagsAsync(ocIds: [String]) async -> [String: String] {
+        guard !ocIds.isEmpty else {
+            return [:]
+        }
+
+        return await core.performRealmReadAsync { realm in
+            var etags: [String: String] = [:]
+            for localFile in realm.objects(tableLocalFile.self).filter("ocId IN %@", ocIds) {
+                etags[localFile.ocId] = localFile.etag
+            }
+            return etags
+        } ?? [:]
+    }
+
     func getTableLocalFile(predicate: NSPredicate) -> tableLocalFile? {
         return core.performRealmRead { realm in
             realm.objects(tableLocalFile.self)
@@ -982,6 +982,21 @@ extension NCManageDatabase {
         } ?? []
     }
 
+    /// Same as `getMetadatas(predicate:)`, read with the Realm of the calling thread instead of on the database queue.
+    /// For the main thread: Realm reads never wait for writes, a `realmQueue.sync` waits behind every write queued.
+    /// The Realm is refreshed only when it is older than the rows asked for.
+    func getMetadatasOnCurrentThread(ocIds: [String]) -> [tableMetadata] {
+        guard !isSuspendingDatabaseOperation,
+              let realm = try? Realm() else {
+            return []
+        }
+        var results = realm.objects(tableMetadata.self).filter("ocId IN %@", ocIds)
+        if results.count < ocIds.count, realm.refresh() {
+            results = realm.objects(tableMetadata.self).filter("ocId IN %@", ocIds)
+        }
+        return results.map { $0.detachedCopy() }
+    }
+
     func getMetadatas(predicate: NSPredicate,
                       sortedByKeyPath: String,
                       ascending: Bool = false) -> [tableMetadata]? {
@@ -1368,34 +1383,6 @@ extension NCManageDatabase {
         let sorted = await self.sortedMetadata(layoutForView: layoutForView, account: account, metadatas: detachedMetadatas)
         return sorted
     }
-
-    /// Asynchronously retrieves and sorts `tableMetadata` objects matching a given predicate and layout.
-    func getMetadatasAsyncDataSource(withServerUrl serverUrl: String,
-                                     withUserId userId: String,
-                                     withAccount account: String,
-                                     withLayout layoutForView: NCDBLayoutForView?,
-                                     withPreficate predicateSource: NSPredicate? = nil) async -> [tableMetadata] {
-        var predicate = NSPredicate(format: "account == %@ AND serverUrl == %@ AND fileName != %@ AND NOT (status IN %@)", account, serverUrl, NextcloudKit.shared.nkCommonInstance.rootFileName, NCGlobal.shared.metadataStatusHideInView)
-
-        if NCPreferences().getPersonalFilesOnly(account: account) {
-            predicate = NSPredicate(format: "account == %@ AND serverUrl == %@ AND fileName != %@ AND (ownerId == %@ || ownerId == '') AND mountType == '' AND NOT (status IN %@)", account, serverUrl, NextcloudKit.shared.nkCommonInstance.rootFileName, userId, NCGlobal.shared.metadataStatusHideInView)
-        }
-
-        if let predicateSource {
-            predicate = predicateSource
-        }
-
-        let detachedMetadatas = await core.performRealmReadAsync { realm in
-            realm.objects(tableMetadata.self)
-                .filter(predicate)
-                .map { $0.detachedCopy() }
-        } ?? []
-
-        let cleanedMetadatas = filterAndNormalizeLivePhotos(from: detachedMetadatas)
-        let sorted = await self.sortedMetadata(layoutForView: layoutForView, account: account, metadatas: cleanedMetadatas)
-
-        return sorted
-    }
 #endif
 
     func getMetadatasAsync(predicate: NSPredicate,
@@ -1570,6 +1557,36 @@ extension NCManageDatabase {
     }
 
 #if !EXTENSION
+    /// Reads the listing of a directory as a columnar snapshot, only the rows shown are later read in full.
+    /// See `NCMetadataListing`.
+    func getMetadataListingAsync(withServerUrl serverUrl: String,
+                                 withUserId userId: String,
+                                 withAccount account: String,
+                                 withLayout layoutForView: NCDBLayoutForView?,
+                                 withPreficate predicateSource: NSPredicate? = nil) async -> NCMetadataListing {
+        var predicate = NSPredicate(format: "account == %@ AND serverUrl == %@ AND fileName != %@ AND NOT (status IN %@)", account, serverUrl, NextcloudKit.shared.nkCommonInstance.rootFileName, NCGlobal.shared.metadataStatusHideInView)
+
+        if NCPreferences().getPersonalFilesOnly(account: account) {
+            predicate = NSPredicate(format: "account == %@ AND serverUrl == %@ AND fileName != %@ AND (ownerId == %@ || ownerId == '') AND mountType == '' AND NOT (status IN %@)", account, serverUrl, NextcloudKit.shared.nkCommonInstance.rootFileName, userId, NCGlobal.shared.metadataStatusHideInView)
+        }
+
+        if let predicateSource {
+            predicate = predicateSource
+        }
+
+        let columns = await core.performRealmReadAsync { realm in
+            NCMetadataListing.Columns(realm.objects(tableMetadata.self).filter(predicate))
+        } ?? NCMetadataListing.Columns()
+
+        // Ordered outside the database queue
+        let layout = layoutForView ?? NCDBLayoutForView()
+        return NCMetadataListing(columns: columns,
+                                 sort: layout.sort,
+                                 ascending: layout.ascending,
+                                 favoriteOnTop: NCPreferences().getFavoriteOnTop(account: account),
+                                 directoryOnTop: NCPreferences().getDirectoryOnTop(account: account))
+    }
+
     func getMediaCompactMetadatasAsync(
         predicate: NSPredicate,
         sortedByKeyPath: String,
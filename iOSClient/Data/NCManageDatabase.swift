@@ -122,7 +122,7 @@ final class NCManageDatabase: @unchecked Sendable {
             tableDirectory.self, tableTag.self, tableAccount.self,
             tableCapabilities.self, tableE2eEncryption.self, tableE2eEncryptionLock.self,
             tableE2eMetadata12.self, tableE2eMetadata.self, tableE2eUsers.self,
-            tableE2eCounter.self, tableShare.self, tableChunk.self, tableAvatar.self,
+            tableE2eCounter.self, tableE2eMetadataVerified.self, tableShare.self, tableChunk.self, tableAvatar.self,
             tableDashboardWidget.self, tableDashboardWidgetButton.self,
             NCDBLayoutForView.self, TableSecurityGuardDiagnostics.self, tableLivePhoto.self
         ]
@@ -254,11 +254,13 @@ final class NCManageDatabase: @unchecked Sendable {
 
     func clearTablesE2EE(account: String?) {
         self.clearTable(tableE2eEncryption.self, account: account)
+        NCE2eeCiphertextCache.shared.invalidate(account: account)
         self.clearTable(tableE2eEncryptionLock.self, account: account)
         self.clearTable(tableE2eMetadata12.self, account: account)
         self.clearTable(tableE2eMetadata.self, account: account)
         self.clearTable(tableE2eUsers.self, account: account)
         self.clearTable(tableE2eCounter.self, account: account)
+        self.clearTable(tableE2eMetadataVerified.self, account: account)
     }
 
     func cleanTablesOcIds(account: String, userId: String, urlBase: String) async {
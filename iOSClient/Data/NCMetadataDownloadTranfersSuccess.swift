@@ -70,6 +70,9 @@ actor NCMetadataDownloadTranfersSuccess {
             delegate.metadataDownloadTransferWillFlush()
         }
 
+        var e2eeJobs: [NCEndToEndFileJob] = []
+        let utilityFileSystem = NCUtilityFileSystem()
+
         for metadata in metadatas {
             // E2EE
             if let result = await NCManageDatabase.shared.getE2eEncryptionAsync(
@@ -77,20 +80,25 @@ actor NCMetadataDownloadTranfersSuccess {
                                        metadata.fileName,
                                        metadata.serverUrl)
             ) {
-                NCEndToEndEncryption.shared().decryptFile(metadata.fileName,
-                                                          fileNameView: metadata.fileNameView,
-                                                          ocId: metadata.ocId,
-                                                          userId: metadata.userId,
-                                                          urlBase: metadata.urlBase,
-                                                          key: result.key,
-                                                          initializationVector: result.initializationVector,
-                                                          authenticationTag: result.authenticationTag)
+                let job = NCEndToEndFileJob()
+                job.decrypt = true
+                job.fileName = utilityFileSystem.getDirectoryProviderStorageOcId(metadata.ocId, fileName: metadata.fileName, userId: metadata.userId, urlBase: metadata.urlBase)
+                job.fileNameDestination = utilityFileSystem.getDirectoryProviderStorageOcId(metadata.ocId, fileName: metadata.fileNameView, userId: metadata.userId, urlBase: metadata.urlBase)
+                job.key = result.key
+                job.initializationVector = result.initializationVector
+                job.authenticationTag = result.authenticationTag
+                e2eeJobs.append(job)
             }
 
             metadatasLocalFiles.append(metadata)
 
         }
 
+        // Decrypt all the E2EE files of the flush on a pool of workers
+        if !e2eeJobs.isEmpty {
+            NCEndToEndEncryption.shared().processFileJobs(e2eeJobs, maxConcurrent: 0)
+        }
+
         // added metadatas
         await NCManageDatabase.shared.addMetadatasAsync(metadatas)
         // Local File
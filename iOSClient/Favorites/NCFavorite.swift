@@ -55,13 +55,13 @@ class NCFavorite: NCCollectionViewCommon {
            predicate = NSPredicate(format: "account == %@ AND favorite == true AND NOT (status IN %@)", session.account, global.metadataStatusHideInView)
         }
 
-        let metadatas = await self.database.getMetadatasAsyncDataSource(withServerUrl: self.serverUrl,
-                                                                        withUserId: self.session.userId,
-                                                                        withAccount: self.session.account,
-                                                                        withLayout: self.layoutForView,
-                                                                        withPreficate: predicate)
+        let listing = await self.database.getMetadataListingAsync(withServerUrl: self.serverUrl,
+                                                                  withUserId: self.session.userId,
+                                                                  withAccount: self.session.account,
+                                                                  withLayout: self.layoutForView,
+                                                                  withPreficate: predicate)
 
-        self.dataSource = NCCollectionViewDataSource(metadatas: metadatas,
+        self.dataSource = NCCollectionViewDataSource(listing: listing,
                                                      layoutForView: layoutForView,
                                                      account: session.account)
         await super.reloadDataSource()
@@ -70,7 +70,7 @@ class NCFavorite: NCCollectionViewCommon {
     override func getServerData(forced: Bool = false) async {
         defer {
             stopGUIGetServerData()
-            startSyncMetadata(metadatas: self.dataSource.getMetadatas())
+            startSyncMetadata(metadatas: self.dataSource.getDirectoryMetadatas())
         }
 
         // If is already in-flight, do nothing
@@ -143,12 +143,12 @@ class NCFiles: NCCollectionViewCommon {
             self.mainNavigationController?.menuPlus?.updatePlusButtonEnabled(session: self.session)
         }
 
-        let metadatas = await self.database.getMetadatasAsyncDataSource(withServerUrl: self.serverUrl,
-                                                                        withUserId: self.session.userId,
-                                                                        withAccount: self.session.account,
-                                                                        withLayout: self.layoutForView)
+        let listing = await self.database.getMetadataListingAsync(withServerUrl: self.serverUrl,
+                                                                  withUserId: self.session.userId,
+                                                                  withAccount: self.session.account,
+                                                                  withLayout: self.layoutForView)
 
-        self.dataSource = NCCollectionViewDataSource(metadatas: metadatas,
+        self.dataSource = NCCollectionViewDataSource(listing: listing,
                                                      layoutForView: layoutForView,
                                                      account: session.account)
         await super.reloadDataSource()
@@ -157,7 +157,7 @@ class NCFiles: NCCollectionViewCommon {
     override func getServerData(forced: Bool = false) async {
         defer {
             stopGUIGetServerData()
-            startSyncMetadata(metadatas: self.dataSource.getMetadatas())
+            startSyncMetadata(metadatas: self.dataSource.getDirectoryMetadatas())
         }
 
         await networking.networkingTasks.cancel(identifier: "\(self.serverUrl)_NCFiles")
@@ -67,21 +67,22 @@ class NCGroupfolders: NCCollectionViewCommon {
     // MARK: - DataSource
 
     override func reloadDataSource() async {
-        var metadatas: [tableMetadata] = []
-
         if self.serverUrl.isEmpty {
-            metadatas = await database.getMetadatasFromGroupfoldersAsync(session: session,
-                                                                         layoutForView: layoutForView)
+            let metadatas = await database.getMetadatasFromGroupfoldersAsync(session: session,
+                                                                             layoutForView: layoutForView)
+            self.dataSource = NCCollectionViewDataSource(metadatas: metadatas,
+                                                         layoutForView: layoutForView,
+                                                         account: session.account)
         } else {
-            metadatas = await self.database.getMetadatasAsyncDataSource(withServerUrl: self.serverUrl,
-                                                                        withUserId: self.session.userId,
-                                                                        withAccount: self.session.account,
-                                                                        withLayout: self.layoutForView)
+            let listing = await self.database.getMetadataListingAsync(withServerUrl: self.serverUrl,
+                                                                      withUserId: self.session.userId,
+                                                                      withAccount: self.session.account,
+                                                                      withLayout: self.layoutForView)
+            self.dataSource = NCCollectionViewDataSource(listing: listing,
+                                                         layoutForView: layoutForView,
+                                                         account: session.account)
         }
 
-        self.dataSource = NCCollectionViewDataSource(metadatas: metadatas,
-                                                     layoutForView: layoutForView,
-                                                     account: session.account)
         await super.reloadDataSource()
     }
 
@@ -7,6 +7,8 @@ import UIKit
 
 extension NCCollectionViewCommon: UICollectionViewDataSourcePrefetching {
     func collectionView(_ collectionView: UICollectionView, prefetchItemsAt indexPaths: [IndexPath]) {
+        dataSource.prefetch(indexPaths: indexPaths)
+
         /*
         let ext = global.getSizeExtension(column: self.numberOfColumns)
         guard !isSearchingMode else {
@@ -105,10 +105,9 @@ extension NCCollectionViewCommon: UICollectionViewDelegate {
             // ---------------
 
             if metadata.isImage || metadata.isAudioOrVideo {
-                let metadatas = self.dataSource.getMetadatas()
-                let ocIds = metadatas.filter { $0.classFile == NKTypeClassFile.image.rawValue ||
-                    $0.classFile == NKTypeClassFile.video.rawValue ||
-                    $0.classFile == NKTypeClassFile.audio.rawValue }.map(\.ocId)
+                let ocIds = self.dataSource.getOcIds(classFiles: [NKTypeClassFile.image.rawValue,
+                                                                  NKTypeClassFile.video.rawValue,
+                                                                  NKTypeClassFile.audio.rawValue])
 
                 if let vc = await NCViewer().getViewerController(metadata: metadata, ocIds: withOcIds ? ocIds : nil, image: image, delegate: self, viewerTransitionSource: viewerTransitionSource) {
                     self.navigationController?.pushViewController(vc, animated: true)
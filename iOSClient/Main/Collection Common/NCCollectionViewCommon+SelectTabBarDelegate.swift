@@ -9,10 +9,11 @@ import LucidBanner
 
 extension NCCollectionViewCommon: NCCollectionViewCommonSelectTabBarDelegate {
     func selectAll() {
-        if !fileSelect.isEmpty, self.dataSource.getMetadatas().count == fileSelect.count {
+        let ocIds = self.dataSource.getOcIds()
+        if !fileSelect.isEmpty, ocIds.count == fileSelect.count {
             fileSelect = []
         } else {
-            fileSelect = self.dataSource.getMetadatas().compactMap({ $0.ocId })
+            fileSelect = ocIds
         }
         tabBarSelect?.update(fileSelect: fileSelect, metadatas: getSelectedMetadatas(), userId: session.userId)
         self.collectionView.reloadData()
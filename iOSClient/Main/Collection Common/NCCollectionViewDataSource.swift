@@ -17,6 +17,7 @@ class NCCollectionViewDataSource: NSObject {
     private var searchResults: [NKSearchResult]?
     private var providers: [NKSearchProvider]?
     private var metadatas: [tableMetadata] = []
+    private var listing: NCMetadataListing?
     private var metadatasForSection: [NCMetadataForSection] = []
     private var layoutForView: NCDBLayoutForView?
     private var directoryOnTop: Bool = true
@@ -49,6 +50,21 @@ class NCCollectionViewDataSource: NSObject {
         }
     }
 
+    /// Directory listing backed by a columnar snapshot, the full metadata is read only for the cells shown
+    init(listing: NCMetadataListing,
+         layoutForView: NCDBLayoutForView? = nil,
+         account: String? = nil) {
+        super.init()
+        removeAll()
+
+        self.listing = listing
+        self.layoutForView = layoutForView
+        if let account {
+            self.directoryOnTop = NCPreferences().getDirectoryOnTop(account: account)
+            self.favoriteOnTop = NCPreferences().getFavoriteOnTop(account: account)
+        }
+    }
+
     // MARK: -
 
     func getGetServerData() -> Bool {
@@ -72,6 +88,7 @@ class NCCollectionViewDataSource: NSObject {
         self.searchResults?.removeAll()
         self.providers?.removeAll()
         self.metadatas.removeAll()
+        self.listing = nil
         self.metadatasForSection.removeAll()
     }
 
@@ -177,11 +194,35 @@ class NCCollectionViewDataSource: NSObject {
 
     // MARK: -
 
+    /// All the metadatas, a listing reads them in full: prefer `getOcIds` or `getDirectoryMetadatas`
     func getMetadatas() -> [tableMetadata] {
+        if let listing {
+            return listing.metadatas()
+        }
         return self.metadatas
     }
 
+    func getOcIds(classFiles: Set<String>? = nil) -> [String] {
+        if let listing {
+            return classFiles.map { listing.ocIds(classFiles: $0) } ?? listing.ocIds
+        }
+        guard let classFiles else {
+            return self.metadatas.map(\.ocId)
+        }
+        return self.metadatas.filter { classFiles.contains($0.classFile) }.map(\.ocId)
+    }
+
+    func getDirectoryMetadatas() -> [tableMetadata] {
+        if let listing {
+            return listing.metadatas(at: listing.flags.indices.filter { listing.flags[$0].contains(.directory) })
+        }
+        return self.metadatas.filter { $0.directory }
+    }
+
     func isEmpty() -> Bool {
+        if let listing {
+            return listing.isEmpty
+        }
         return self.metadatas.isEmpty
     }
 
@@ -190,6 +231,10 @@ class NCCollectionViewDataSource: NSObject {
             return nil
         }
 
+        if let listing {
+            return listing.index(ocId: ocId).map { IndexPath(row: $0, section: 0) }
+        }
+
         if let rowIndex = metadatas.firstIndex(where: {$0.ocId == ocId}) {
             return IndexPath(row: rowIndex, section: 0)
         }
@@ -207,7 +252,7 @@ class NCCollectionViewDataSource: NSObject {
 
     func numberOfItemsInSection(_ section: Int) -> Int {
         if self.sections.isEmpty {
-            return metadatas.count
+            return listing?.count ?? metadatas.count
         }
 
         guard !self.metadatas.isEmpty,
@@ -234,6 +279,9 @@ class NCCollectionViewDataSource: NSObject {
     }
 
     func getFooterInformation() -> (directories: Int, files: Int, size: Int64) {
+        if let listing {
+            return listing.footerInformation()
+        }
         let directories = metadatas.filter({ $0.directory == true})
         let files = metadatas.filter({ $0.directory == false})
         var size: Int64 = 0
@@ -245,7 +293,18 @@ class NCCollectionViewDataSource: NSObject {
         return (directories.count, files.count, size)
     }
 
+    /// Reads ahead the metadatas of the rows about to be shown, for a listing
+    func prefetch(indexPaths: [IndexPath]) {
+        guard self.sections.isEmpty, let listing else {
+            return
+        }
+        listing.prefetch(indexPaths.map { $0.row })
+    }
+
     func getResultMetadata(indexPath: IndexPath) -> tableMetadata? {
+        if let listing {
+            return listing.metadata(at: indexPath.row)
+        }
         if indexPath.row < metadatas.count {
             return metadatas[indexPath.row]
         }
@@ -259,6 +318,8 @@ class NCCollectionViewDataSource: NSObject {
                indexPath.row < metadataForSection.metadatas.count {
                 return metadataForSection.metadatas[indexPath.row].detachedCopy()
             }
+        } else if let listing {
+            return listing.metadata(at: indexPath.row)?.detachedCopy()
         } else if indexPath.row < self.metadatas.count {
             let metadata = self.metadatas[indexPath.row]
             return metadata
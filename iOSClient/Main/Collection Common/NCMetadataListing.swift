@@ -0,0 +1,350 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import NextcloudKit
+
+/// Immutable snapshot of a directory listing, stored one array per column.
+///
+/// The Realm read copies only the columns the list orders and counts on (ocId, name, size, date, etag,
+/// class and flags) instead of detaching a whole `tableMetadata` for every row. The rows are then normalized
+/// and ordered off the database queue, the same way `NCMetadataForSection` does it. A row's full metadata
+/// is read only when a cell asks for it, `materializeBlock` rows at a time, and is kept in a bounded
+/// cache. The class of the file repeats across rows, so it is interned; ocId, name and etag are unique per row.
+final class NCMetadataListing: @unchecked Sendable {
+    struct Flags: OptionSet, Sendable {
+        let rawValue: UInt8
+
+        static let directory = Flags(rawValue: 1 << 0)
+        static let favorite = Flags(rawValue: 1 << 1)
+        static let e2eEncrypted = Flags(rawValue: 1 << 2)
+        static let inSession = Flags(rawValue: 1 << 3)
+        static let livePhoto = Flags(rawValue: 1 << 4)
+        /// Live Photo image whose paired video is not in the listing, the reference is cleared when materialized
+        static let livePhotoBroken = Flags(rawValue: 1 << 5)
+    }
+
+    /// Columns read from Realm in database order, not yet normalized
+    struct Columns {
+        fileprivate var ocIds: [String] = []
+        fileprivate var fileNames: [String] = []
+        fileprivate var sizes: [Int64] = []
+        fileprivate var dates: [TimeInterval] = []
+        fileprivate var etags: [String] = []
+        fileprivate var flags: [Flags] = []
+        fileprivate var classFiles: [UInt16] = []
+        fileprivate var classFileValues: [String] = []
+        fileprivate var fileIds: [String] = []
+        fileprivate var livePhotoFiles: [String] = []
+        private var classFileIndexes: [String: UInt16] = [:]
+
+        init() {}
+
+        init<S: Sequence>(_ metadatas: S) where S.Element == tableMetadata {
+            let rootFileName = NextcloudKit.shared.nkCommonInstance.rootFileName
+            let count = metadatas.underestimatedCount
+
+            ocIds.reserveCapacity(count)
+            fileNames.reserveCapacity(count)
+            sizes.reserveCapacity(count)
+            dates.reserveCapacity(count)
+            etags.reserveCapacity(count)
+            flags.reserveCapacity(count)
+            classFiles.reserveCapacity(count)
+            fileIds.reserveCapacity(count)
+            livePhotoFiles.reserveCapacity(count)
+
+            for metadata in metadatas where metadata.fileName != rootFileName {
+                append(metadata)
+            }
+        }
+
+        var count: Int {
+            ocIds.count
+        }
+
+        mutating func append(_ metadata: tableMetadata) {
+            var flags: Flags = []
+            if metadata.directory {
+                flags.insert(.directory)
+            }
+            if metadata.favorite {
+                flags.insert(.favorite)
+            }
+            if metadata.e2eEncrypted {
+                flags.insert(.e2eEncrypted)
+            }
+            if !metadata.session.isEmpty {
+                flags.insert(.inSession)
+            }
+
+            let livePhotoFile = metadata.livePhotoFile
+            if !livePhotoFile.isEmpty {
+                flags.insert(.livePhoto)
+            }
+
+            ocIds.append(metadata.ocId)
+            fileNames.append(metadata.fileNameView)
+            sizes.append(metadata.size)
+            dates.append((metadata.date as Date).timeIntervalSinceReferenceDate)
+            etags.append(metadata.etag)
+            self.flags.append(flags)
+            classFiles.append(intern(classFile: metadata.classFile))
+            fileIds.append(metadata.fileId)
+            livePhotoFiles.append(livePhotoFile)
+        }
+
+        private mutating func intern(classFile: String) -> UInt16 {
+            if let index = classFileIndexes[classFile] {
+                return index
+            }
+            let index = UInt16(classFileValues.count)
+            classFileValues.append(classFile)
+            classFileIndexes[classFile] = index
+            return index
+        }
+    }
+
+    /// Reads the full metadatas of the given ocIds
+    typealias Loader = @Sendable ([String]) -> [tableMetadata]
+
+    static let materializeBlock = 64
+
+    let ocIds: [String]
+    let fileNames: [String]
+    let sizes: [Int64]
+    let dates: [TimeInterval]
+    let etags: [String]
+    let flags: [Flags]
+    private let classFiles: [UInt16]
+    private let classFileValues: [String]
+
+    private let loader: Loader
+    private let cache = NSCache<NSString, tableMetadata>()
+    private let lock = NSLock()
+    private var countMaterialized = 0
+    // Row of every ocId, built on the first lookup
+    private var rowsByOcId: [String: Int]?
+
+    /// Normalizes the Live Photos, drops the rows replaced by an upload in progress and orders the rows:
+    /// favorite directories, favorite files, directories, files, each sorted by `sort`.
+    init(columns: Columns,
+         sort: String,
+         ascending: Bool,
+         favoriteOnTop: Bool,
+         directoryOnTop: Bool,
+         loader: @escaping Loader = NCMetadataListing.databaseLoader) {
+        var flags = columns.flags
+        let videoIndex = columns.classFileValues.firstIndex(of: NKTypeClassFile.video.rawValue).map { UInt16($0) }
+        let imageIndex = columns.classFileValues.firstIndex(of: NKTypeClassFile.image.rawValue).map { UInt16($0) }
+        let hasLivePhotos = flags.contains { $0.contains(.livePhoto) }
+        let allFileIds = hasLivePhotos ? Set(columns.fileIds) : []
+
+        var fileNamesInSession: Set<String> = []
+        for index in 0..<columns.count where flags[index].contains(.inSession) {
+            fileNamesInSession.insert(columns.fileNames[index])
+        }
+
+        var rows: [Int] = []
+        rows.reserveCapacity(columns.count)
+
+        for index in 0..<columns.count {
+            if flags[index].contains(.livePhoto) {
+                if columns.classFiles[index] == videoIndex {
+                    // The video of a Live Photo is shown through its image, an orphan one is not shown
+                    continue
+                }
+                if columns.classFiles[index] == imageIndex, !allFileIds.contains(columns.livePhotoFiles[index]) {
+                    flags[index].remove(.livePhoto)
+                    flags[index].insert(.livePhotoBroken)
+                }
+            }
+            // Upload [REPLACE] skip
+            if !flags[index].contains(.inSession), fileNamesInSession.contains(columns.fileNames[index]) {
+                continue
+            }
+            rows.append(index)
+        }
+
+        switch sort {
+        case "none", "":
+            break
+        case "date":
+            rows.sort { ascending ? columns.dates[$0] < columns.dates[$1] : columns.dates[$0] > columns.dates[$1] }
+        case "size":
+            rows.sort { ascending ? columns.sizes[$0] < columns.sizes[$1] : columns.sizes[$0] > columns.sizes[$1] }
+        default:
+            // Same order as `sortedMetadata` (Finder-like: case-insensitive, numbers by value); the names
+            // are bridged to NSString once per row instead of twice per comparison
+            var keys = [NSString](repeating: "", count: columns.count)
+            for index in rows {
+                keys[index] = columns.fileNames[index] as NSString
+            }
+            rows.sort {
+                let result = keys[$0].localizedStandardCompare(keys[$1] as String)
+                return ascending ? result == .orderedAscending : result == .orderedDescending
+            }
+        }
+
+        // Struct view : favorite dir -> favorite file -> directory -> files
+        var groups: [[Int]] = [[], [], [], []]
+        for index in rows {
+            let isDirectory = flags[index].contains(.directory)
+            if favoriteOnTop && flags[index].contains(.favorite) {
+                groups[isDirectory ? 0 : 1].append(index)
+            } else if directoryOnTop && isDirectory {
+                groups[2].append(index)
+            } else {
+                groups[3].append(index)
+            }
+        }
+        rows = groups.flatMap { $0 }
+
+        self.ocIds = rows.map { columns.ocIds[$0] }
+        self.fileNames = rows.map { columns.fileNames[$0] }
+        self.sizes = rows.map { columns.sizes[$0] }
+        self.dates = rows.map { columns.dates[$0] }
+        self.etags = rows.map { columns.etags[$0] }
+        self.flags = rows.map { flags[$0] }
+        self.classFiles = rows.map { columns.classFiles[$0] }
+        self.classFileValues = columns.classFileValues
+        self.loader = loader
+
+        cache.countLimit = Self.materializeBlock * 16
+    }
+
+    /// Cells ask from the main thread, which must not wait for the database queue
+    static let databaseLoader: Loader = { ocIds in
+        if Thread.isMainThread {
+            return NCManageDatabase.shared.getMetadatasOnCurrentThread(ocIds: ocIds)
+        }
+        return NCManageDatabase.shared.getMetadatas(predicate: NSPredicate(format: "ocId IN %@", ocIds))
+    }
+
+    // MARK: -
+
+    var count: Int {
+        ocIds.count
+    }
+
+    var isEmpty: Bool {
+        ocIds.isEmpty
+    }
+
+    func classFile(at index: Int) -> String {
+        classFileValues[Int(classFiles[index])]
+    }
+
+    func index(ocId: String) -> Int? {
+        lock.lock()
+        defer { lock.unlock() }
+        if rowsByOcId == nil {
+            rowsByOcId = Dictionary(zip(ocIds, ocIds.indices)) { first, _ in first }
+        }
+        return rowsByOcId?[ocId]
+    }
+
+    func ocIds(classFiles: Set<String>) -> [String] {
+        ocIds.indices.compactMap { classFiles.contains(classFile(at: $0)) ? ocIds[$0] : nil }
+    }
+
+    func footerInformation() -> (directories: Int, files: Int, size: Int64) {
+        var directories = 0
+        var size: Int64 = 0
+
+        for index in ocIds.indices {
+            if flags[index].contains(.directory) {
+                directories += 1
+            } else {
+                size += sizes[index]
+            }
+        }
+
+        return (directories, count - directories, size)
+    }
+
+    /// Number of rows read in full from the database
+    var materialized: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return countMaterialized
+    }
+
+    // MARK: -
+
+    /// The full metadata of a row, read with the rows of its block when not cached. Nil if the row
+    /// no longer exists in the database.
+    func metadata(at index: Int) -> tableMetadata? {
+        guard ocIds.indices.contains(index) else {
+            return nil
+        }
+        if let metadata = cache.object(forKey: ocIds[index] as NSString) {
+            return metadata
+        }
+
+        let start = index / Self.materializeBlock * Self.materializeBlock
+        let materialized = materialize(start..<min(start + Self.materializeBlock, count))
+        return materialized[ocIds[index]]
+    }
+
+    /// Reads the blocks of the given rows off the main thread, so that `metadata(at:)` finds them cached
+    func prefetch(_ indexes: [Int]) {
+        let starts = Set(indexes
+            .filter { ocIds.indices.contains($0) && cache.object(forKey: ocIds[$0] as NSString) == nil }
+            .map { $0 / Self.materializeBlock * Self.materializeBlock })
+        guard !starts.isEmpty else {
+            return
+        }
+
+        Task.detached(priority: .userInitiated) {
+            for start in starts.sorted() {
+                _ = self.materialize(start..<min(start + Self.materializeBlock, self.count))
+            }
+        }
+    }
+
+    /// The full metadatas of the given rows, in the same order, reading only the ones not cached
+    func metadatas(at indexes: [Int]) -> [tableMetadata] {
+        var missing: [Int] = []
+        var found: [String: tableMetadata] = [:]
+
+        for index in indexes where ocIds.indices.contains(index) {
+            if let metadata = cache.object(forKey: ocIds[index] as NSString) {
+                found[ocIds[index]] = metadata
+            } else {
+                missing.append(index)
+            }
+        }
+        if !missing.isEmpty {
+            found.merge(materialize(missing)) { current, _ in current }
+        }
+
+        return indexes.compactMap { ocIds.indices.contains($0) ? found[ocIds[$0]] : nil }
+    }
+
+    /// All the full metadatas in listing order, read in one go. Prefer `metadata(at:)` for what is shown.
+    func metadatas() -> [tableMetadata] {
+        metadatas(at: Array(ocIds.indices))
+    }
+
+    private func materialize<C: Collection>(_ indexes: C) -> [String: tableMetadata] where C.Element == Int {
+        let brokenLivePhotos = Set(indexes.filter { flags[$0].contains(.livePhotoBroken) }.map { ocIds[$0] })
+        let metadatas = loader(indexes.map { ocIds[$0] })
+        var materialized: [String: tableMetadata] = [:]
+
+        for metadata in metadatas {
+            if brokenLivePhotos.contains(metadata.ocId) {
+                metadata.livePhotoFile = ""
+            }
+            materialized[metadata.ocId] = metadata
+            cache.setObject(metadata, forKey: metadata.ocId as NSString)
+        }
+
+        lock.lock()
+        countMaterialized += metadatas.count
+        lock.unlock()
+
+        return materialized
+    }
+}
@@ -0,0 +1,118 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import NextcloudKit
+
+/// Answers "does this file exist on the server" for auto-upload from one depth-1 listing per folder.
+///
+/// The first check in a folder (the granularity path of the auto-upload) lists it and keeps names and etags
+/// in memory; the following checks in the same folder are answered without a request. Concurrent checks of
+/// the same folder share the listing. A listing expires after `lifetime`, and a conflict on upload drops it
+/// so the next check lists the folder again.
+actor NCRemoteExistenceResolver {
+    static let shared = NCRemoteExistenceResolver()
+
+    struct Statistics {
+        let listings: Int
+        let checks: Int
+        let fallbacks: Int
+
+        /// PROPFIND requests avoided compared to one request per file
+        var saved: Int {
+            max(0, checks - listings - fallbacks)
+        }
+    }
+
+    private struct Listing {
+        /// File name → etag, nil when the folder does not exist
+        let files: [String: String]?
+        let date: Date
+    }
+
+    private var listings: [String: Listing] = [:]
+    private var pending: [String: Task<Listing?, Never>] = [:]
+    private var countListings = 0
+    private var countChecks = 0
+    private var countFallbacks = 0
+
+    private let lifetime: TimeInterval = 300
+    private let notFound = NKError(errorCode: 404, errorDescription: "Not Found")
+
+    // MARK: -
+
+    /// Same result as `NCNetworking.fileExists`: success when the file exists, 404 when it does not,
+    /// the error of the request otherwise.
+    func fileExists(serverUrl: String, fileName: String, account: String) async -> NKError {
+        countChecks += 1
+
+        guard let listing = await listing(serverUrl: serverUrl, account: account) else {
+            countFallbacks += 1
+            return await NCNetworking.shared.fileExists(serverUrlFileName: serverUrl + "/" + fileName, account: account)
+        }
+
+        return listing.files?[fileName] != nil ? .success : notFound
+    }
+
+    /// Drops the listing of the folder, the server changed in a way the listing does not know
+    func invalidate(serverUrl: String, account: String) {
+        listings.removeValue(forKey: account + "|" + serverUrl)
+    }
+
+    func statistics() -> Statistics {
+        Statistics(listings: countListings, checks: countChecks, fallbacks: countFallbacks)
+    }
+
+    // MARK: -
+
+    private func listing(serverUrl: String, account: String) async -> Listing? {
+        let key = account + "|" + serverUrl
+
+        if let listing = listings[key], Date().timeIntervalSince(listing.date) < lifetime {
+            return listing
+        }
+        if let task = pending[key] {
+            return await task.value
+        }
+
+        countListings += 1
+        let task = Task<Listing?, Never> {
+            let results = await NextcloudKit.shared.readFileOrFolderAsync(serverUrlFileName: serverUrl,
+                                                                          depth: "1",
+                                                                          showHiddenFiles: true,
+                                                                          account: account) { task in
+                Task {
+                    let identifier = await NCNetworking.shared.networkingTasks.createIdentifier(account: account,
+                                                                                                path: serverUrl,
+                                                                                                name: "readFileOrFolder")
+                    await NCNetworking.shared.networkingTasks.track(identifier: identifier, task: task)
+                }
+            }
+
+            if results.error.errorCode == 404 {
+                return Listing(files: nil, date: Date())
+            }
+            guard results.error == .success, let files = results.files else {
+                return nil
+            }
+
+            var names: [String: String] = [:]
+            names.reserveCapacity(files.count)
+            // The first entry is the folder itself
+            for file in files.dropFirst() {
+                names[file.fileName] = file.etag
+            }
+            return Listing(files: names, date: Date())
+        }
+
+        pending[key] = task
+        let listing = await task.value
+        pending.removeValue(forKey: key)
+        if let listing {
+            listings[key] = listing
+        }
+
+        return listing
+    }
+}
@@ -0,0 +1,295 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import NextcloudKit
+
+/// Append-only journal of the transfers in progress.
+///
+/// Every transfer task appends a start record (ocId, session, task identifier), progress checkpoints and an
+/// end record, one JSON line each. After a relaunch the journal is replayed to the transfers still active,
+/// so recovery looks only at them instead of matching every metadata against the URLSession task lists:
+/// a foreground task of a previous launch died with its process, a background task is verified against its
+/// session only after a relaunch or when it makes no progress for `stallInterval`. The in-progress metadatas
+/// missing from the journal are still checked, once per `unjournaledInterval`. The file is compacted to
+/// the active transfers when ended ones dominate it.
+actor NCTransferJournal {
+    static let shared = NCTransferJournal(url: URL(fileURLWithPath: NCUtilityFileSystem().directoryGroup).appendingPathComponent("TransferJournal.jsonl"))
+
+    struct Entry: Sendable {
+        let ocId: String
+        let account: String
+        let session: String
+        let serverUrlFileName: String
+        let taskIdentifier: Int
+        let launch: String
+        var lastActivity: Date
+        var bytes: Int64
+    }
+
+    struct Statistics {
+        let active: Int
+        let records: Int
+        let compactions: Int
+        /// Records read and time taken to replay the journal at launch
+        let replayedRecords: Int
+        let replayTime: TimeInterval
+        /// Transfers released by the recoveries and time of the last one
+        let released: Int
+        let recoveryTime: TimeInterval
+    }
+
+    private struct Record: Codable {
+        enum Kind: String, Codable {
+            case start
+            case checkpoint
+            case end
+        }
+
+        let kind: Kind
+        let ocId: String
+        let date: Date
+        var account: String?
+        var session: String?
+        var serverUrlFileName: String?
+        var taskIdentifier: Int?
+        var launch: String?
+        var bytes: Int64?
+    }
+
+    /// Identifier of this process, a foreground task of another launch is gone
+    let launch: String
+    let stallInterval: TimeInterval
+    let unjournaledInterval: TimeInterval
+    private let url: URL
+    private let checkpointInterval: TimeInterval = 10
+
+    private var entries: [String: Entry] = [:]
+    private var ocIdByServerUrlFileName: [String: String] = [:]
+    private var lastCheckpoint: [String: Date] = [:]
+    private var fileHandle: FileHandle?
+    private var isLoaded = false
+    private var lastUnjournaledCheck: Date = .distantPast
+
+    private var countRecords = 0
+    private var countCompactions = 0
+    private var countReplayed = 0
+    private var countReleased = 0
+    private var replayTime: TimeInterval = 0
+    private var recoveryTime: TimeInterval = 0
+
+    private let encoder = JSONEncoder()
+    private let decoder = JSONDecoder()
+
+    init(url: URL, launch: String = UUID().uuidString, stallInterval: TimeInterval = 120, unjournaledInterval: TimeInterval = 60) {
+        self.url = url
+        self.launch = launch
+        self.stallInterval = stallInterval
+        self.unjournaledInterval = unjournaledInterval
+    }
+
+    // MARK: -
+
+    func start(ocId: String, account: String, session: String, serverUrlFileName: String, taskIdentifier: Int, now: Date = Date()) {
+        loadIfNeeded()
+
+        let entry = Entry(ocId: ocId,
+                          account: account,
+                          session: session,
+                          serverUrlFileName: serverUrlFileName,
+                          taskIdentifier: taskIdentifier,
+                          launch: launch,
+                          lastActivity: now,
+                          bytes: entries[ocId]?.bytes ?? 0)
+        apply(entry)
+        append(Record(kind: .start, ocId: ocId, date: now, account: account, session: session, serverUrlFileName: serverUrlFileName, taskIdentifier: taskIdentifier, launch: launch))
+    }
+
+    /// Progress of the transfers, written at most once per `checkpointInterval` for each of them
+    func checkpoint(serverUrlFileName: String, bytes: Int64, now: Date = Date()) {
+        loadIfNeeded()
+
+        guard let ocId = ocIdByServerUrlFileName[serverUrlFileName] else {
+            return
+        }
+
+        entries[ocId]?.lastActivity = now
+        entries[ocId]?.bytes = bytes
+
+        if let date = lastCheckpoint[ocId], now.timeIntervalSince(date) < checkpointInterval {
+            return
+        }
+        lastCheckpoint[ocId] = now
+        append(Record(kind: .checkpoint, ocId: ocId, date: now, bytes: bytes))
+    }
+
+    func end(ocId: String, now: Date = Date()) {
+        loadIfNeeded()
+
+        guard let entry = entries.removeValue(forKey: ocId) else {
+            return
+        }
+        ocIdByServerUrlFileName.removeValue(forKey: entry.serverUrlFileName)
+        lastCheckpoint.removeValue(forKey: ocId)
+        append(Record(kind: .end, ocId: ocId, date: now))
+
+        compactIfNeeded()
+    }
+
+    func isActive(ocId: String) -> Bool {
+        loadIfNeeded()
+        return entries[ocId] != nil
+    }
+
+    /// The active transfers whose task may be gone: all those of a previous launch, and the background
+    /// ones of this launch without activity for `stallInterval`. A foreground task of this launch always
+    /// ends through the request awaiting it.
+    func entriesToVerify(foregroundSessions: Set<String>, now: Date = Date()) -> [Entry] {
+        loadIfNeeded()
+
+        return entries.values.filter { entry in
+            if entry.launch != launch {
+                return true
+            }
+            return !foregroundSessions.contains(entry.session) && now.timeIntervalSince(entry.lastActivity) >= stallInterval
+        }
+    }
+
+    /// True at most once per `unjournaledInterval`, when the recovery also looks at the metadatas not in the
+    /// journal: started by a previous version, by an extension or by a path that does not journal its task
+    func claimUnjournaledCheck(now: Date = Date()) -> Bool {
+        guard now.timeIntervalSince(lastUnjournaledCheck) >= unjournaledInterval else {
+            return false
+        }
+        lastUnjournaledCheck = now
+        return true
+    }
+
+    /// A background task verified alive, it is verified again after `stallInterval` without progress
+    func verified(ocId: String, now: Date = Date()) {
+        entries[ocId]?.lastActivity = now
+    }
+
+    func recovered(released: Int, duration: TimeInterval) {
+        countReleased += released
+        recoveryTime = duration
+    }
+
+    func statistics() -> Statistics {
+        loadIfNeeded()
+
+        return Statistics(active: entries.count,
+                          records: countRecords,
+                          compactions: countCompactions,
+                          replayedRecords: countReplayed,
+                          replayTime: replayTime,
+                          released: countReleased,
+                          recoveryTime: recoveryTime)
+    }
+
+    // MARK: -
+
+    private func apply(_ entry: Entry) {
+        if let previous = entries[entry.ocId], previous.serverUrlFileName != entry.serverUrlFileName {
+            ocIdByServerUrlFileName.removeValue(forKey: previous.serverUrlFileName)
+        }
+        entries[entry.ocId] = entry
+        ocIdByServerUrlFileName[entry.serverUrlFileName] = entry.ocId
+    }
+
+    private func loadIfNeeded() {
+        guard !isLoaded else {
+            return
+        }
+        isLoaded = true
+
+        let date = Date()
+        if let data = try? Data(contentsOf: url) {
+            for line in data.split(separator: UInt8(ascii: "\n")) {
+                // A line cut by a crash is skipped
+                guard let record = try? decoder.decode(Record.self, from: Data(line)) else {
+                    continue
+                }
+                countReplayed += 1
+                replay(record)
+            }
+        }
+        countRecords = countReplayed
+        replayTime = Date().timeIntervalSince(date)
+    }
+
+    private func replay(_ record: Record) {
+        switch record.kind {
+        case .start:
+            apply(Entry(ocId: record.ocId,
+                        account: record.account ?? "",
+                        session: record.session ?? "",
+                        serverUrlFileName: record.serverUrlFileName ?? "",
+                        taskIdentifier: record.taskIdentifier ?? 0,
+                        launch: record.launch ?? "",
+                        lastActivity: record.date,
+                        bytes: entries[record.ocId]?.bytes ?? 0))
+        case .checkpoint:
+            entries[record.ocId]?.lastActivity = record.date
+            entries[record.ocId]?.bytes = record.bytes ?? 0
+        case .end:
+            if let entry = entries.removeValue(forKey: record.ocId) {
+                ocIdByServerUrlFileName.removeValue(forKey: entry.serverUrlFileName)
+            }
+        }
+    }
+
+    private func append(_ record: Record) {
+        guard var data = try? encoder.encode(record) else {
+            return
+        }
+        data.append(UInt8(ascii: "\n"))
+
+        if fileHandle == nil {
+            if !FileManager.default.fileExists(atPath: url.path) {
+                FileManager.default.createFile(atPath: url.path, contents: nil)
+            }
+            fileHandle = try? FileHandle(forWritingTo: url)
+        }
+
+        do {
+            try fileHandle?.seekToEnd()
+            try fileHandle?.write(contentsOf: data)
+            countRecords += 1
+        } catch {
+            nkLog(error: "Transfer journal write: \(error.localizedDescription)")
+        }
+    }
+
+    /// Rewrites the journal with one start and one checkpoint per active transfer
+    private func compactIfNeeded() {
+        guard countRecords > 256, countRecords > entries.count * 4 else {
+            return
+        }
+
+        var data = Data()
+        var records = 0
+        for entry in entries.values {
+            let start = Record(kind: .start, ocId: entry.ocId, date: entry.lastActivity, account: entry.account, session: entry.session, serverUrlFileName: entry.serverUrlFileName, taskIdentifier: entry.taskIdentifier, launch: entry.launch)
+            let checkpoint = Record(kind: .checkpoint, ocId: entry.ocId, date: entry.lastActivity, bytes: entry.bytes)
+            for record in [start, checkpoint] {
+                if let line = try? encoder.encode(record) {
+                    data.append(line)
+                    data.append(UInt8(ascii: "\n"))
+                    records += 1
+                }
+            }
+        }
+
+        try? fileHandle?.close()
+        fileHandle = nil
+        do {
+            try data.write(to: url, options: .atomic)
+            countRecords = records
+            countCompactions += 1
+        } catch {
+            nkLog(error: "Transfer journal compaction: \(error.localizedDescription)")
+        }
+    }
+}
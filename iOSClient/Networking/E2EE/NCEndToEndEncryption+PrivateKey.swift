@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+
+extension NCEndToEndEncryption {
+    /// Thread-safe flag polled by the Objective-C unlock between the PBKDF2 derivations.
+    private final class UnlockCancellation: @unchecked Sendable {
+        private let lock = NSLock()
+        private var cancelled = false
+
+        var isCancelled: Bool {
+            lock.lock()
+            defer { lock.unlock() }
+            return cancelled
+        }
+
+        func cancel() {
+            lock.lock()
+            cancelled = true
+            lock.unlock()
+        }
+    }
+
+    /// Decrypts the server-stored private key off the caller's thread.
+    ///
+    /// PBKDF2 takes seconds on older devices, so it must never run on the main actor.
+    /// Cancelling the task stops before the next derivation and throws `CancellationError`.
+    ///
+    /// - Returns: The decrypted private key payload (base64 of the PEM), or `nil` for a wrong passphrase.
+    func decryptPrivateKeyAsync(_ privateKey: String, passphrase: String) async throws -> Data? {
+        let cancellation = UnlockCancellation()
+
+        let data: Data? = await withTaskCancellationHandler {
+            await withCheckedContinuation { continuation in
+                DispatchQueue.global(qos: .userInitiated).async {
+                    let data = self.decryptPrivateKey(privateKey, passphrase: passphrase) {
+                        cancellation.isCancelled
+                    }
+                    continuation.resume(returning: data)
+                }
+            }
+        } onCancel: {
+            cancellation.cancel()
+        }
+
+        try Task.checkCancellation()
+        return data
+    }
+}
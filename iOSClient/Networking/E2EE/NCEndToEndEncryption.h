@@ -7,11 +7,43 @@
 
 @class tableMetadata;
 
+// A file to encrypt or decrypt with processFileJobs:maxConcurrent:
+// key, initializationVector and authenticationTag are base64 as in the rest of the API;
+// when encrypting, missing key/initializationVector are generated and authenticationTag is filled in.
+@interface NCEndToEndFileJob : NSObject
+
+@property (nonatomic) BOOL decrypt;
+@property (nonatomic, strong) NSString *fileName;
+@property (nonatomic, strong) NSString *fileNameDestination;
+@property (nonatomic, strong) NSString *key;
+@property (nonatomic, strong) NSString *initializationVector;
+@property (nonatomic, strong) NSString *authenticationTag;
+@property (nonatomic) BOOL success;
+@property (nonatomic, strong) id userInfo;
+
+@end
+
+// One metadata signature of a batch: signature is the DER CMS, data the signed payload,
+// certificates the PEM of the users allowed to sign
+@interface NCEndToEndSignatureJob : NSObject
+
+@property (nonatomic, strong) NSData *signature;
+@property (nonatomic, strong) NSData *data;
+@property (nonatomic, strong) NSArray<NSString *> *certificates;
+@property (nonatomic) BOOL verified;
+@property (nonatomic) BOOL signerMatched;
+@property (nonatomic, strong) id userInfo;
+
+@end
+
 @interface NCEndToEndEncryption : NSObject
 
 @property (nonatomic, strong) NSString *generatedPublicKey;
 @property (nonatomic, strong) NSString *generatedPrivateKey;
 
+// Block size in bytes used to encrypt/decrypt files (0 = NC_E2EE_FILE_BLOCK_SIZE_DEFAULT, clamped to 16 KiB ... 16 MiB)
+@property (nonatomic) NSUInteger fileBlockSize;
+
 + (instancetype)shared;
 
 // Certificate
@@ -19,6 +51,9 @@
 - (NSString *)createCSR:(NSString *)userId directory:(NSString *)directory;
 - (NSString *)encryptPrivateKey:(NSString *)userId directory: (NSString *)directory passphrase:(NSString *)passphrase privateKey:(NSString **)privateKey;
 - (NSData *)decryptPrivateKey:(NSString *)privateKey passphrase:(NSString *)passphrase;
+// `isCancelled` is polled between the key derivations; the derived key is cached for the app session
+- (NSData *)decryptPrivateKey:(NSString *)privateKey passphrase:(NSString *)passphrase isCancelled:(BOOL (^)(void))isCancelled;
+- (void)invalidateDerivedKeyCache;
 
 // Verify X.509 certificate
 - (BOOL)verifyCertificate:(NSString *)certificate PublicKey:(NSString *)publicKey;
@@ -36,16 +71,34 @@
 - (NSData *)encryptAsymmetricData:(NSData *)plainData  privateKey:(NSString *)privateKey;
 - (NSData *)decryptAsymmetricData:(NSData *)cipherData privateKey:(NSString *)privateKey;
 
+// Parsed key cache: certificates and private keys are parsed once and kept (bounded) by SHA-256 of the PEM
+// invalidateKeyCache also drops the derived private key unlock keys
+
+- (void)invalidateKeyCache;
+- (void)invalidateKeyCacheForPEM:(NSString *)pem;
+- (NSDictionary<NSString *, NSNumber *> *)keyCacheStatistics;
+
 // Encrypt / Decrypt file
 
 - (BOOL)encryptFile:(NSString *)fileName fileNameIdentifier:(NSString *)fileNameIdentifier directory:(NSString *)directory key:(NSString **)key initializationVector:(NSString **)initializationVector authenticationTag:(NSString **)authenticationTag;
+// Same, also returning the SHA-256 (hex) of the plaintext and of the uploaded [ciphertext || tag], computed while encrypting
+- (BOOL)encryptFile:(NSString *)fileName fileNameIdentifier:(NSString *)fileNameIdentifier directory:(NSString *)directory key:(NSString **)key initializationVector:(NSString **)initializationVector authenticationTag:(NSString **)authenticationTag checksumPlain:(NSString **)checksumPlain checksumCipher:(NSString **)checksumCipher;
+- (NSArray<NSNumber *> *)encryptFile:(NSString *)fileName fileNameIdentifier:(NSString *)fileNameIdentifier directory:(NSString *)directory chunkSize:(int64_t)chunkSize key:(NSString **)key initializationVector:(NSString **)initializationVector authenticationTag:(NSString **)authenticationTag;
 - (BOOL)decryptFile:(NSString *)fileName fileNameView:(NSString *)fileNameView ocId:(NSString *)ocId userId:(NSString *)userId urlBase:(NSString *)urlBase key:(NSString *)key initializationVector:(NSString *)initializationVector authenticationTag:(NSString *)authenticationTag;
 
+// Encrypt / Decrypt many files on a bounded pool of workers (maxConcurrent 0 = online CPUs), returns the number of succeeded jobs
+
+- (NSInteger)processFileJobs:(NSArray<NCEndToEndFileJob *> *)jobs maxConcurrent:(NSInteger)maxConcurrent;
+
 // Signature CMS
 
 - (NSData *)generateSignatureCMS:(NSData *)data certificate:(NSString *)certificate privateKey:(NSString *)privateKey userId:(NSString *)userId;
 // - (BOOL)verifySignatureCMS:(NSData *)cmsContent data:(NSData *)data publicKey:(NSString *)publicKey userId:(NSString *)userId;
 - (BOOL)verifySignatureCMS:(NSData *)cmsContent data:(NSData *)data certificates:(NSArray*)certificates;
+// signerMatched is YES when the signer is one of the certificates (looked up by SHA-256 fingerprint)
+- (BOOL)verifySignatureCMS:(NSData *)cmsContent data:(NSData *)data certificates:(NSArray*)certificates signerMatched:(BOOL *)signerMatched;
+// Verifies many folder signatures in one call (concurrently on a global queue if requested), returns the number of verified jobs
+- (NSInteger)verifySignatureJobs:(NSArray<NCEndToEndSignatureJob *> *)jobs concurrent:(BOOL)concurrent;
 
 // Utility
 
@@ -53,6 +106,13 @@
 - (NSData *)generateKey;
 - (NSString *)createSHA512:(NSString *)string;
 - (NSString *)createSHA256:(NSData *)data;
+
+// Streaming checksums (hex) of a file, read once in `fileBlockSize` mapped windows, never loaded whole in memory
+
+- (NSString *)createSHA256ForFile:(NSString *)fileName;
+- (NSString *)createSHA512ForFile:(NSString *)fileName;
+- (BOOL)createChecksumsForFile:(NSString *)fileName sha256:(NSString **)sha256 sha512:(NSString **)sha512;
+
 - (NSString *)extractPublicKeyFromCertificate:(NSString *)pemCertificate;
 - (NSString *)extractPublicKeyFromCertificateSigningRequest:(NSString *)pemCSR;
 
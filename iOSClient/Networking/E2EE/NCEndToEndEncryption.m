@@ -4,6 +4,7 @@
 
 
 #import "NCEndToEndEncryption.h"
+#import "NCEndToEndFileCipher.h"
 #import "NCBridgeSwift.h"
 
 #import <CommonCrypto/CommonDigest.h>
@@ -19,6 +20,8 @@
 #define IV_DELIMITER_ENCODED_OLD    @"fA=="
 #define IV_DELIMITER_ENCODED        @"|"
 #define PBKDF2_KEY_LENGTH           256
+#define PBKDF2_ITERATIONS           600000
+#define PBKDF2_ITERATIONS_LEGACY    1024
 //#define PBKDF2_SALT                 @"$4$YmBjm3hk$Qb74D5IUYwghUmzsMqeNFx5z0/8$"
 
 #define ASYMMETRIC_STRING_TEST      @"Nextcloud a safe home for all your data"
@@ -28,8 +31,6 @@
 #define fileNamePrivateKey          @"privateKey.pem"
 #define fileNamePubliceKey          @"publicKey.pem"
 
-#define streamBuffer                1024
-
 #define AES_KEY_128_LENGTH          16
 #define AES_KEY_256_LENGTH          32
 #define AES_IVEC_LENGTH             12
@@ -37,14 +38,59 @@
 #define AES_SALT_LENGTH             40
 #define AES_TAG_LENGTH              16
 
+#define KEY_CACHE_COUNT_LIMIT       256
+
+// Parsed OpenSSL key material owned by the key cache; freed when the last reference goes away.
+// pkey/x509 are inner pointers: callers keep the handle alive (NS_VALID_UNTIL_END_OF_SCOPE) while using them.
+@interface NCEndToEndKeyHandle : NSObject
+@property (nonatomic, readonly) EVP_PKEY *pkey NS_RETURNS_INNER_POINTER;
+@property (nonatomic, readonly) X509 *x509 NS_RETURNS_INNER_POINTER;
+@property (nonatomic, strong) NSData *fingerprint;
+- (instancetype)initWithPKey:(EVP_PKEY *)pkey x509:(X509 *)x509;
+@end
+
+@implementation NCEndToEndKeyHandle
+
+- (instancetype)initWithPKey:(EVP_PKEY *)pkey x509:(X509 *)x509
+{
+    self = [super init];
+    if (self) {
+        _pkey = pkey;
+        _x509 = x509;
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    if (_pkey) EVP_PKEY_free(_pkey);
+    if (_x509) X509_free(_x509);
+}
+
+@end
+
 @interface NCEndToEndEncryption ()
 {
     NSData *_privateKeyData;
     NSData *_publicKeyData;
     NSData *_csrData;
+
+    // Parsed EVP_PKEY / X509 keyed by the SHA-256 of the PEM
+    NSCache<NSString *, NCEndToEndKeyHandle *> *_keyCache;
+    NSUInteger _keyCacheHits;
+    NSUInteger _keyCacheMisses;
+
+    // Derived private key unlock keys (app session only, never persisted), zeroed on invalidation
+    NSMutableDictionary<NSString *, NSMutableData *> *_derivedKeyCache;
 }
 @end
 
+@implementation NCEndToEndFileJob
+@end
+
+@implementation NCEndToEndSignatureJob
+@end
+
 @implementation NCEndToEndEncryption
 
 + (instancetype)shared {
@@ -58,6 +104,17 @@
     return shared;
 }
 
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _keyCache = [NSCache new];
+        _keyCache.countLimit = KEY_CACHE_COUNT_LIMIT;
+        _derivedKeyCache = [NSMutableDictionary new];
+    }
+    return self;
+}
+
 void nk_openssl_load_legacy_provider_if_needed(void) {
     OSSL_PROVIDER *deflt = OSSL_PROVIDER_load(NULL, "default");
     if (!deflt) {
@@ -448,7 +505,7 @@ cleanup:
                          salt.bytes,
                          (int)salt.length,
                          kCCPRFHmacAlgSHA256,
-                         600000,
+                         PBKDF2_ITERATIONS,
                          key.mutableBytes,
                          key.length);
 
@@ -490,14 +547,26 @@ cleanup:
 }
 
 - (NSData *)decryptPrivateKey:(NSString *)privateKey passphrase:(NSString *)passphrase
+{
+    return [self decryptPrivateKey:privateKey passphrase:passphrase isCancelled:nil];
+}
+
+// The stored format tells which derivation to try first:
+// - "fA==" delimiter: written by old clients, always PBKDF2-HMAC-SHA1 / 1024
+// - "|" delimiter: PBKDF2-HMAC-SHA256 / 600000 for current keys, but keys migrated by other clients
+//   can still use the legacy derivation. The legacy one costs ~1/1000 of the current one, so it is
+//   tried first and a wrong guess is only rejected by the GCM tag.
+// A derived key that unlocked the private key is kept in memory, so a second unlock skips PBKDF2.
+- (NSData *)decryptPrivateKey:(NSString *)privateKey passphrase:(NSString *)passphrase isCancelled:(BOOL (^)(void))isCancelled
 {
     NSMutableData *plain = [NSMutableData new];
-    NSMutableData *key = [NSMutableData dataWithLength:PBKDF2_KEY_LENGTH / 8];
+    BOOL legacyDelimiter = NO;
 
     // Split the encrypted private key format: base64(cipher+tag) + IV + salt
     NSArray *cipherArray = [privateKey componentsSeparatedByString:IV_DELIMITER_ENCODED];
     if (cipherArray.count != 3) {
         cipherArray = [privateKey componentsSeparatedByString:IV_DELIMITER_ENCODED_OLD];
+        legacyDelimiter = YES;
         if (cipherArray.count != 3) {
             NSLog(@"Invalid encrypted key format: expected 3 parts");
             return nil;
@@ -525,55 +594,84 @@ cleanup:
     // Clean passphrase from spaces
     passphrase = [passphrase stringByReplacingOccurrencesOfString:@" " withString:@""];
 
-    // Derive AES key using PBKDF2
-    int derivation = CCKeyDerivationPBKDF(kCCPBKDF2,
-                                          passphrase.UTF8String,
-                                          (int)passphrase.length,
-                                          salt.bytes,
-                                          (int)salt.length,
-                                          kCCPRFHmacAlgSHA256,
-                                          600000,
-                                          key.mutableBytes,
-                                          key.length);
-
-    if (derivation != kCCSuccess) {
-        NSLog(@"PBKDF2 key derivation failed: %d", derivation);
-        return nil;
+    NSDate *start = [NSDate date];
+    NSString *cacheKey = [self derivedKeyCacheKey:passphrase salt:salt];
+    NSData *cachedKey;
+    @synchronized (_derivedKeyCache) {
+        cachedKey = [_derivedKeyCache[cacheKey] copy];
+    }
+    if (cachedKey && [self decryptData:cipher plain:&plain key:cachedKey keyLen:AES_KEY_256_LENGTH initializationVector:initializationVector authenticationTag:authenticationTag]) {
+        NSLog(@"[INFO] Private key unlocked with the cached derived key");
+        return plain;
     }
 
-    NSLog(@"🔐 Decrypting private key:");
-    NSLog(@"• Cipher (len=%lu): %@", (unsigned long)cipher.length, cipher);
-    NSLog(@"• Tag (len=%lu): %@", (unsigned long)authenticationTag.length, authenticationTag);
-    NSLog(@"• IV (len=%lu): %@", (unsigned long)initializationVector.length, initializationVector);
-    NSLog(@"• Salt (len=%lu): %@", (unsigned long)salt.length, salt);
+    NSArray<NSNumber *> *algorithms = legacyDelimiter ? @[@(kCCPRFHmacAlgSHA1)] : @[@(kCCPRFHmacAlgSHA1), @(kCCPRFHmacAlgSHA256)];
+    NSMutableData *key = [NSMutableData dataWithLength:PBKDF2_KEY_LENGTH / 8];
+    BOOL success = NO;
 
-    // AES-GCM decryption
-    BOOL success = [self decryptData:cipher plain:&plain key:key keyLen:AES_KEY_256_LENGTH initializationVector:initializationVector authenticationTag:authenticationTag];
+    for (NSNumber *algorithm in algorithms) {
+        if (isCancelled && isCancelled()) {
+            break;
+        }
 
-    if (!success) {
-        // Try OLD format (PBKDF2-HMAC-SHA1 + 1024)
-        derivation = CCKeyDerivationPBKDF(kCCPBKDF2,
-                                          passphrase.UTF8String,
-                                          (int)passphrase.length,
-                                          salt.bytes,
-                                          (int)salt.length,
-                                          kCCPRFHmacAlgSHA1,
-                                          1024,
-                                          key.mutableBytes,
-                                          key.length);
-        if (derivation == kCCSuccess) {
-            success = [self decryptData:cipher plain:&plain key:key keyLen:AES_KEY_256_LENGTH initializationVector:initializationVector authenticationTag:authenticationTag];
+        CCPseudoRandomAlgorithm prf = (CCPseudoRandomAlgorithm)algorithm.unsignedIntValue;
+        uint rounds = prf == kCCPRFHmacAlgSHA256 ? PBKDF2_ITERATIONS : PBKDF2_ITERATIONS_LEGACY;
+
+        int derivation = CCKeyDerivationPBKDF(kCCPBKDF2,
+                                              passphrase.UTF8String,
+                                              (int)passphrase.length,
+                                              salt.bytes,
+                                              (int)salt.length,
+                                              prf,
+                                              rounds,
+                                              key.mutableBytes,
+                                              key.length);
+        if (derivation != kCCSuccess) {
+            NSLog(@"PBKDF2 key derivation failed: %d", derivation);
+            continue;
+        }
+
+        if ([self decryptData:cipher plain:&plain key:key keyLen:AES_KEY_256_LENGTH initializationVector:initializationVector authenticationTag:authenticationTag]) {
+            NSLog(@"[INFO] Private key unlocked with PBKDF2 %@/%u in %.2f s", prf == kCCPRFHmacAlgSHA256 ? @"SHA256" : @"SHA1", rounds, [[NSDate date] timeIntervalSinceDate:start]);
+            @synchronized (_derivedKeyCache) {
+                _derivedKeyCache[cacheKey] = [key mutableCopy];
+            }
+            success = YES;
+            break;
         }
     }
 
+    [key resetBytesInRange:NSMakeRange(0, key.length)];
+
     if (!success) {
-        NSLog(@"❌ Failed to decrypt with both PBKDF2 formats.");
+        NSLog(@"❌ Failed to decrypt the private key (%@).", (isCancelled && isCancelled()) ? @"cancelled" : @"wrong passphrase or format");
         return nil;
     }
 
     return plain;
 }
 
+// The cache is looked up with a digest: neither the passphrase nor the salt are kept in memory
+- (NSString *)derivedKeyCacheKey:(NSString *)passphrase salt:(NSData *)salt
+{
+    NSMutableData *data = [NSMutableData dataWithData:salt];
+    [data appendData:[passphrase dataUsingEncoding:NSUTF8StringEncoding]];
+    NSString *cacheKey = [self createSHA256:data];
+    [data resetBytesInRange:NSMakeRange(0, data.length)];
+
+    return cacheKey;
+}
+
+- (void)invalidateDerivedKeyCache
+{
+    @synchronized (_derivedKeyCache) {
+        for (NSMutableData *key in _derivedKeyCache.allValues) {
+            [key resetBytesInRange:NSMakeRange(0, key.length)];
+        }
+        [_derivedKeyCache removeAllObjects];
+    }
+}
+
 #
 #pragma mark - Encrypt / Decrypt file material
 #
@@ -698,12 +796,17 @@ cleanup:
 #
 
 - (BOOL)encryptFile:(NSString *)fileName fileNameIdentifier:(NSString *)fileNameIdentifier directory:(NSString *)directory key:(NSString **)key initializationVector:(NSString **)initializationVector authenticationTag:(NSString **)authenticationTag
+{
+    return [self encryptFile:fileName fileNameIdentifier:fileNameIdentifier directory:directory key:key initializationVector:initializationVector authenticationTag:authenticationTag checksumPlain:nil checksumCipher:nil];
+}
+
+- (BOOL)encryptFile:(NSString *)fileName fileNameIdentifier:(NSString *)fileNameIdentifier directory:(NSString *)directory key:(NSString **)key initializationVector:(NSString **)initializationVector authenticationTag:(NSString **)authenticationTag checksumPlain:(NSString **)checksumPlain checksumCipher:(NSString **)checksumCipher
 {
     NSData *authenticationTagData;
     NSData *keyData = [self generateKey:AES_KEY_128_LENGTH];
     NSData *initializationVectorData = [self generateIV:AES_IVEC_LENGTH];
 
-    BOOL result = [self encryptFile:[NSString stringWithFormat:@"%@/%@", directory, fileName] fileNameCipher:[NSString stringWithFormat:@"%@/%@", directory, fileNameIdentifier] key:keyData keyLen:AES_KEY_128_LENGTH initializationVector:initializationVectorData authenticationTag:&authenticationTagData];
+    BOOL result = [self encryptFile:[NSString stringWithFormat:@"%@/%@", directory, fileName] fileNameCipher:[NSString stringWithFormat:@"%@/%@", directory, fileNameIdentifier] key:keyData keyLen:AES_KEY_128_LENGTH initializationVector:initializationVectorData authenticationTag:&authenticationTagData checksumPlain:checksumPlain checksumCipher:checksumCipher];
 
     if (result) {
 
@@ -721,6 +824,64 @@ cleanup:
     return false;
 }
 
+// Encrypts directly into chunk files "1", "2", ... of `chunkSize` bytes in `directory` (tag appended to the last chunk).
+// Returns the size of every chunk, in order, or nil on failure.
+// No file is written for `fileNameIdentifier`: the chunks are the only copy of the ciphertext, the upload
+// sends them as they are (chunksOnly) and takes the total length from their sizes.
+- (NSArray<NSNumber *> *)encryptFile:(NSString *)fileName fileNameIdentifier:(NSString *)fileNameIdentifier directory:(NSString *)directory chunkSize:(int64_t)chunkSize key:(NSString **)key initializationVector:(NSString **)initializationVector authenticationTag:(NSString **)authenticationTag
+{
+    if (chunkSize <= 0) {
+        return nil;
+    }
+
+    NSString *fileNamePath = [NSString stringWithFormat:@"%@/%@", directory, fileName];
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:fileNamePath error:nil];
+    if (!attributes) {
+        return nil;
+    }
+
+    unsigned long long fileSize = [attributes fileSize];
+    size_t maxChunks = (size_t)(fileSize / (unsigned long long)chunkSize) + 2;
+    uint64_t *chunkSizes = calloc(maxChunks, sizeof(uint64_t));
+    if (!chunkSizes) {
+        return nil;
+    }
+
+    NSData *keyData = [self generateKey:AES_KEY_128_LENGTH];
+    NSData *initializationVectorData = [self generateIV:AES_IVEC_LENGTH];
+    unsigned char cTag[AES_GCM_TAG_LENGTH] = {0};
+    size_t chunkCount = 0;
+    nc_e2ee_file_report report;
+
+    int status = nc_e2ee_file_encrypt_chunks([fileNamePath fileSystemRepresentation],
+                                             [directory fileSystemRepresentation],
+                                             (uint64_t)chunkSize,
+                                             keyData.bytes, AES_KEY_128_LENGTH,
+                                             initializationVectorData.bytes, AES_IVEC_LENGTH,
+                                             cTag,
+                                             self.fileBlockSize,
+                                             chunkSizes, maxChunks, &chunkCount,
+                                             &report);
+
+    NSMutableArray<NSNumber *> *chunks = nil;
+    if (status > 0) {
+        chunks = [NSMutableArray arrayWithCapacity:chunkCount];
+        for (size_t i = 0; i < chunkCount; i++) {
+            [chunks addObject:@(chunkSizes[i])];
+        }
+
+
+        *key = [keyData base64EncodedStringWithOptions:0];
+        *initializationVector = [initializationVectorData base64EncodedStringWithOptions:0];
+        *authenticationTag = [[NSData dataWithBytes:cTag length:sizeof(cTag)] base64EncodedStringWithOptions:0];
+
+        [self logFileReport:&report operation:@"encrypt chunks"];
+    }
+    free(chunkSizes);
+
+    return chunks;
+}
+
 - (BOOL)decryptFile:(NSString *)fileName fileNameView:(NSString *)fileNameView ocId:(NSString *)ocId userId:(NSString *)userId urlBase:(NSString *)urlBase key:(NSString *)key initializationVector:(NSString *)initializationVector authenticationTag:(NSString *)authenticationTag
 {
     NSData *keyData = [[NSData alloc] initWithBase64EncodedString:key options:0];
@@ -730,6 +891,73 @@ cleanup:
     return [self decryptFile:[[[NCUtilityFileSystem alloc] init] getDirectoryProviderStorageOcId:ocId fileName:fileName userId: userId urlBase:urlBase] fileNamePlain:[[[NCUtilityFileSystem alloc] init] getDirectoryProviderStorageOcId:ocId fileName:fileNameView userId:userId urlBase:urlBase] key:keyData keyLen:AES_KEY_128_LENGTH initializationVector:initializationVectorData authenticationTag:authenticationTagData];
 }
 
+- (NSInteger)processFileJobs:(NSArray<NCEndToEndFileJob *> *)jobs maxConcurrent:(NSInteger)maxConcurrent
+{
+    if (jobs.count == 0) {
+        return 0;
+    }
+
+    nc_e2ee_file_job *cJobs = calloc(jobs.count, sizeof(nc_e2ee_file_job));
+    if (!cJobs) {
+        return 0;
+    }
+
+    // Keep the decoded material alive while the workers run
+    NSMutableArray *retained = [NSMutableArray arrayWithCapacity:jobs.count * 4];
+
+    for (NSUInteger i = 0; i < jobs.count; i++) {
+        NCEndToEndFileJob *job = jobs[i];
+        nc_e2ee_file_job *cJob = &cJobs[i];
+        job.success = NO;
+
+        if (!job.decrypt && job.key.length == 0) {
+            job.key = [[self generateKey:AES_KEY_128_LENGTH] base64EncodedStringWithOptions:0];
+        }
+        if (!job.decrypt && job.initializationVector.length == 0) {
+            job.initializationVector = [[self generateIV:AES_IVEC_LENGTH] base64EncodedStringWithOptions:0];
+        }
+
+        NSData *keyData = job.key ? [[NSData alloc] initWithBase64EncodedString:job.key options:0] : nil;
+        NSData *initializationVectorData = job.initializationVector ? [[NSData alloc] initWithBase64EncodedString:job.initializationVector options:0] : nil;
+        NSData *authenticationTagData = job.authenticationTag ? [[NSData alloc] initWithBase64EncodedString:job.authenticationTag options:0] : nil;
+        if (!job.fileName || !job.fileNameDestination || keyData.length != AES_KEY_128_LENGTH || initializationVectorData.length == 0 ||
+            (job.decrypt && (authenticationTagData.length == 0 || authenticationTagData.length > AES_GCM_TAG_LENGTH))) {
+            // Invalid job: left empty, the engine fails it without touching any file
+            cJob->operation = job.decrypt ? NC_E2EE_FILE_DECRYPT : NC_E2EE_FILE_ENCRYPT;
+            continue;
+        }
+
+        [retained addObjectsFromArray:@[keyData, initializationVectorData, job.fileName, job.fileNameDestination]];
+
+        cJob->operation = job.decrypt ? NC_E2EE_FILE_DECRYPT : NC_E2EE_FILE_ENCRYPT;
+        cJob->source = [job.fileName fileSystemRepresentation];
+        cJob->destination = [job.fileNameDestination fileSystemRepresentation];
+        cJob->key = keyData.bytes;
+        cJob->keyLen = (int)keyData.length;
+        cJob->iv = initializationVectorData.bytes;
+        cJob->ivLen = (int)initializationVectorData.length;
+        if (job.decrypt) {
+            memcpy(cJob->tag, authenticationTagData.bytes, authenticationTagData.length);
+            cJob->tagLen = (int)authenticationTagData.length;
+        }
+    }
+
+    size_t succeeded = nc_e2ee_file_batch(cJobs, jobs.count, (int)maxConcurrent, self.fileBlockSize);
+
+    for (NSUInteger i = 0; i < jobs.count; i++) {
+        NCEndToEndFileJob *job = jobs[i];
+        job.success = cJobs[i].result > 0;
+        if (job.success && !job.decrypt) {
+            job.authenticationTag = [[NSData dataWithBytes:cJobs[i].tag length:cJobs[i].tagLen] base64EncodedStringWithOptions:0];
+        }
+    }
+
+    NSLog(@"[INFO] E2EE file jobs: %zu/%lu succeeded", succeeded, (unsigned long)jobs.count);
+
+    free(cJobs);
+    return (NSInteger)succeeded;
+}
+
 // -----------------------------------------------------------------------------------------------------------------------------------------------------------------------
 // -----------------------------------------------------------------------------------------------------------------------------------------------------------------------
 
@@ -744,164 +972,195 @@ cleanup:
 
 - (NSData *)encryptAsymmetricData:(NSData *)plainData certificate:(NSString *)certificate
 {
-    EVP_PKEY *key = NULL;
-    int status = 0;
-    unsigned char *pKey = (unsigned char *)[certificate UTF8String];
-
-    // Extract real publicKey
-    BIO *bio = BIO_new_mem_buf(pKey, -1);
-    if (!bio)
-        return nil;
-
-    X509 *x509 = PEM_read_bio_X509(bio, NULL, 0, NULL);
-    if (!x509)
+    NCEndToEndKeyHandle *handle NS_VALID_UNTIL_END_OF_SCOPE = [self certificateHandle:certificate];
+    if (!handle)
         return nil;
 
-    key = X509_get_pubkey(x509);
-    if (!key)
-        return nil;
+    return [self asymmetricData:plainData key:handle.pkey encrypt:YES];
+}
 
-    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(key, NULL);
-    if (!ctx)
+- (NSData *)encryptAsymmetricData:(NSData *)plainData privateKey:(NSString *)privateKey
+{
+    NCEndToEndKeyHandle *handle NS_VALID_UNTIL_END_OF_SCOPE = [self privateKeyHandle:privateKey];
+    if (!handle)
         return nil;
 
-    status = EVP_PKEY_encrypt_init(ctx);
-    if (status <= 0)
-        return nil;
+    return [self asymmetricData:plainData key:handle.pkey encrypt:YES];
+}
 
-    status = EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_OAEP_PADDING);
-    if (status <= 0)
+- (NSData *)decryptAsymmetricData:(NSData *)cipherData privateKey:(NSString *)privateKey
+{
+    NCEndToEndKeyHandle *handle NS_VALID_UNTIL_END_OF_SCOPE = [self privateKeyHandle:privateKey];
+    if (!handle)
         return nil;
 
-    status = EVP_PKEY_CTX_set_rsa_oaep_md(ctx, EVP_sha256());
-    if (status <= 0)
-        return nil;
+    return [self asymmetricData:cipherData key:handle.pkey encrypt:NO];
+}
 
-    status = EVP_PKEY_CTX_set_rsa_mgf1_md(ctx, EVP_sha256());
-    if (status <= 0)
-        return nil;
+// RSA-OAEP (SHA-256, MGF1 SHA-256) with an already parsed key
+- (NSData *)asymmetricData:(NSData *)data key:(EVP_PKEY *)key encrypt:(BOOL)encrypt
+{
+    NSData *outData = nil;
+    unsigned char *out = NULL;
+    size_t outLen = 0;
 
-    unsigned long outLen = 0;
-    status = EVP_PKEY_encrypt(ctx, NULL, &outLen, [plainData bytes], (int)[plainData length]);
-    if (status <= 0 || outLen == 0)
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(key, NULL);
+    if (!ctx)
         return nil;
 
-    unsigned char *out = (unsigned char *) malloc(outLen);
-    status = EVP_PKEY_encrypt(ctx, out, &outLen, [plainData bytes], (int)[plainData length]);
-    if (status <= 0)
-        return nil;
+    do {
+        if ((encrypt ? EVP_PKEY_encrypt_init(ctx) : EVP_PKEY_decrypt_init(ctx)) <= 0)
+            break;
+        if (EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_OAEP_PADDING) <= 0)
+            break;
+        if (EVP_PKEY_CTX_set_rsa_oaep_md(ctx, EVP_sha256()) <= 0)
+            break;
+        if (EVP_PKEY_CTX_set_rsa_mgf1_md(ctx, EVP_sha256()) <= 0)
+            break;
+
+        int status = encrypt ? EVP_PKEY_encrypt(ctx, NULL, &outLen, [data bytes], [data length]) : EVP_PKEY_decrypt(ctx, NULL, &outLen, [data bytes], [data length]);
+        if (status <= 0 || outLen == 0)
+            break;
+
+        out = (unsigned char *) malloc(outLen);
+        if (!out)
+            break;
+
+        status = encrypt ? EVP_PKEY_encrypt(ctx, out, &outLen, [data bytes], [data length]) : EVP_PKEY_decrypt(ctx, out, &outLen, [data bytes], [data length]);
+        if (status <= 0) {
+            if (!encrypt)
+                ERR_print_errors_fp(stderr);
+            break;
+        }
 
-    NSData *outData = [[NSData alloc] initWithBytes:out length:outLen];
+        outData = [[NSData alloc] initWithBytes:out length:outLen];
+    } while (NO);
 
     if (out)
         free(out);
+    EVP_PKEY_CTX_free(ctx);
 
     return outData;
 }
 
-- (NSData *)encryptAsymmetricData:(NSData *)plainData privateKey:(NSString *)privateKey
-{
-    EVP_PKEY *key = NULL;
-    int status = 0;
-    unsigned char *pKey = (unsigned char *)[privateKey UTF8String];
-
-    BIO *bio = BIO_new_mem_buf(pKey, -1);
-    if (!bio)
-        return nil;
+#
+#pragma mark - Key cache
+#
 
-    key = PEM_read_bio_PrivateKey(bio, NULL, NULL, NULL);
-    if (!key)
+- (NSString *)keyCacheKey:(NSString *)pem prefix:(NSString *)prefix
+{
+    NSData *data = [pem dataUsingEncoding:NSUTF8StringEncoding];
+    if (data.length == 0)
         return nil;
 
-    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(key, NULL);
-    if (!ctx)
-        return nil;
+    return [prefix stringByAppendingString:[self createSHA256:data]];
+}
 
-    status = EVP_PKEY_encrypt_init(ctx);
-    if (status <= 0)
-        return nil;
+- (NCEndToEndKeyHandle *)cachedKeyHandle:(NSString *)cacheKey
+{
+    NCEndToEndKeyHandle *handle = [_keyCache objectForKey:cacheKey];
+    @synchronized (_keyCache) {
+        if (handle) _keyCacheHits++; else _keyCacheMisses++;
+    }
+    return handle;
+}
 
-    status = EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_OAEP_PADDING);
-    if (status <= 0)
+// Certificate PEM -> X509 + public key
+- (NCEndToEndKeyHandle *)certificateHandle:(NSString *)certificate
+{
+    NSString *cacheKey = [self keyCacheKey:certificate prefix:@"cert:"];
+    if (!cacheKey)
         return nil;
 
-    status = EVP_PKEY_CTX_set_rsa_oaep_md(ctx, EVP_sha256());
-    if (status <= 0)
-        return nil;
+    NCEndToEndKeyHandle *handle = [self cachedKeyHandle:cacheKey];
+    if (handle)
+        return handle;
 
-    status = EVP_PKEY_CTX_set_rsa_mgf1_md(ctx, EVP_sha256());
-    if (status <= 0)
+    NSData *data = [certificate dataUsingEncoding:NSUTF8StringEncoding];
+    BIO *bio = BIO_new_mem_buf(data.bytes, (int)data.length);
+    if (!bio)
         return nil;
 
-    unsigned long outLen = 0;
-    status = EVP_PKEY_encrypt(ctx, NULL, &outLen, [plainData bytes], (int)[plainData length]);
-    if (status <= 0 || outLen == 0)
+    X509 *x509 = PEM_read_bio_X509(bio, NULL, 0, NULL);
+    BIO_free(bio);
+    if (!x509)
         return nil;
 
-    unsigned char *out = (unsigned char *) malloc(outLen);
-    status = EVP_PKEY_encrypt(ctx, out, &outLen, [plainData bytes], (int)[plainData length]);
-    if (status <= 0)
+    EVP_PKEY *pkey = X509_get_pubkey(x509);
+    if (!pkey) {
+        X509_free(x509);
         return nil;
+    }
 
-    NSData *outData = [[NSData alloc] initWithBytes:out length:outLen];
-
-    if (out)
-        free(out);
+    handle = [[NCEndToEndKeyHandle alloc] initWithPKey:pkey x509:x509];
+    handle.fingerprint = [self fingerprintOfCertificate:x509];
+    [_keyCache setObject:handle forKey:cacheKey];
 
-    return outData;
+    return handle;
 }
 
-- (NSData *)decryptAsymmetricData:(NSData *)cipherData privateKey:(NSString *)privateKey
+// Private key PEM -> EVP_PKEY
+- (NCEndToEndKeyHandle *)privateKeyHandle:(NSString *)privateKey
 {
-    unsigned char *pKey = (unsigned char *)[privateKey UTF8String];
-    int status = 0;
-    
-    BIO *bio = BIO_new_mem_buf(pKey, -1);
+    NSString *cacheKey = [self keyCacheKey:privateKey prefix:@"private:"];
+    if (!cacheKey)
+        return nil;
+
+    NCEndToEndKeyHandle *handle = [self cachedKeyHandle:cacheKey];
+    if (handle)
+        return handle;
+
+    NSData *data = [privateKey dataUsingEncoding:NSUTF8StringEncoding];
+    BIO *bio = BIO_new_mem_buf(data.bytes, (int)data.length);
     if (!bio)
         return nil;
-    
-    EVP_PKEY *key = PEM_read_bio_PrivateKey(bio, NULL, NULL, NULL);
-    if (!key) {
+
+    EVP_PKEY *pkey = PEM_read_bio_PrivateKey(bio, NULL, NULL, NULL);
+    BIO_free(bio);
+    if (!pkey) {
         ERR_print_errors_fp(stderr);
         return nil;
     }
 
-    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(key, NULL);
-    if (!ctx)
-        return nil;
-    
-    status = EVP_PKEY_decrypt_init(ctx);
-    if (status <= 0)
-        return nil;
-    
-    status = EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_OAEP_PADDING);
-    if (status <= 0)
-        return nil;
-    
-    status = EVP_PKEY_CTX_set_rsa_oaep_md(ctx, EVP_sha256());
-    if (status <= 0)
-        return nil;
-    
-    status = EVP_PKEY_CTX_set_rsa_mgf1_md(ctx, EVP_sha256());
-    if (status <= 0)
-        return nil;
-    
-    unsigned long outLen = 0;
-    status = EVP_PKEY_decrypt(ctx, NULL, &outLen, [cipherData bytes], (int)[cipherData length]);
-    if (status <= 0 || outLen == 0)
-        return nil;
-    
-    unsigned char *out = (unsigned char *) malloc(outLen);
-    status = EVP_PKEY_decrypt(ctx, out, &outLen, [cipherData bytes], (int)[cipherData length]);
-    if (status <= 0)
+    handle = [[NCEndToEndKeyHandle alloc] initWithPKey:pkey x509:NULL];
+    [_keyCache setObject:handle forKey:cacheKey];
+
+    return handle;
+}
+
+// SHA-256 of the DER certificate
+- (NSData *)fingerprintOfCertificate:(X509 *)x509
+{
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int mdLen = 0;
+
+    if (!x509 || X509_digest(x509, EVP_sha256(), md, &mdLen) != 1)
         return nil;
 
-    NSData *outData = [[NSData alloc] initWithBytes:out length:outLen];
+    return [NSData dataWithBytes:md length:mdLen];
+}
 
-    if (out)
-        free(out);
-    
-    return outData;
+- (void)invalidateKeyCache
+{
+    [_keyCache removeAllObjects];
+    [self invalidateDerivedKeyCache];
+}
+
+- (void)invalidateKeyCacheForPEM:(NSString *)pem
+{
+    for (NSString *prefix in @[@"cert:", @"private:"]) {
+        NSString *cacheKey = [self keyCacheKey:pem prefix:prefix];
+        if (cacheKey) {
+            [_keyCache removeObjectForKey:cacheKey];
+        }
+    }
+}
+
+- (NSDictionary<NSString *, NSNumber *> *)keyCacheStatistics
+{
+    @synchronized (_keyCache) {
+        return @{@"hits": @(_keyCacheHits), @"misses": @(_keyCacheMisses)};
+    }
 }
 
 #
@@ -993,6 +1252,7 @@ cleanup:
 /// Encrypts a file using AES-GCM and appends the authentication tag at the end of the output file.
 /// The generated authentication tag is also returned via the authenticationTag parameter.
 /// The output file structure will be: [ciphertext || tag].
+/// The work is done by the plain fd file engine (NCEndToEndFileCipher) using `fileBlockSize` blocks.
 ///
 /// @param fileName The full path to the input plaintext file.
 /// @param fileNameCipher The full path to the output file where the ciphertext will be written.
@@ -1002,74 +1262,45 @@ cleanup:
 /// @param authenticationTag A pointer to an NSData* that will receive the generated authentication tag (typically 16 bytes).
 ///
 /// @return YES if encryption completes successfully, NO otherwise.
-- (BOOL)encryptFile:(NSString *)fileName fileNameCipher:(NSString *)fileNameCipher key:(NSData *)key keyLen:(int)keyLen initializationVector:(NSData *)initializationVector authenticationTag:(NSData **)authenticationTag
+/// @param checksumPlain If not NULL, receives the SHA-256 (hex) of the plaintext, hashed in the same pass.
+/// @param checksumCipher If not NULL, receives the SHA-256 (hex) of the output file [ciphertext || tag].
+- (BOOL)encryptFile:(NSString *)fileName fileNameCipher:(NSString *)fileNameCipher key:(NSData *)key keyLen:(int)keyLen initializationVector:(NSData *)initializationVector authenticationTag:(NSData **)authenticationTag checksumPlain:(NSString **)checksumPlain checksumCipher:(NSString **)checksumCipher
 {
-    // Select cipher based on key length
-    const EVP_CIPHER *cipher = NULL;
-    if (keyLen == AES_KEY_128_LENGTH) {
-        cipher = EVP_aes_128_gcm();
-    } else if (keyLen == AES_KEY_256_LENGTH) {
-        cipher = EVP_aes_256_gcm();
-    } else {
+    if (!fileName || !fileNameCipher || (int)key.length != keyLen || initializationVector.length == 0) {
         return NO;
     }
 
-    const unsigned char *cKey = key.bytes;
-    const unsigned char *cIV = initializationVector.bytes;
     unsigned char cTag[AES_GCM_TAG_LENGTH] = {0};
+    nc_e2ee_file_report report;
+    nc_e2ee_digest plainDigest, cipherDigest;
 
-    // Create encryption context
-    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
-    if (!ctx) return NO;
-
-    BOOL success = NO;
-
-    do {
-        // Initialize encryption operation
-        if (EVP_EncryptInit_ex(ctx, cipher, NULL, NULL, NULL) <= 0) break;
-        // Set IV length
-        if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, (int)initializationVector.length, NULL) <= 0) break;
-        // Set key and IV
-        if (EVP_EncryptInit_ex(ctx, NULL, NULL, cKey, cIV) <= 0) break;
-
-        NSInputStream *inStream = [NSInputStream inputStreamWithFileAtPath:fileName];
-        NSOutputStream *outStream = [NSOutputStream outputStreamToFileAtPath:fileNameCipher append:NO];
-        [inStream open];
-        [outStream open];
-
-        unsigned char inBuf[streamBuffer];
-        unsigned char outBuf[streamBuffer + EVP_MAX_BLOCK_LENGTH];
-        int outLen = 0;
-
-        // Read plaintext from file, encrypt, and write ciphertext
-        while ([inStream hasBytesAvailable]) {
-            NSInteger bytesRead = [inStream read:inBuf maxLength:streamBuffer];
-            if (bytesRead <= 0) break;
-
-            if (EVP_EncryptUpdate(ctx, outBuf, &outLen, inBuf, (int)bytesRead) <= 0) break;
-
-            if ([outStream write:outBuf maxLength:outLen] != outLen) break;
-        }
-
-        // Finalize encryption (GCM usually produces no extra bytes here)
-        if (EVP_EncryptFinal_ex(ctx, outBuf, &outLen) <= 0) break;
-        if (outLen > 0 && [outStream write:outBuf maxLength:outLen] != outLen) break;
-
-        // Retrieve the authentication tag
-        if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, sizeof(cTag), cTag) <= 0) break;
-        *authenticationTag = [NSData dataWithBytes:cTag length:sizeof(cTag)];
-
-        // Append the tag to the end of the output file
-        if ([outStream write:cTag maxLength:sizeof(cTag)] != sizeof(cTag)) break;
+    if (checksumPlain && !nc_e2ee_digest_init(&plainDigest, NC_E2EE_DIGEST_SHA256)) {
+        return NO;
+    }
+    if (checksumCipher && !nc_e2ee_digest_init(&cipherDigest, NC_E2EE_DIGEST_SHA256)) {
+        if (checksumPlain) nc_e2ee_digest_free(&plainDigest);
+        return NO;
+    }
 
-        success = YES;
+    int status = nc_e2ee_file_encrypt_digest([fileName fileSystemRepresentation],
+                                             [fileNameCipher fileSystemRepresentation],
+                                             key.bytes, keyLen,
+                                             initializationVector.bytes, (int)initializationVector.length,
+                                             cTag,
+                                             self.fileBlockSize,
+                                             checksumPlain ? &plainDigest : NULL,
+                                             checksumCipher ? &cipherDigest : NULL,
+                                             &report);
+    if (status <= 0) {
+        return NO;
+    }
 
-        [inStream close];
-        [outStream close];
-    } while (NO);
+    *authenticationTag = [NSData dataWithBytes:cTag length:sizeof(cTag)];
+    if (checksumPlain) *checksumPlain = [self hexString:plainDigest.sha256 length:NC_E2EE_DIGEST_SHA256_LENGTH];
+    if (checksumCipher) *checksumCipher = [self hexString:cipherDigest.sha256 length:NC_E2EE_DIGEST_SHA256_LENGTH];
+    [self logFileReport:&report operation:@"encrypt"];
 
-    EVP_CIPHER_CTX_free(ctx);
-    return success;
+    return YES;
 }
 
 // Decryption data using GCM mode
@@ -1176,6 +1407,8 @@ initializationVector:(NSData *)initializationVector
 /// and writes the resulting plaintext to the output file. If the encrypted file contains the provided
 /// authentication tag appended at the end, those bytes are excluded from the decryption process to avoid
 /// producing extra characters in the output.
+/// The work is done by the plain fd file engine (NCEndToEndFileCipher): large files are decrypted by a
+/// read -> decrypt -> write pipeline and the appended tag is detected while reading, in a single pass.
 ///
 /// @param fileName The full path to the input file containing the ciphertext (and optionally the appended tag).
 /// @param fileNamePlain The full path to the output file where the decrypted plaintext will be written.
@@ -1190,128 +1423,36 @@ initializationVector:(NSData *)initializationVector
     if (!fileName || !fileNamePlain || !key || !initializationVector || !authenticationTag) {
         return NO;
     }
-
-    // Select cipher based on key length
-    const EVP_CIPHER *cipher = NULL;
-    if (keyLen == AES_KEY_128_LENGTH) {
-        cipher = EVP_aes_128_gcm();
-    } else if (keyLen == AES_KEY_256_LENGTH) {
-        cipher = EVP_aes_256_gcm();
-    } else {
+    if ((int)key.length != keyLen || authenticationTag.length == 0) {
         return NO;
     }
 
-    const unsigned char *cKey = key.bytes;
-    const unsigned char *cIV = initializationVector.bytes;
-    const unsigned char *cTag = authenticationTag.bytes;
-    int ivLen = (int)initializationVector.length;
-    int tagLen = (int)authenticationTag.length;
-
-    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
-    if (!ctx) return NO;
-
-    BOOL success = NO;
-    NSInputStream *inStream = nil;
-    NSOutputStream *outStream = nil;
+    nc_e2ee_file_report report;
 
-    do {
-        // Initialize decryption operation
-        int status = EVP_DecryptInit_ex(ctx, cipher, NULL, NULL, NULL);
-        if (status <= 0) break;
-
-        // Set IV length
-        status = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, ivLen, NULL);
-        if (status <= 0) break;
-
-        // Set key and IV
-        status = EVP_DecryptInit_ex(ctx, NULL, NULL, cKey, cIV);
-        if (status <= 0) break;
-
-        // Open input and output streams
-        inStream = [NSInputStream inputStreamWithFileAtPath:fileName];
-        outStream = [NSOutputStream outputStreamToFileAtPath:fileNamePlain append:NO];
-        [inStream open];
-        [outStream open];
-
-        if (![inStream hasBytesAvailable] || ![outStream hasSpaceAvailable]) break;
-
-        // Determine ciphertext length, excluding the tag if it is appended to the file
-        unsigned long long fileSize = 0;
-        unsigned long long cipherSize = 0;
-        @autoreleasepool {
-            NSError *attrErr = nil;
-            NSDictionary *attr = [[NSFileManager defaultManager] attributesOfItemAtPath:fileName error:&attrErr];
-            if (attr && !attrErr) {
-                fileSize = [attr fileSize];
-                cipherSize = fileSize;
-
-                // Check if the last bytes match the provided authentication tag
-                if (fileSize >= (unsigned long long)tagLen && tagLen > 0) {
-                    NSFileHandle *fh = [NSFileHandle fileHandleForReadingAtPath:fileName];
-                    if (fh) {
-                        @try {
-                            [fh seekToFileOffset:(fileSize - (unsigned long long)tagLen)];
-                            NSData *tail = [fh readDataOfLength:(NSUInteger)tagLen];
-                            if (tail.length == (NSUInteger)tagLen &&
-                                memcmp(tail.bytes, cTag, (size_t)tagLen) == 0) {
-                                cipherSize = fileSize - (unsigned long long)tagLen; // Exclude the tag from decryption input
-                            }
-                        } @catch (__unused NSException *e) {
-                            // Ignore any file handle error, fallback to using full file
-                        }
-                        [fh closeFile];
-                    }
-                }
-            }
-        }
-        // -------------------------------------------------------------------------------
-
-        unsigned char inBuf[streamBuffer];
-        unsigned char outBuf[streamBuffer];
-        int outLen = 0;
-
-        // Read exactly the ciphertext portion (excluding tag if found)
-        unsigned long long remaining = cipherSize;
-        while (remaining > 0) {
-            NSUInteger toRead = (NSUInteger)MIN((unsigned long long)streamBuffer, remaining);
-            NSInteger bytesRead = [inStream read:inBuf maxLength:toRead];
-            if (bytesRead <= 0) break;
-
-            status = EVP_DecryptUpdate(ctx, outBuf, &outLen, inBuf, (int)bytesRead);
-            if (status <= 0) break;
-
-            NSInteger written = [outStream write:outBuf maxLength:outLen];
-            if (written != outLen) break;
-
-            remaining -= (unsigned long long)bytesRead;
-        }
-
-        if (remaining != 0) break; // Ciphertext not fully processed
-
-        // Set the provided tag before finalizing
-        status = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, tagLen, (void *)cTag);
-        if (status <= 0) break;
-
-        // Finalize decryption (verifies tag authenticity)
-        outLen = 0;
-        status = EVP_DecryptFinal_ex(ctx, outBuf, &outLen);
-        if (status <= 0) break;
-
-        if (outLen > 0) {
-            NSInteger written = [outStream write:outBuf maxLength:outLen];
-            if (written != outLen) break;
-        }
+    int status = nc_e2ee_file_decrypt([fileName fileSystemRepresentation],
+                                      [fileNamePlain fileSystemRepresentation],
+                                      key.bytes, keyLen,
+                                      initializationVector.bytes, (int)initializationVector.length,
+                                      authenticationTag.bytes, (int)authenticationTag.length,
+                                      self.fileBlockSize,
+                                      &report);
+    if (status <= 0) {
+        return NO;
+    }
 
-        success = YES;
+    [self logFileReport:&report operation:@"decrypt"];
 
-    } while (NO);
+    return YES;
+}
 
-    // Close streams and free context
-    if (inStream) [inStream close];
-    if (outStream) [outStream close];
-    if (ctx) EVP_CIPHER_CTX_free(ctx);
+// Throughput report of the file engine, only for files big enough to be meaningful
+- (void)logFileReport:(nc_e2ee_file_report *)report operation:(NSString *)operation
+{
+    if (report->bytesIn < report->blockSize) {
+        return;
+    }
 
-    return success;
+    NSLog(@"[INFO] E2EE file %@: %llu bytes, %llu blocks of %zu KiB, %zu buffers, %.3f s (read %.3f, cipher %.3f, write %.3f), %.1f MiB/s", operation, report->bytesIn, report->blocks, report->blockSize / 1024, report->buffers, report->seconds, report->readSeconds, report->cipherSeconds, report->writeSeconds, report->megabytesPerSecond);
 }
 
 #
@@ -1320,35 +1461,30 @@ initializationVector:(NSData *)initializationVector
 
 - (NSData *)generateSignatureCMS:(NSData *)data certificate:(NSString *)certificate privateKey:(NSString *)privateKey userId:(NSString *)userId
 {
-    unsigned char *pKey = (unsigned char *)[privateKey UTF8String];
-    unsigned char *certKey = (unsigned char *)[certificate UTF8String];
-    BIO *printBIO = BIO_new_fp(stdout, BIO_NOCLOSE);
-
-    BIO *certKeyBIO = BIO_new_mem_buf(certKey, -1);
-    if (!certKeyBIO)
-        return nil;
-
-    X509 *x509 = PEM_read_bio_X509(certKeyBIO, NULL, 0, NULL);
-    if (!x509)
+    NCEndToEndKeyHandle *certificateHandle NS_VALID_UNTIL_END_OF_SCOPE = [self certificateHandle:certificate];
+    if (!certificateHandle)
         return nil;
 
-    BIO *pkeyBIO = BIO_new_mem_buf(pKey, -1);
-    EVP_PKEY *key = PEM_read_bio_PrivateKey(pkeyBIO, NULL, NULL, NULL);
-    if (!key)
+    NCEndToEndKeyHandle *privateKeyHandle NS_VALID_UNTIL_END_OF_SCOPE = [self privateKeyHandle:privateKey];
+    if (!privateKeyHandle)
         return nil;
 
     BIO *dataBIO = BIO_new_mem_buf((void*)data.bytes, (int)data.length);
 
-    CMS_ContentInfo *contentInfo = CMS_sign(x509, key, NULL, dataBIO, CMS_DETACHED);
+    CMS_ContentInfo *contentInfo = CMS_sign(certificateHandle.x509, privateKeyHandle.pkey, NULL, dataBIO, CMS_DETACHED);
+    BIO_free(dataBIO);
     if (contentInfo == nil)
         return nil;
 
     // DEBUG CMS_ContentInfo_print_ctx(printBIO, contentInfo, 0, NULL);
-    PEM_write_bio_CMS(printBIO, contentInfo);
+    // DEBUG PEM_write_bio_CMS(printBIO, contentInfo);
 
     BIO *i2dCmsBioOut = BIO_new(BIO_s_mem());
-    if (i2d_CMS_bio(i2dCmsBioOut, contentInfo) != 1)
+    if (i2d_CMS_bio(i2dCmsBioOut, contentInfo) != 1) {
+        CMS_ContentInfo_free(contentInfo);
+        BIO_free(i2dCmsBioOut);
         return nil;
+    }
 
     int len = BIO_pending(i2dCmsBioOut);
     char *keyBytes = malloc(len);
@@ -1356,10 +1492,8 @@ initializationVector:(NSData *)initializationVector
 
     NSData *i2dCmsData = [NSData dataWithBytes:keyBytes length:len];
 
-    BIO_free(printBIO);
-    BIO_free(certKeyBIO);
-    BIO_free(pkeyBIO);
-    BIO_free(dataBIO);
+    free(keyBytes);
+    CMS_ContentInfo_free(contentInfo);
     BIO_free(i2dCmsBioOut);
 
     return i2dCmsData;
@@ -1424,46 +1558,75 @@ initializationVector:(NSData *)initializationVector
 
 - (BOOL)verifySignatureCMS:(NSData *)cmsContent data:(NSData *)data certificates:(NSArray*)certificates
 {
-    BIO *dataBIO = BIO_new_mem_buf((void*)data.bytes, (int)data.length);
-    BIO *printBIO = BIO_new_fp(stdout, BIO_NOCLOSE);
-    BIO *cmsBIO = BIO_new_mem_buf(cmsContent.bytes, (int)cmsContent.length);
+    BOOL signerMatched = NO;
+    return [self verifySignatureCMS:cmsContent data:data certificates:certificates signerMatched:&signerMatched];
+}
 
-    CMS_ContentInfo *contentInfo = d2i_CMS_bio(cmsBIO, NULL);
-    // DEBUG CMS_ContentInfo_print_ctx(printBIO, contentInfo, 0, NULL);
+// The user certificates come from the parsed key cache, so browsing a tree of folders shared by the
+// same users parses each PEM once; the signers are matched by fingerprint, O(certificates + signers).
+- (BOOL)verifySignatureCMS:(NSData *)cmsContent data:(NSData *)data certificates:(NSArray*)certificates signerMatched:(BOOL *)signerMatched
+{
+    *signerMatched = NO;
 
-    BOOL verifyResult = CMS_verify(contentInfo, NULL, NULL, dataBIO, NULL, CMS_DETACHED | CMS_NO_SIGNER_CERT_VERIFY);
+    BIO *cmsBIO = BIO_new_mem_buf(cmsContent.bytes, (int)cmsContent.length);
+    CMS_ContentInfo *contentInfo = d2i_CMS_bio(cmsBIO, NULL);
+    BIO_free(cmsBIO);
+    if (!contentInfo)
+        return NO;
 
+    BIO *dataBIO = BIO_new_mem_buf((void*)data.bytes, (int)data.length);
+    BOOL verifyResult = CMS_verify(contentInfo, NULL, NULL, dataBIO, NULL, CMS_DETACHED | CMS_NO_SIGNER_CERT_VERIFY) == 1;
     BIO_free(dataBIO);
-    BIO_free(printBIO);
-    BIO_free(cmsBIO);
 
-    if (verifyResult) {
+    if (verifyResult && certificates.count > 0) {
+        NSMutableSet<NSData *> *fingerprints = [NSMutableSet setWithCapacity:certificates.count];
+        for (NSString *certificate in certificates) {
+            NSData *fingerprint = [self certificateHandle:certificate].fingerprint;
+            if (fingerprint) {
+                [fingerprints addObject:fingerprint];
+            }
+        }
 
-        struct stack_st_CMS_SignerInfo* signerInfos = CMS_get0_SignerInfos(contentInfo);
         STACK_OF(X509) *signers = CMS_get0_signers(contentInfo);
-        int numSigners = sk_X509_num(signers);
+        for (int i = 0; i < sk_X509_num(signers) && !*signerMatched; i++) {
+            NSData *fingerprint = [self fingerprintOfCertificate:sk_X509_value(signers, i)];
+            *signerMatched = fingerprint && [fingerprints containsObject:fingerprint];
+        }
+        sk_X509_free(signers);
+    }
 
-        for (NSString *certificate in certificates) {
+    CMS_ContentInfo_free(contentInfo);
 
-            const char *ptrCertificate = [certificate cStringUsingEncoding:NSUTF8StringEncoding];
-            BIO *certBio = BIO_new(BIO_s_mem());
-            BIO_write(certBio, ptrCertificate,(unsigned int)strlen(ptrCertificate));
-            X509 *certX509 = PEM_read_bio_X509(certBio, NULL, NULL, NULL);
-            if (!certX509) {
-                continue;
-            }
+    return verifyResult;
+}
 
-            for (int i = 0; i < numSigners; ++i) {
-                struct CMS_SignerInfo_st *signerInfo = sk_CMS_SignerInfo_value(signerInfos, i);
-                if (CMS_SignerInfo_cert_cmp(signerInfo, certX509) == 0) {
-                    BIO_free(certBio);
-                    return true;
-                }
+- (NSInteger)verifySignatureJobs:(NSArray<NCEndToEndSignatureJob *> *)jobs concurrent:(BOOL)concurrent
+{
+    __block NSInteger verified = 0;
+    NSObject *lock = [NSObject new];
+
+    void (^verify)(size_t) = ^(size_t index) {
+        NCEndToEndSignatureJob *job = jobs[index];
+        BOOL signerMatched = NO;
+
+        job.verified = job.signature && job.data && [self verifySignatureCMS:job.signature data:job.data certificates:job.certificates signerMatched:&signerMatched];
+        job.signerMatched = signerMatched;
+        if (job.verified) {
+            @synchronized (lock) {
+                verified++;
             }
         }
+    };
+
+    if (concurrent && jobs.count > 1) {
+        dispatch_apply(jobs.count, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), verify);
+    } else {
+        for (size_t i = 0; i < jobs.count; i++) {
+            verify(i);
+        }
     }
 
-    return verifyResult;
+    return verified;
 }
 
 #
@@ -1504,6 +1667,46 @@ initializationVector:(NSData *)initializationVector
     return output;
 }
 
+- (NSString *)createSHA256ForFile:(NSString *)fileName
+{
+    NSString *sha256;
+    return [self createChecksumsForFile:fileName sha256:&sha256 sha512:nil] ? sha256 : nil;
+}
+
+- (NSString *)createSHA512ForFile:(NSString *)fileName
+{
+    NSString *sha512;
+    return [self createChecksumsForFile:fileName sha256:nil sha512:&sha512] ? sha512 : nil;
+}
+
+// All the requested digests are updated from the same mapped window, so asking for both costs one read of the file
+- (BOOL)createChecksumsForFile:(NSString *)fileName sha256:(NSString **)sha256 sha512:(NSString **)sha512
+{
+    unsigned int algorithms = (sha256 ? NC_E2EE_DIGEST_SHA256 : 0) | (sha512 ? NC_E2EE_DIGEST_SHA512 : 0);
+    if (!fileName || algorithms == 0) {
+        return NO;
+    }
+
+    nc_e2ee_digest digest;
+    if (!nc_e2ee_file_digest([fileName fileSystemRepresentation], algorithms, self.fileBlockSize, &digest)) {
+        return NO;
+    }
+
+    if (sha256) *sha256 = [self hexString:digest.sha256 length:NC_E2EE_DIGEST_SHA256_LENGTH];
+    if (sha512) *sha512 = [self hexString:digest.sha512 length:NC_E2EE_DIGEST_SHA512_LENGTH];
+
+    return YES;
+}
+
+- (NSString *)hexString:(const unsigned char *)bytes length:(size_t)length
+{
+    NSMutableString *output = [NSMutableString stringWithCapacity:length * 2];
+
+    for (size_t i = 0; i < length; i++)
+        [output appendFormat:@"%02x", bytes[i]];
+    return output;
+}
+
 - (NSData *)generateIV:(int)length
 {
     NSMutableData *ivData = [NSMutableData dataWithLength:length];
@@ -0,0 +1,897 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "NCEndToEndFileCipher.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <openssl/evp.h>
+
+// MARK: - I/O helpers
+
+static double nc_e2ee_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Reads up to `length` bytes, retrying short reads; returns the number of bytes read or -1.
+static ssize_t nc_e2ee_read_full(int fd, unsigned char *buffer, size_t length)
+{
+    size_t total = 0;
+    while (total < length) {
+        ssize_t n = read(fd, buffer + total, length - total);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) break;
+        total += (size_t)n;
+    }
+    return (ssize_t)total;
+}
+
+// Writes exactly `length` bytes; returns 1 on success, 0 otherwise.
+static int nc_e2ee_write_full(int fd, const unsigned char *buffer, size_t length)
+{
+    size_t total = 0;
+    while (total < length) {
+        ssize_t n = write(fd, buffer + total, length - total);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        total += (size_t)n;
+    }
+    return 1;
+}
+
+static int nc_e2ee_open_read(const char *path)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+#if defined(__APPLE__)
+    fcntl(fd, F_RDAHEAD, 1);
+#elif defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    return fd;
+}
+
+static int nc_e2ee_open_write(const char *path)
+{
+    return open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+}
+
+static const EVP_CIPHER *nc_e2ee_cipher(int keyLen)
+{
+    if (keyLen == 16) return EVP_aes_128_gcm();
+    if (keyLen == 32) return EVP_aes_256_gcm();
+    return NULL;
+}
+
+static void nc_e2ee_report_finish(nc_e2ee_file_report *report, double start)
+{
+    if (!report) return;
+    report->seconds = nc_e2ee_now() - start;
+    report->megabytesPerSecond = report->seconds > 0 ? ((double)report->bytesIn / (1024.0 * 1024.0)) / report->seconds : 0;
+}
+
+size_t nc_e2ee_file_block_size(size_t blockSize)
+{
+    if (blockSize == 0) return NC_E2EE_FILE_BLOCK_SIZE_DEFAULT;
+    if (blockSize < NC_E2EE_FILE_BLOCK_SIZE_MIN) return NC_E2EE_FILE_BLOCK_SIZE_MIN;
+    if (blockSize > NC_E2EE_FILE_BLOCK_SIZE_MAX) return NC_E2EE_FILE_BLOCK_SIZE_MAX;
+    return blockSize;
+}
+
+// MARK: - Digest
+
+int nc_e2ee_digest_init(nc_e2ee_digest *digest, unsigned int algorithms)
+{
+    if (!digest || (algorithms & (NC_E2EE_DIGEST_SHA256 | NC_E2EE_DIGEST_SHA512)) == 0) return 0;
+    memset(digest, 0, sizeof(*digest));
+    digest->algorithms = algorithms;
+
+    if (algorithms & NC_E2EE_DIGEST_SHA256) {
+        EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+        digest->sha256Ctx = ctx;
+        if (!ctx || EVP_DigestInit_ex(ctx, EVP_sha256(), NULL) <= 0) {
+            nc_e2ee_digest_free(digest);
+            return 0;
+        }
+    }
+    if (algorithms & NC_E2EE_DIGEST_SHA512) {
+        EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+        digest->sha512Ctx = ctx;
+        if (!ctx || EVP_DigestInit_ex(ctx, EVP_sha512(), NULL) <= 0) {
+            nc_e2ee_digest_free(digest);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int nc_e2ee_digest_update(nc_e2ee_digest *digest, const void *data, size_t length)
+{
+    if (!digest) return 0;
+    if (length == 0) return 1;
+    if (digest->sha256Ctx && EVP_DigestUpdate(digest->sha256Ctx, data, length) <= 0) return 0;
+    if (digest->sha512Ctx && EVP_DigestUpdate(digest->sha512Ctx, data, length) <= 0) return 0;
+    digest->bytes += length;
+    return 1;
+}
+
+int nc_e2ee_digest_final(nc_e2ee_digest *digest)
+{
+    if (!digest) return 0;
+    int success = 1;
+    if (digest->sha256Ctx && EVP_DigestFinal_ex(digest->sha256Ctx, digest->sha256, NULL) <= 0) success = 0;
+    if (digest->sha512Ctx && EVP_DigestFinal_ex(digest->sha512Ctx, digest->sha512, NULL) <= 0) success = 0;
+    nc_e2ee_digest_free(digest);
+    return success;
+}
+
+void nc_e2ee_digest_free(nc_e2ee_digest *digest)
+{
+    if (!digest) return;
+    EVP_MD_CTX_free(digest->sha256Ctx);
+    EVP_MD_CTX_free(digest->sha512Ctx);
+    digest->sha256Ctx = NULL;
+    digest->sha512Ctx = NULL;
+}
+
+// Fallback for files that cannot be mapped
+static int nc_e2ee_file_digest_read(int fd, nc_e2ee_digest *digest, size_t blockSize)
+{
+    unsigned char *buffer = malloc(blockSize);
+    if (!buffer) return 0;
+
+    int success = 1;
+    for (;;) {
+        ssize_t bytesRead = nc_e2ee_read_full(fd, buffer, blockSize);
+        if (bytesRead < 0 || !nc_e2ee_digest_update(digest, buffer, (size_t)bytesRead)) { success = 0; break; }
+        if ((size_t)bytesRead < blockSize) break;
+    }
+
+    free(buffer);
+    return success;
+}
+
+int nc_e2ee_file_digest(const char *path, unsigned int algorithms, size_t blockSize, nc_e2ee_digest *digest)
+{
+    if (!path || !nc_e2ee_digest_init(digest, algorithms)) return 0;
+
+    blockSize = nc_e2ee_file_block_size(blockSize);
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if (pageSize > 0) blockSize = (blockSize + (size_t)pageSize - 1) / (size_t)pageSize * (size_t)pageSize;
+
+    int fd = nc_e2ee_open_read(path);
+    if (fd < 0) {
+        nc_e2ee_digest_free(digest);
+        return 0;
+    }
+
+    int success = 0;
+    struct stat st;
+    do {
+        if (fstat(fd, &st) != 0) break;
+
+        // Map one window at a time: the whole file is never resident, and the windows are page aligned
+        uint64_t size = (uint64_t)st.st_size;
+        uint64_t offset = 0;
+        int mapped = S_ISREG(st.st_mode);
+        while (mapped && offset < size) {
+            size_t length = size - offset < (uint64_t)blockSize ? (size_t)(size - offset) : blockSize;
+            void *window = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, (off_t)offset);
+            if (window == MAP_FAILED) {
+                mapped = 0;
+                break;
+            }
+            madvise(window, length, MADV_SEQUENTIAL);
+            int updated = nc_e2ee_digest_update(digest, window, length);
+            munmap(window, length);
+            if (!updated) break;
+            offset += length;
+        }
+        if (mapped) {
+            if (offset < size) break;
+        } else {
+            if (offset > 0 && lseek(fd, (off_t)offset, SEEK_SET) < 0) break;
+            if (!nc_e2ee_file_digest_read(fd, digest, blockSize)) break;
+        }
+
+        success = nc_e2ee_digest_final(digest);
+    } while (0);
+
+    if (!success) nc_e2ee_digest_free(digest);
+    close(fd);
+    return success;
+}
+
+// MARK: - Encrypt
+
+// `ctx` is owned by the caller and can be reused across files (batch workers keep one each).
+static int nc_e2ee_file_encrypt_ctx(EVP_CIPHER_CTX *ctx,
+                                    const char *pathPlain,
+                                    const char *pathCipher,
+                                    const unsigned char *key, int keyLen,
+                                    const unsigned char *iv, int ivLen,
+                                    unsigned char tag[NC_E2EE_FILE_TAG_LENGTH],
+                                    size_t blockSize,
+                                    nc_e2ee_digest *plainDigest,
+                                    nc_e2ee_digest *cipherDigest,
+                                    nc_e2ee_file_report *report)
+{
+    const EVP_CIPHER *cipher = nc_e2ee_cipher(keyLen);
+    if (!ctx || !pathPlain || !pathCipher || !key || !iv || !tag || !cipher || EVP_CIPHER_CTX_reset(ctx) <= 0) {
+        nc_e2ee_digest_free(plainDigest);
+        nc_e2ee_digest_free(cipherDigest);
+        return 0;
+    }
+
+    double start = nc_e2ee_now();
+    blockSize = nc_e2ee_file_block_size(blockSize);
+    if (report) {
+        memset(report, 0, sizeof(*report));
+        report->blockSize = blockSize;
+        report->buffers = 1;
+    }
+
+    int success = 0;
+    int inFd = -1, outFd = -1;
+    unsigned char *buffer = NULL;
+
+    do {
+        if (EVP_EncryptInit_ex(ctx, cipher, NULL, NULL, NULL) <= 0) break;
+        if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, ivLen, NULL) <= 0) break;
+        if (EVP_EncryptInit_ex(ctx, NULL, NULL, key, iv) <= 0) break;
+
+        inFd = nc_e2ee_open_read(pathPlain);
+        if (inFd < 0) break;
+        outFd = nc_e2ee_open_write(pathCipher);
+        if (outFd < 0) break;
+
+        // GCM is a stream mode: the ciphertext has the plaintext length, so a single buffer is encrypted in place
+        buffer = malloc(blockSize + EVP_MAX_BLOCK_LENGTH);
+        if (!buffer) break;
+
+        int failed = 0;
+        for (;;) {
+            double stageStart = nc_e2ee_now();
+            ssize_t bytesRead = nc_e2ee_read_full(inFd, buffer, blockSize);
+            if (bytesRead < 0) { failed = 1; break; }
+            if (bytesRead == 0) break;
+            double readEnd = nc_e2ee_now();
+
+            // The buffer is encrypted in place: hash the plaintext before and the ciphertext after
+            if (plainDigest && !nc_e2ee_digest_update(plainDigest, buffer, (size_t)bytesRead)) { failed = 1; break; }
+            int outLen = 0;
+            if (EVP_EncryptUpdate(ctx, buffer, &outLen, buffer, (int)bytesRead) <= 0) { failed = 1; break; }
+            if (cipherDigest && !nc_e2ee_digest_update(cipherDigest, buffer, (size_t)outLen)) { failed = 1; break; }
+            double cipherEnd = nc_e2ee_now();
+
+            if (!nc_e2ee_write_full(outFd, buffer, (size_t)outLen)) { failed = 1; break; }
+
+            if (report) {
+                report->bytesIn += (uint64_t)bytesRead;
+                report->bytesOut += (uint64_t)outLen;
+                report->blocks++;
+                report->readSeconds += readEnd - stageStart;
+                report->cipherSeconds += cipherEnd - readEnd;
+                report->writeSeconds += nc_e2ee_now() - cipherEnd;
+            }
+            if ((size_t)bytesRead < blockSize) break;
+        }
+        if (failed) break;
+
+        // Finalize encryption (GCM produces no extra bytes here)
+        int outLen = 0;
+        if (EVP_EncryptFinal_ex(ctx, buffer, &outLen) <= 0) break;
+        if (outLen > 0 && !nc_e2ee_write_full(outFd, buffer, (size_t)outLen)) break;
+        if (cipherDigest && !nc_e2ee_digest_update(cipherDigest, buffer, (size_t)outLen)) break;
+
+        // Retrieve the authentication tag and append it to the end of the output file
+        if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, NC_E2EE_FILE_TAG_LENGTH, tag) <= 0) break;
+        if (!nc_e2ee_write_full(outFd, tag, NC_E2EE_FILE_TAG_LENGTH)) break;
+        if (cipherDigest && !nc_e2ee_digest_update(cipherDigest, tag, NC_E2EE_FILE_TAG_LENGTH)) break;
+
+        if (report) report->bytesOut += (uint64_t)outLen + NC_E2EE_FILE_TAG_LENGTH;
+        success = 1;
+    } while (0);
+
+    if (outFd >= 0 && close(outFd) != 0) success = 0;
+    if (inFd >= 0) close(inFd);
+    free(buffer);
+
+    if (success && plainDigest && !nc_e2ee_digest_final(plainDigest)) success = 0;
+    if (success && cipherDigest && !nc_e2ee_digest_final(cipherDigest)) success = 0;
+    nc_e2ee_digest_free(plainDigest);
+    nc_e2ee_digest_free(cipherDigest);
+
+    nc_e2ee_report_finish(report, start);
+    return success;
+}
+
+int nc_e2ee_file_encrypt(const char *pathPlain,
+                         const char *pathCipher,
+                         const unsigned char *key, int keyLen,
+                         const unsigned char *iv, int ivLen,
+                         unsigned char tag[NC_E2EE_FILE_TAG_LENGTH],
+                         size_t blockSize,
+                         nc_e2ee_file_report *report)
+{
+    return nc_e2ee_file_encrypt_digest(pathPlain, pathCipher, key, keyLen, iv, ivLen, tag, blockSize, NULL, NULL, report);
+}
+
+int nc_e2ee_file_encrypt_digest(const char *pathPlain,
+                                const char *pathCipher,
+                                const unsigned char *key, int keyLen,
+                                const unsigned char *iv, int ivLen,
+                                unsigned char tag[NC_E2EE_FILE_TAG_LENGTH],
+                                size_t blockSize,
+                                nc_e2ee_digest *plainDigest,
+                                nc_e2ee_digest *cipherDigest,
+                                nc_e2ee_file_report *report)
+{
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    int success = nc_e2ee_file_encrypt_ctx(ctx, pathPlain, pathCipher, key, keyLen, iv, ivLen, tag, blockSize, plainDigest, cipherDigest, report);
+
+    EVP_CIPHER_CTX_free(ctx);
+    return success;
+}
+
+// MARK: - Encrypt into chunks
+
+static void nc_e2ee_chunk_path(char *path, size_t length, const char *directory, size_t index)
+{
+    snprintf(path, length, "%s/%zu", directory, index);
+}
+
+int nc_e2ee_file_encrypt_chunks(const char *pathPlain,
+                                const char *directoryChunks,
+                                uint64_t chunkSize,
+                                const unsigned char *key, int keyLen,
+                                const unsigned char *iv, int ivLen,
+                                unsigned char tag[NC_E2EE_FILE_TAG_LENGTH],
+                                size_t blockSize,
+                                uint64_t *chunkSizes, size_t maxChunks, size_t *chunkCount,
+                                nc_e2ee_file_report *report)
+{
+    const EVP_CIPHER *cipher = nc_e2ee_cipher(keyLen);
+    if (!pathPlain || !directoryChunks || !key || !iv || !tag || !cipher) return 0;
+    if (chunkSize == 0 || !chunkSizes || maxChunks == 0 || !chunkCount) return 0;
+
+    double start = nc_e2ee_now();
+    blockSize = nc_e2ee_file_block_size(blockSize);
+    if (report) {
+        memset(report, 0, sizeof(*report));
+        report->blockSize = blockSize;
+        report->buffers = 1;
+    }
+
+    int success = 0;
+    int inFd = -1, outFd = -1;
+    size_t chunks = 0;
+    char path[4096];
+    unsigned char *buffer = NULL;
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) return 0;
+
+    do {
+        if (EVP_EncryptInit_ex(ctx, cipher, NULL, NULL, NULL) <= 0) break;
+        if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, ivLen, NULL) <= 0) break;
+        if (EVP_EncryptInit_ex(ctx, NULL, NULL, key, iv) <= 0) break;
+
+        inFd = nc_e2ee_open_read(pathPlain);
+        if (inFd < 0) break;
+
+        buffer = malloc(blockSize + EVP_MAX_BLOCK_LENGTH);
+        if (!buffer) break;
+
+        int failed = 0;
+        for (;;) {
+            // Never let a block straddle two chunks, the first one included and chunks smaller than a block
+            uint64_t current = (chunks > 0 && chunkSizes[chunks - 1] < chunkSize) ? chunkSizes[chunks - 1] : 0;
+            size_t toRead = blockSize;
+            if (chunkSize - current < (uint64_t)toRead) {
+                toRead = (size_t)(chunkSize - current);
+            }
+
+            ssize_t bytesRead = nc_e2ee_read_full(inFd, buffer, toRead);
+            if (bytesRead < 0) { failed = 1; break; }
+            if (bytesRead == 0) break;
+
+            // The next chunk is opened only when there are bytes for it, so the tag always lands in the last one
+            if (outFd < 0 || chunkSizes[chunks - 1] == chunkSize) {
+                if (outFd >= 0 && close(outFd) != 0) { outFd = -1; failed = 1; break; }
+                outFd = -1;
+                if (chunks == maxChunks) { failed = 1; break; }
+                nc_e2ee_chunk_path(path, sizeof(path), directoryChunks, chunks + 1);
+                outFd = nc_e2ee_open_write(path);
+                if (outFd < 0) { failed = 1; break; }
+                chunkSizes[chunks++] = 0;
+            }
+
+            int outLen = 0;
+            if (EVP_EncryptUpdate(ctx, buffer, &outLen, buffer, (int)bytesRead) <= 0) { failed = 1; break; }
+            if (!nc_e2ee_write_full(outFd, buffer, (size_t)outLen)) { failed = 1; break; }
+            chunkSizes[chunks - 1] += (uint64_t)outLen;
+
+            if (report) {
+                report->bytesIn += (uint64_t)bytesRead;
+                report->bytesOut += (uint64_t)outLen;
+                report->blocks++;
+            }
+            if ((size_t)bytesRead < toRead) break;
+        }
+        if (failed) break;
+
+        // Empty plaintext: the only chunk holds the tag
+        if (outFd < 0) {
+            nc_e2ee_chunk_path(path, sizeof(path), directoryChunks, 1);
+            outFd = nc_e2ee_open_write(path);
+            if (outFd < 0) break;
+            chunkSizes[chunks++] = 0;
+        }
+
+        int outLen = 0;
+        if (EVP_EncryptFinal_ex(ctx, buffer, &outLen) <= 0) break;
+        if (outLen > 0 && !nc_e2ee_write_full(outFd, buffer, (size_t)outLen)) break;
+        if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, NC_E2EE_FILE_TAG_LENGTH, tag) <= 0) break;
+        if (!nc_e2ee_write_full(outFd, tag, NC_E2EE_FILE_TAG_LENGTH)) break;
+        chunkSizes[chunks - 1] += (uint64_t)outLen + NC_E2EE_FILE_TAG_LENGTH;
+
+        if (report) report->bytesOut += (uint64_t)outLen + NC_E2EE_FILE_TAG_LENGTH;
+        success = 1;
+    } while (0);
+
+    if (outFd >= 0 && close(outFd) != 0) success = 0;
+    if (inFd >= 0) close(inFd);
+    free(buffer);
+    EVP_CIPHER_CTX_free(ctx);
+
+    if (!success) {
+        for (size_t i = 1; i <= chunks; i++) {
+            nc_e2ee_chunk_path(path, sizeof(path), directoryChunks, i);
+            unlink(path);
+        }
+        chunks = 0;
+    }
+    *chunkCount = chunks;
+
+    nc_e2ee_report_finish(report, start);
+    return success;
+}
+
+// MARK: - Decrypt pipeline
+
+// Three stages (read -> decrypt -> write) hand blocks to each other through bounded queues.
+// With NC_E2EE_PIPELINE_BUFFERS buffers every stage can work on its own block while the
+// next one is already queued, so the total time tends to the time of the slowest stage.
+
+#define NC_E2EE_PIPELINE_BUFFERS    4
+
+typedef struct {
+    unsigned char *data;
+    size_t length;
+} nc_e2ee_block;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    nc_e2ee_block *items[NC_E2EE_PIPELINE_BUFFERS];
+    int head;
+    int count;
+    int closed;     // no more pushes, pop drains the queue
+    int aborted;    // pipeline failed, pop/push return immediately
+} nc_e2ee_queue;
+
+static void nc_e2ee_queue_init(nc_e2ee_queue *queue)
+{
+    memset(queue, 0, sizeof(*queue));
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->cond, NULL);
+}
+
+static void nc_e2ee_queue_destroy(nc_e2ee_queue *queue)
+{
+    pthread_mutex_destroy(&queue->mutex);
+    pthread_cond_destroy(&queue->cond);
+}
+
+static int nc_e2ee_queue_push(nc_e2ee_queue *queue, nc_e2ee_block *block)
+{
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == NC_E2EE_PIPELINE_BUFFERS && !queue->aborted) {
+        pthread_cond_wait(&queue->cond, &queue->mutex);
+    }
+    int pushed = !queue->aborted;
+    if (pushed) {
+        queue->items[(queue->head + queue->count) % NC_E2EE_PIPELINE_BUFFERS] = block;
+        queue->count++;
+        pthread_cond_broadcast(&queue->cond);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return pushed;
+}
+
+// Returns NULL when the queue is closed and drained, or aborted.
+static nc_e2ee_block *nc_e2ee_queue_pop(nc_e2ee_queue *queue)
+{
+    nc_e2ee_block *block = NULL;
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == 0 && !queue->closed && !queue->aborted) {
+        pthread_cond_wait(&queue->cond, &queue->mutex);
+    }
+    if (queue->count > 0 && !queue->aborted) {
+        block = queue->items[queue->head];
+        queue->head = (queue->head + 1) % NC_E2EE_PIPELINE_BUFFERS;
+        queue->count--;
+        pthread_cond_broadcast(&queue->cond);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return block;
+}
+
+static void nc_e2ee_queue_close(nc_e2ee_queue *queue, int abort)
+{
+    pthread_mutex_lock(&queue->mutex);
+    queue->closed = 1;
+    if (abort) queue->aborted = 1;
+    pthread_cond_broadcast(&queue->cond);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+typedef struct {
+    int inFd;
+    int outFd;
+    size_t blockSize;
+    const unsigned char *tag;
+    int tagLen;
+
+    // Reader state: the last tagLen bytes are always held back, at EOF they are compared with the
+    // expected tag so an appended tag is detected in the same pass that reads the ciphertext.
+    unsigned char carry[NC_E2EE_FILE_TAG_LENGTH];
+    size_t carryLen;
+    int eof;
+
+    nc_e2ee_queue freeQueue;
+    nc_e2ee_queue readQueue;
+    nc_e2ee_queue writeQueue;
+
+    volatile int failed;
+    uint64_t bytesRead;
+    double readSeconds;
+    double writeSeconds;
+} nc_e2ee_decrypt_pipeline;
+
+static void nc_e2ee_pipeline_fail(nc_e2ee_decrypt_pipeline *pipeline)
+{
+    pipeline->failed = 1;
+    nc_e2ee_queue_close(&pipeline->freeQueue, 1);
+    nc_e2ee_queue_close(&pipeline->readQueue, 1);
+    nc_e2ee_queue_close(&pipeline->writeQueue, 1);
+}
+
+// Fills `block` with the next ciphertext bytes. Returns 1 when a block is produced, 0 at the end, -1 on error.
+static int nc_e2ee_pipeline_read(nc_e2ee_decrypt_pipeline *pipeline, nc_e2ee_block *block)
+{
+    if (pipeline->eof) return 0;
+
+    double start = nc_e2ee_now();
+    memcpy(block->data, pipeline->carry, pipeline->carryLen);
+    ssize_t n = nc_e2ee_read_full(pipeline->inFd, block->data + pipeline->carryLen, pipeline->blockSize);
+    if (n < 0) return -1;
+    pipeline->bytesRead += (uint64_t)n;
+
+    size_t total = pipeline->carryLen + (size_t)n;
+    size_t tagLen = (size_t)pipeline->tagLen;
+
+    if ((size_t)n < pipeline->blockSize) {
+        // End of file: drop the trailing tag if it is the expected one
+        pipeline->eof = 1;
+        if (total >= tagLen && memcmp(block->data + total - tagLen, pipeline->tag, tagLen) == 0) {
+            total -= tagLen;
+        }
+        block->length = total;
+        pipeline->carryLen = 0;
+    } else {
+        memcpy(pipeline->carry, block->data + total - tagLen, tagLen);
+        pipeline->carryLen = tagLen;
+        block->length = total - tagLen;
+    }
+
+    pipeline->readSeconds += nc_e2ee_now() - start;
+    return 1;
+}
+
+static void *nc_e2ee_pipeline_reader(void *arg)
+{
+    nc_e2ee_decrypt_pipeline *pipeline = arg;
+    nc_e2ee_block *block;
+
+    while ((block = nc_e2ee_queue_pop(&pipeline->freeQueue)) != NULL) {
+        int status = nc_e2ee_pipeline_read(pipeline, block);
+        if (status < 0) {
+            nc_e2ee_pipeline_fail(pipeline);
+            return NULL;
+        }
+        if (status == 0 || !nc_e2ee_queue_push(&pipeline->readQueue, block)) break;
+        if (pipeline->eof) break;
+    }
+    nc_e2ee_queue_close(&pipeline->readQueue, 0);
+    return NULL;
+}
+
+static void *nc_e2ee_pipeline_writer(void *arg)
+{
+    nc_e2ee_decrypt_pipeline *pipeline = arg;
+    nc_e2ee_block *block;
+
+    while ((block = nc_e2ee_queue_pop(&pipeline->writeQueue)) != NULL) {
+        double start = nc_e2ee_now();
+        if (!nc_e2ee_write_full(pipeline->outFd, block->data, block->length)) {
+            nc_e2ee_pipeline_fail(pipeline);
+            return NULL;
+        }
+        pipeline->writeSeconds += nc_e2ee_now() - start;
+        if (!nc_e2ee_queue_push(&pipeline->freeQueue, block)) break;
+    }
+    return NULL;
+}
+
+// MARK: - Decrypt
+
+// `ctx` is owned by the caller; `allowPipeline` is off for batch workers, which already use every core.
+static int nc_e2ee_file_decrypt_ctx(EVP_CIPHER_CTX *ctx,
+                                    const char *pathCipher,
+                                    const char *pathPlain,
+                                    const unsigned char *key, int keyLen,
+                                    const unsigned char *iv, int ivLen,
+                                    const unsigned char *tag, int tagLen,
+                                    size_t blockSize,
+                                    int allowPipeline,
+                                    nc_e2ee_file_report *report)
+{
+    const EVP_CIPHER *cipher = nc_e2ee_cipher(keyLen);
+    if (!ctx || !pathCipher || !pathPlain || !key || !iv || !tag || !cipher) return 0;
+    if (tagLen <= 0 || tagLen > NC_E2EE_FILE_TAG_LENGTH) return 0;
+    if (EVP_CIPHER_CTX_reset(ctx) <= 0) return 0;
+
+    double start = nc_e2ee_now();
+    blockSize = nc_e2ee_file_block_size(blockSize);
+    if (report) {
+        memset(report, 0, sizeof(*report));
+        report->blockSize = blockSize;
+    }
+
+    nc_e2ee_decrypt_pipeline pipeline;
+    memset(&pipeline, 0, sizeof(pipeline));
+    pipeline.inFd = -1;
+    pipeline.outFd = -1;
+    pipeline.blockSize = blockSize;
+    pipeline.tag = tag;
+    pipeline.tagLen = tagLen;
+    nc_e2ee_queue_init(&pipeline.freeQueue);
+    nc_e2ee_queue_init(&pipeline.readQueue);
+    nc_e2ee_queue_init(&pipeline.writeQueue);
+
+    int success = 0;
+    int buffers = 0;
+    nc_e2ee_block blocks[NC_E2EE_PIPELINE_BUFFERS];
+    memset(blocks, 0, sizeof(blocks));
+    double cipherSeconds = 0;
+    uint64_t decrypted = 0, count = 0;
+
+    do {
+        if (EVP_DecryptInit_ex(ctx, cipher, NULL, NULL, NULL) <= 0) break;
+        if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, ivLen, NULL) <= 0) break;
+        if (EVP_DecryptInit_ex(ctx, NULL, NULL, key, iv) <= 0) break;
+
+        pipeline.inFd = nc_e2ee_open_read(pathCipher);
+        if (pipeline.inFd < 0) break;
+        pipeline.outFd = nc_e2ee_open_write(pathPlain);
+        if (pipeline.outFd < 0) break;
+
+        // Small files are not worth two threads: run the same stages inline with one buffer
+        struct stat st;
+        if (fstat(pipeline.inFd, &st) != 0) break;
+        int pipelined = allowPipeline && (uint64_t)st.st_size > (uint64_t)blockSize * 2;
+        buffers = pipelined ? NC_E2EE_PIPELINE_BUFFERS : 1;
+
+        int allocated = 1;
+        for (int i = 0; i < buffers; i++) {
+            blocks[i].data = malloc(blockSize + NC_E2EE_FILE_TAG_LENGTH);
+            if (!blocks[i].data) allocated = 0;
+        }
+        if (!allocated) break;
+
+        if (!pipelined) {
+            int failed = 0, status;
+            while ((status = nc_e2ee_pipeline_read(&pipeline, &blocks[0])) > 0) {
+                double cipherStart = nc_e2ee_now();
+                int outLen = 0;
+                if (blocks[0].length > 0 &&
+                    EVP_DecryptUpdate(ctx, blocks[0].data, &outLen, blocks[0].data, (int)blocks[0].length) <= 0) { failed = 1; break; }
+                cipherSeconds += nc_e2ee_now() - cipherStart;
+
+                double writeStart = nc_e2ee_now();
+                if (!nc_e2ee_write_full(pipeline.outFd, blocks[0].data, (size_t)outLen)) { failed = 1; break; }
+                pipeline.writeSeconds += nc_e2ee_now() - writeStart;
+
+                decrypted += blocks[0].length;
+                count++;
+            }
+            if (failed || status < 0) break;
+        } else {
+            for (int i = 0; i < buffers; i++) {
+                nc_e2ee_queue_push(&pipeline.freeQueue, &blocks[i]);
+            }
+
+            pthread_t reader, writer;
+            if (pthread_create(&reader, NULL, nc_e2ee_pipeline_reader, &pipeline) != 0) break;
+            if (pthread_create(&writer, NULL, nc_e2ee_pipeline_writer, &pipeline) != 0) {
+                nc_e2ee_pipeline_fail(&pipeline);
+                pthread_join(reader, NULL);
+                break;
+            }
+
+            nc_e2ee_block *block;
+            while ((block = nc_e2ee_queue_pop(&pipeline.readQueue)) != NULL) {
+                double cipherStart = nc_e2ee_now();
+                int outLen = 0;
+                if (block->length > 0 &&
+                    EVP_DecryptUpdate(ctx, block->data, &outLen, block->data, (int)block->length) <= 0) {
+                    nc_e2ee_pipeline_fail(&pipeline);
+                    break;
+                }
+                cipherSeconds += nc_e2ee_now() - cipherStart;
+                block->length = (size_t)outLen;
+                decrypted += (uint64_t)outLen;
+                count++;
+                if (!nc_e2ee_queue_push(&pipeline.writeQueue, block)) break;
+            }
+            nc_e2ee_queue_close(&pipeline.writeQueue, 0);
+
+            pthread_join(reader, NULL);
+            pthread_join(writer, NULL);
+            if (pipeline.failed) break;
+        }
+
+        // Set the provided tag and finalize (verifies tag authenticity)
+        if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, tagLen, (void *)tag) <= 0) break;
+        int outLen = 0;
+        if (EVP_DecryptFinal_ex(ctx, blocks[0].data, &outLen) <= 0) break;
+        if (outLen > 0 && !nc_e2ee_write_full(pipeline.outFd, blocks[0].data, (size_t)outLen)) break;
+
+        success = 1;
+    } while (0);
+
+    if (pipeline.outFd >= 0 && close(pipeline.outFd) != 0) success = 0;
+    if (pipeline.inFd >= 0) close(pipeline.inFd);
+    for (int i = 0; i < NC_E2EE_PIPELINE_BUFFERS; i++) {
+        free(blocks[i].data);
+    }
+    nc_e2ee_queue_destroy(&pipeline.freeQueue);
+    nc_e2ee_queue_destroy(&pipeline.readQueue);
+    nc_e2ee_queue_destroy(&pipeline.writeQueue);
+
+    if (report) {
+        report->bytesIn = decrypted;
+        report->bytesOut = decrypted;
+        report->blocks = count;
+        report->buffers = (size_t)buffers;
+        report->readSeconds = pipeline.readSeconds;
+        report->cipherSeconds = cipherSeconds;
+        report->writeSeconds = pipeline.writeSeconds;
+    }
+    nc_e2ee_report_finish(report, start);
+    return success;
+}
+
+int nc_e2ee_file_decrypt(const char *pathCipher,
+                         const char *pathPlain,
+                         const unsigned char *key, int keyLen,
+                         const unsigned char *iv, int ivLen,
+                         const unsigned char *tag, int tagLen,
+                         size_t blockSize,
+                         nc_e2ee_file_report *report)
+{
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) return 0;
+
+    int success = nc_e2ee_file_decrypt_ctx(ctx, pathCipher, pathPlain, key, keyLen, iv, ivLen, tag, tagLen, blockSize, 1, report);
+
+    EVP_CIPHER_CTX_free(ctx);
+    return success;
+}
+
+// MARK: - Batch
+
+typedef struct {
+    nc_e2ee_file_job *jobs;
+    size_t count;
+    size_t next;
+    size_t succeeded;
+    size_t blockSize;
+    pthread_mutex_t mutex;
+} nc_e2ee_batch;
+
+static void *nc_e2ee_batch_worker(void *arg)
+{
+    nc_e2ee_batch *batch = arg;
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    size_t succeeded = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&batch->mutex);
+        size_t index = batch->next < batch->count ? batch->next++ : batch->count;
+        pthread_mutex_unlock(&batch->mutex);
+        if (index == batch->count) break;
+
+        nc_e2ee_file_job *job = &batch->jobs[index];
+        if (!ctx) {
+            job->result = 0;
+            continue;
+        }
+        if (job->operation == NC_E2EE_FILE_ENCRYPT) {
+            job->result = nc_e2ee_file_encrypt_ctx(ctx, job->source, job->destination, job->key, job->keyLen, job->iv, job->ivLen, job->tag, batch->blockSize, NULL, NULL, &job->report);
+            job->tagLen = job->result ? NC_E2EE_FILE_TAG_LENGTH : 0;
+        } else {
+            job->result = nc_e2ee_file_decrypt_ctx(ctx, job->source, job->destination, job->key, job->keyLen, job->iv, job->ivLen, job->tag, job->tagLen, batch->blockSize, 0, &job->report);
+        }
+        if (job->result) succeeded++;
+    }
+
+    EVP_CIPHER_CTX_free(ctx);
+
+    pthread_mutex_lock(&batch->mutex);
+    batch->succeeded += succeeded;
+    pthread_mutex_unlock(&batch->mutex);
+    return NULL;
+}
+
+size_t nc_e2ee_file_batch(nc_e2ee_file_job *jobs, size_t count, int workers, size_t blockSize)
+{
+    if (!jobs || count == 0) return 0;
+
+    if (workers <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cpus > 0 ? (int)cpus : 1;
+    }
+    if (workers > NC_E2EE_FILE_BATCH_MAX_WORKERS) workers = NC_E2EE_FILE_BATCH_MAX_WORKERS;
+    if ((size_t)workers > count) workers = (int)count;
+
+    nc_e2ee_batch batch;
+    memset(&batch, 0, sizeof(batch));
+    batch.jobs = jobs;
+    batch.count = count;
+    batch.blockSize = blockSize;
+    pthread_mutex_init(&batch.mutex, NULL);
+
+    // The calling thread is one of the workers
+    pthread_t threads[NC_E2EE_FILE_BATCH_MAX_WORKERS];
+    int started = 0;
+    for (int i = 1; i < workers; i++) {
+        if (pthread_create(&threads[started], NULL, nc_e2ee_batch_worker, &batch) == 0) started++;
+    }
+    nc_e2ee_batch_worker(&batch);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&batch.mutex);
+    return batch.succeeded;
+}
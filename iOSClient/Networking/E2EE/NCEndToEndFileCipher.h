@@ -0,0 +1,158 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Plain C AES-GCM file engine used by NCEndToEndEncryption.
+// It depends only on POSIX and OpenSSL, so it can be built and measured outside of Xcode.
+
+#ifndef NCEndToEndFileCipher_h
+#define NCEndToEndFileCipher_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NC_E2EE_FILE_BLOCK_SIZE_DEFAULT     (1024 * 1024)
+#define NC_E2EE_FILE_BLOCK_SIZE_MIN         (16 * 1024)
+#define NC_E2EE_FILE_BLOCK_SIZE_MAX         (16 * 1024 * 1024)
+#define NC_E2EE_FILE_TAG_LENGTH             16
+
+/// Throughput report filled by the file engine for a single encrypt/decrypt run.
+typedef struct {
+    uint64_t bytesIn;           // bytes read from the source file
+    uint64_t bytesOut;          // bytes written to the destination file (tag included when encrypting)
+    size_t blockSize;           // effective block size used for I/O and EVP calls
+    uint64_t blocks;            // number of EVP update calls
+    size_t buffers;             // blocks in flight (1 = serial, more = read/cipher/write pipeline)
+    double readSeconds;         // time spent in the read stage
+    double cipherSeconds;       // time spent in EVP calls
+    double writeSeconds;        // time spent in the write stage
+    double seconds;             // wall time of the whole run
+    double megabytesPerSecond;  // bytesIn / seconds, in MiB/s
+} nc_e2ee_file_report;
+
+/// Returns the block size that will actually be used for `blockSize` (0 selects the default).
+size_t nc_e2ee_file_block_size(size_t blockSize);
+
+#define NC_E2EE_DIGEST_SHA256               0x1
+#define NC_E2EE_DIGEST_SHA512               0x2
+#define NC_E2EE_DIGEST_SHA256_LENGTH        32
+#define NC_E2EE_DIGEST_SHA512_LENGTH        64
+
+/// Incremental SHA-256 / SHA-512 over a byte stream; several algorithms are updated by the same pass.
+/// The contexts are EVP_MD_CTX, kept opaque so that this header does not pull in OpenSSL.
+typedef struct {
+    unsigned int algorithms;                                // NC_E2EE_DIGEST_* mask
+    void *sha256Ctx;
+    void *sha512Ctx;
+    uint64_t bytes;                                         // bytes hashed so far
+    unsigned char sha256[NC_E2EE_DIGEST_SHA256_LENGTH];     // valid after nc_e2ee_digest_final
+    unsigned char sha512[NC_E2EE_DIGEST_SHA512_LENGTH];     // valid after nc_e2ee_digest_final
+} nc_e2ee_digest;
+
+/// @return 1 on success, 0 otherwise; on failure nothing has to be released.
+int nc_e2ee_digest_init(nc_e2ee_digest *digest, unsigned int algorithms);
+int nc_e2ee_digest_update(nc_e2ee_digest *digest, const void *data, size_t length);
+/// Writes the requested digests and releases the contexts.
+int nc_e2ee_digest_final(nc_e2ee_digest *digest);
+/// Releases the contexts of a digest that is abandoned before nc_e2ee_digest_final (safe to call twice).
+void nc_e2ee_digest_free(nc_e2ee_digest *digest);
+
+/// Hashes the file at `path` with all the `algorithms` in a single read, mapping it `blockSize` bytes at a
+/// time (rounded up to the page size, 0 selects the default); falls back to read(2) when mmap is not possible.
+///
+/// @return 1 on success, 0 otherwise.
+int nc_e2ee_file_digest(const char *path, unsigned int algorithms, size_t blockSize, nc_e2ee_digest *digest);
+
+/// Encrypts `pathPlain` into `pathCipher` with AES-GCM (128 or 256, chosen by `keyLen`).
+/// The output is [ciphertext || tag], byte-identical to the historic stream based implementation.
+///
+/// @return 1 on success, 0 otherwise (OpenSSL convention).
+int nc_e2ee_file_encrypt(const char *pathPlain,
+                         const char *pathCipher,
+                         const unsigned char *key, int keyLen,
+                         const unsigned char *iv, int ivLen,
+                         unsigned char tag[NC_E2EE_FILE_TAG_LENGTH],
+                         size_t blockSize,
+                         nc_e2ee_file_report *report);
+
+/// Same as nc_e2ee_file_encrypt, also hashing the plaintext into `plainDigest` and the output
+/// [ciphertext || tag] into `cipherDigest` while encrypting (either can be NULL). Both must have been
+/// initialized with nc_e2ee_digest_init; on success they are finalized, on failure released.
+int nc_e2ee_file_encrypt_digest(const char *pathPlain,
+                                const char *pathCipher,
+                                const unsigned char *key, int keyLen,
+                                const unsigned char *iv, int ivLen,
+                                unsigned char tag[NC_E2EE_FILE_TAG_LENGTH],
+                                size_t blockSize,
+                                nc_e2ee_digest *plainDigest,
+                                nc_e2ee_digest *cipherDigest,
+                                nc_e2ee_file_report *report);
+
+/// Encrypts `pathPlain` straight into chunk files named "1", "2", ... inside `directoryChunks`,
+/// each `chunkSize` bytes long; the tag is appended to the last chunk, so the concatenation of the
+/// chunks is the same [ciphertext || tag] produced by nc_e2ee_file_encrypt, without writing it twice.
+/// The size of every chunk is stored in `chunkSizes` (capacity `maxChunks`) and the count in `chunkCount`.
+/// On failure the chunk files already written are removed.
+///
+/// @return 1 on success, 0 otherwise.
+int nc_e2ee_file_encrypt_chunks(const char *pathPlain,
+                                const char *directoryChunks,
+                                uint64_t chunkSize,
+                                const unsigned char *key, int keyLen,
+                                const unsigned char *iv, int ivLen,
+                                unsigned char tag[NC_E2EE_FILE_TAG_LENGTH],
+                                size_t blockSize,
+                                uint64_t *chunkSizes, size_t maxChunks, size_t *chunkCount,
+                                nc_e2ee_file_report *report);
+
+/// Decrypts `pathCipher` into `pathPlain` and verifies `tag`.
+/// When the cipher file ends with `tag` (upload format) those bytes are excluded from the ciphertext;
+/// the check is done on the fly by the reader, without a separate read of the file tail.
+/// Files larger than two blocks are processed by a read -> decrypt -> write pipeline on three threads.
+///
+/// @return 1 on success (tag verified), 0 otherwise.
+int nc_e2ee_file_decrypt(const char *pathCipher,
+                         const char *pathPlain,
+                         const unsigned char *key, int keyLen,
+                         const unsigned char *iv, int ivLen,
+                         const unsigned char *tag, int tagLen,
+                         size_t blockSize,
+                         nc_e2ee_file_report *report);
+
+#define NC_E2EE_FILE_BATCH_MAX_WORKERS      16
+
+typedef enum {
+    NC_E2EE_FILE_ENCRYPT = 0,
+    NC_E2EE_FILE_DECRYPT = 1
+} nc_e2ee_file_operation;
+
+/// One file of a batch: paths and key material are borrowed and must stay valid during the call.
+typedef struct {
+    nc_e2ee_file_operation operation;
+    const char *source;
+    const char *destination;
+    const unsigned char *key;
+    int keyLen;
+    const unsigned char *iv;
+    int ivLen;
+    unsigned char tag[NC_E2EE_FILE_TAG_LENGTH];     // out when encrypting, in when decrypting
+    int tagLen;
+    int result;                                     // 1 on success, 0 otherwise
+    nc_e2ee_file_report report;
+} nc_e2ee_file_job;
+
+/// Runs `jobs` on a pool of `workers` threads (0 = online CPUs, at most NC_E2EE_FILE_BATCH_MAX_WORKERS),
+/// the calling thread included. Each worker reuses its own EVP_CIPHER_CTX for all the files it takes.
+///
+/// @return the number of jobs that succeeded; the outcome of each one is in its `result`.
+size_t nc_e2ee_file_batch(nc_e2ee_file_job *jobs, size_t count, int workers, size_t blockSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NCEndToEndFileCipher_h */
@@ -39,6 +39,17 @@ class NCEndToEndMetadata: NSObject {
             return (NKError(errorCode: NCGlobal.shared.errorE2EEJSon, errorDescription: "Unable to decode the metadata file"))
         }
 
+        // Same metadata as the last one verified and decoded for this folder: the tables already hold its content
+        var fingerprintData = data
+        fingerprintData.append(Data(("|" + (signature ?? "")).utf8))
+        let fingerprint = NCEndToEndEncryption.shared().createSHA256(fingerprintData)
+
+        if let fingerprint,
+           await self.database.getE2eMetadataVerifiedAsync(account: session.account, ocIdServerUrl: directory.ocId) == fingerprint {
+            await applyVerifiedMetadataV2(serverUrl: serverUrl, session: session)
+            return NKError()
+        }
+
         data.printJson()
 
         if (try? JSONDecoder().decode(E2eeV1.self, from: data)) != nil {
@@ -52,11 +63,15 @@ class NCEndToEndMetadata: NSObject {
                                            ocIdServerUrl: directory.ocId,
                                            session: session)
         } else if (try? JSONDecoder().decode(E2eeV2.self, from: data)) != nil {
-            return await decodeMetadataV2(metadata,
-                                          signature: signature,
-                                          serverUrl: serverUrl,
-                                          ocIdServerUrl: directory.ocId,
-                                          session: session)
+            let error = await decodeMetadataV2(metadata,
+                                               signature: signature,
+                                               serverUrl: serverUrl,
+                                               ocIdServerUrl: directory.ocId,
+                                               session: session)
+            if error == .success, let fingerprint {
+                await self.database.setE2eMetadataVerifiedAsync(account: session.account, serverUrl: serverUrl, ocIdServerUrl: directory.ocId, fingerprint: fingerprint)
+            }
+            return error
         } else {
             return NKError(errorCode: NCGlobal.shared.errorE2EEVersion,
                            errorDescription: "Unable to decode the metadata file")
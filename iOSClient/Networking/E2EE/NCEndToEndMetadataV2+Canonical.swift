@@ -0,0 +1,120 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+
+extension NCEndToEndMetadata {
+    /// Canonical JSON of the signed part of the metadata, written in one pass.
+    ///
+    /// Produces the same bytes as encoding with JSONEncoder and re-serializing with
+    /// JSONSerialization `[.sortedKeys, .withoutEscapingSlashes]`: keys in sorted order, absent optionals
+    /// omitted, no whitespace, `"` and `\` escaped, control characters as `\b \f \n \r \t` or `\u00xx`,
+    /// everything else (slashes and non-ASCII included) written as UTF-8.
+    final class CanonicalJSONWriter: @unchecked Sendable {
+        static let shared = CanonicalJSONWriter()
+
+        private var buffer: [UInt8] = []
+        private let lock = NSLock()
+        private static let hexDigits = Array("0123456789abcdef".utf8)
+
+        /// Canonical JSON of the signature, Base64 encoded as the CMS signature expects it
+        func signatureData(_ signature: E2eeV2Signature) -> Data {
+            lock.lock()
+            defer { lock.unlock() }
+
+            buffer.removeAll(keepingCapacity: true)
+            write(signature)
+
+            return Data(buffer).base64EncodedData()
+        }
+
+        func data(_ signature: E2eeV2Signature) -> Data {
+            lock.lock()
+            defer { lock.unlock() }
+
+            buffer.removeAll(keepingCapacity: true)
+            write(signature)
+
+            return Data(buffer)
+        }
+
+        // MARK: -
+
+        // Keys are written in sorted order: metadata < users < version,
+        // authenticationTag < ciphertext < nonce, certificate < encryptedMetadataKey < userId
+        private func write(_ signature: E2eeV2Signature) {
+            let metadata = signature.metadata
+            var reserve = metadata.ciphertext.utf8.count + metadata.nonce.utf8.count + metadata.authenticationTag.utf8.count + 128
+            for user in signature.users ?? [] {
+                reserve += user.certificate.utf8.count + user.userId.utf8.count + (user.encryptedMetadataKey?.utf8.count ?? 0) + 64
+            }
+            buffer.reserveCapacity(reserve)
+
+            append("{\"metadata\":{\"authenticationTag\":")
+            writeString(metadata.authenticationTag)
+            append(",\"ciphertext\":")
+            writeString(metadata.ciphertext)
+            append(",\"nonce\":")
+            writeString(metadata.nonce)
+            append("}")
+
+            if let users = signature.users {
+                append(",\"users\":[")
+                for (index, user) in users.enumerated() {
+                    if index > 0 {
+                        append(",")
+                    }
+                    append("{\"certificate\":")
+                    writeString(user.certificate)
+                    if let encryptedMetadataKey = user.encryptedMetadataKey {
+                        append(",\"encryptedMetadataKey\":")
+                        writeString(encryptedMetadataKey)
+                    }
+                    append(",\"userId\":")
+                    writeString(user.userId)
+                    append("}")
+                }
+                append("]")
+            }
+
+            append(",\"version\":")
+            writeString(signature.version)
+            append("}")
+        }
+
+        private func append(_ literal: StaticString) {
+            literal.withUTF8Buffer { buffer.append(contentsOf: $0) }
+        }
+
+        private func writeString(_ string: String) {
+            buffer.append(UInt8(ascii: "\""))
+
+            for byte in string.utf8 {
+                switch byte {
+                case UInt8(ascii: "\""):
+                    buffer.append(contentsOf: [UInt8(ascii: "\\"), UInt8(ascii: "\"")])
+                case UInt8(ascii: "\\"):
+                    buffer.append(contentsOf: [UInt8(ascii: "\\"), UInt8(ascii: "\\")])
+                case 0x08:
+                    buffer.append(contentsOf: [UInt8(ascii: "\\"), UInt8(ascii: "b")])
+                case 0x0C:
+                    buffer.append(contentsOf: [UInt8(ascii: "\\"), UInt8(ascii: "f")])
+                case UInt8(ascii: "\n"):
+                    buffer.append(contentsOf: [UInt8(ascii: "\\"), UInt8(ascii: "n")])
+                case UInt8(ascii: "\r"):
+                    buffer.append(contentsOf: [UInt8(ascii: "\\"), UInt8(ascii: "r")])
+                case UInt8(ascii: "\t"):
+                    buffer.append(contentsOf: [UInt8(ascii: "\\"), UInt8(ascii: "t")])
+                case 0x00..<0x20:
+                    buffer.append(contentsOf: [UInt8(ascii: "\\"), UInt8(ascii: "u"), UInt8(ascii: "0"), UInt8(ascii: "0"),
+                                               Self.hexDigits[Int(byte >> 4)], Self.hexDigits[Int(byte & 0x0F)]])
+                default:
+                    buffer.append(byte)
+                }
+            }
+
+            buffer.append(UInt8(ascii: "\""))
+        }
+    }
+}
@@ -80,6 +80,7 @@ extension NCEndToEndMetadata {
     // --------------------------------------------------------------------------------------------
 
     func encodeMetadataV2(serverUrl: String, ocIdServerUrl: String, addUserId: String?, addCertificate: String?, removeUserId: String?, session: NCSession.Session) async -> (metadata: String?, signature: String?, counter: Int, error: NKError) {
+        let start = Date()
         guard let directoryTop = await utilityFileSystem.getMetadataE2EETopAsync(serverUrl: serverUrl, session: session) else {
             return (nil, nil, 0, NKError(errorCode: NCGlobal.shared.errorE2EEKeyDirectoryTop,
                                          errorDescription: NSLocalizedString("_e2ee_no_dir_", comment: "")))
@@ -96,13 +97,18 @@ extension NCEndToEndMetadata {
         var metadataKey: String?
         var keyChecksums: [String] = []
         var usersCodable: [E2eeV2.Users] = []
-        var filesCodable: [String: E2eeV2.Metadata.ciphertext.Files] = [:]
-        var folders: [String: String] = [:]
         var counter: Int = 1
+        var usersChanged = false
 
-        func addUser(userId: String?, certificate: String?, key: Data) async {
+        func addUser(userId: String?, certificate: String?, key: Data, existing: tableE2eUsers? = nil) async {
             guard let userId, let certificate else { return }
 
+            // Same certificate and same metadata key: the wrapped key stored for the user is still valid
+            if let existing, existing.certificate == certificate, existing.metadataKey == key, existing.encryptedMetadataKey != nil {
+                return
+            }
+
+            usersChanged = true
             if let metadataKeyEncrypted = NCEndToEndEncryption.shared().encryptAsymmetricData(key, certificate: certificate) {
                 let encryptedMetadataKey = metadataKeyEncrypted.base64EncodedString()
                 await self.database.addE2EUsersAsync(account: session.account, serverUrl: serverUrl, ocIdServerUrl: ocIdServerUrl, userId: userId, certificate: certificate, encryptedMetadataKey: encryptedMetadataKey, metadataKey: key)
@@ -131,7 +137,7 @@ extension NCEndToEndMetadata {
 
             let users = await self.database.getE2EUsersAsync(account: session.account, directoryTopOcId: directoryTopOcId)
             for user in users {
-                await addUser(userId: user.userId, certificate: user.certificate, key: key)
+                await addUser(userId: user.userId, certificate: user.certificate, key: key, existing: user)
             }
 
             metadataKey = key.base64EncodedString()
@@ -149,6 +155,9 @@ extension NCEndToEndMetadata {
         // CHECKSUM
         //
         let users = await self.database.getE2EUsersAsync(account: session.account, directoryTopOcId: directoryTopOcId)
+        if isDirectoryTop, !usersChanged {
+            nkLog(tag: NCGlobal.shared.logTagE2EE, message: "Metadata V2 encode: wrapped metadata key reused for \(users.count) users")
+        }
         for user in users {
             if isDirectoryTop {
                 usersCodable.append(E2eeV2.Users(userId: user.userId, certificate: user.certificate, encryptedMetadataKey: user.encryptedMetadataKey))
@@ -165,16 +174,12 @@ extension NCEndToEndMetadata {
         }
 
         // CIPERTEXT
+        // Kept up to date with each add/rename/delete by the ciphertext cache, only serialized here
         //
-        let e2eEncryptions = await self.database.getE2eEncryptionsAsync(predicate: NSPredicate(format: "account == %@ AND serverUrl == %@", session.account, serverUrl))
-
-        for e2eEncryption in e2eEncryptions {
-            if e2eEncryption.mimeType == "httpd/unix-directory" {
-                folders[e2eEncryption.fileNameIdentifier] = e2eEncryption.fileName
-            } else {
-                let file = E2eeV2.Metadata.ciphertext.Files(authenticationTag: e2eEncryption.authenticationTag, filename: e2eEncryption.fileName, key: e2eEncryption.key, mimetype: e2eEncryption.mimeType, nonce: e2eEncryption.initializationVector)
-                filesCodable.updateValue(file, forKey: e2eEncryption.fileNameIdentifier)
-            }
+        let ciphertext = await self.database.getE2eCiphertextAsync(account: session.account, serverUrl: serverUrl)
+        let folders = ciphertext.folders
+        let filesCodable = ciphertext.files.mapValues {
+            E2eeV2.Metadata.ciphertext.Files(authenticationTag: $0.authenticationTag, filename: $0.fileName, key: $0.key, mimetype: $0.mimeType, nonce: $0.initializationVector)
         }
 
         do {
@@ -199,6 +204,8 @@ extension NCEndToEndMetadata {
             let e2eeJson = String(data: e2eeData, encoding: .utf8)
             let signature = createSignature(metadata: metadataCodable, users: usersCodable, version: capabilities.e2EEApiVersion, certificate: certificate, session: session)
 
+            logMetadataTiming(operation: "encode", start: start, users: usersCodable.count, files: filesCodable.count)
+
             return (e2eeJson, signature, counter, NKError())
 
         } catch let error {
@@ -215,6 +222,7 @@ extension NCEndToEndMetadata {
                           serverUrl: String,
                           ocIdServerUrl: String,
                           session: NCSession.Session) async -> NKError {
+        let start = Date()
         guard let data = json.data(using: .utf8),
               let directoryTop = await utilityFileSystem.getMetadataE2EETopAsync(serverUrl: serverUrl, session: session) else {
             return NKError(errorCode: NCGlobal.shared.errorE2EEKeyDirectoryTop,
@@ -429,6 +437,8 @@ extension NCEndToEndMetadata {
 
             print("DECODE SUCCESS ------------------------\n\n")
 
+            logMetadataTiming(operation: "decode", start: start, users: users?.count ?? 0, files: jsonCiphertextMetadata.files?.count ?? 0)
+
         } catch let error {
             return NKError(errorCode: NCGlobal.shared.errorE2EEJSon,
                            errorDescription: error.localizedDescription)
@@ -437,6 +447,55 @@ extension NCEndToEndMetadata {
         return returnError
     }
 
+    // --------------------------------------------------------------------------------------------
+    // MARK: Verified Metadata V2
+    // --------------------------------------------------------------------------------------------
+
+    /// Metadata unchanged since it was last verified and decoded: no decryption or signature check, only the
+    /// decrypted names are set again on the listing, which the folder read resets to the identifiers
+    func applyVerifiedMetadataV2(serverUrl: String, session: NCSession.Session) async {
+        let start = Date()
+        let ciphertext = await self.database.getE2eCiphertextAsync(account: session.account, serverUrl: serverUrl)
+        var fileNames = ciphertext.folders
+        for (fileNameIdentifier, file) in ciphertext.files {
+            fileNames[fileNameIdentifier] = file.fileName
+        }
+        guard !fileNames.isEmpty else {
+            return
+        }
+
+        let metadatas = await self.database.getMetadatasAsync(predicate: NSPredicate(format: "account == %@ AND serverUrl == %@ AND fileName IN %@", session.account, serverUrl, Array(fileNames.keys)))
+        var updated: [tableMetadata] = []
+
+        for metadata in metadatas {
+            guard let fileName = fileNames[metadata.fileName], metadata.fileNameView != fileName else {
+                continue
+            }
+            metadata.fileNameView = fileName
+
+            let results = await NKTypeIdentifiers.shared.getInternalType(fileName: fileName, mimeType: "", directory: false, account: session.account)
+            metadata.contentType = results.mimeType
+            metadata.iconName = results.iconName
+            metadata.classFile = results.classFile
+            metadata.typeIdentifier = results.typeIdentifier
+
+            updated.append(metadata)
+        }
+
+        await self.database.addMetadatasAsync(updated)
+
+        let milliseconds = Date().timeIntervalSince(start) * 1000
+        nkLog(tag: NCGlobal.shared.logTagE2EE, message: "Metadata V2 unchanged since verified: \(updated.count) of \(fileNames.count) names applied in \(String(format: "%.1f", milliseconds)) ms")
+    }
+
+    // Encode/decode cost, with the parsed key cache counters: every user certificate and the private key
+    // are used here, so the hit ratio shows how much PEM parsing the cache is saving
+    private func logMetadataTiming(operation: String, start: Date, users: Int, files: Int) {
+        let milliseconds = Date().timeIntervalSince(start) * 1000
+        let statistics = NCEndToEndEncryption.shared().keyCacheStatistics()
+        nkLog(tag: NCGlobal.shared.logTagE2EE, message: "Metadata V2 \(operation): \(users) users, \(files) files in \(String(format: "%.1f", milliseconds)) ms (key cache hits \(statistics["hits"] ?? 0), misses \(statistics["misses"] ?? 0))")
+    }
+
     // MARK: -
 
     func createSignature(metadata: E2eeV2.Metadata, users: [E2eeV2.Users]?, version: String, certificate: String, session: NCSession.Session) -> String? {
@@ -449,25 +508,16 @@ extension NCEndToEndMetadata {
 
         let signatureCodable = E2eeV2Signature(metadata: E2eeV2Signature.Metadata(ciphertext: metadata.ciphertext, nonce: metadata.nonce, authenticationTag: metadata.authenticationTag), users: usersSignatureCodable, version: version)
 
-        do {
-            let jsonEncoder = JSONEncoder()
-            let json = try jsonEncoder.encode(signatureCodable)
-            let dataSerialization = try JSONSerialization.jsonObject(with: json, options: [])
-            let decoded = try? JSONSerialization.data(withJSONObject: dataSerialization, options: [.sortedKeys, .withoutEscapingSlashes])
-            let base64 = decoded!.base64EncodedString()
-            if let base64Data = base64.data(using: .utf8),
-               let signatureData = NCEndToEndEncryption.shared().generateSignatureCMS(base64Data, certificate: certificate, privateKey: NCPreferences().getEndToEndPrivateKey(account: session.account), userId: session.userId) {
-                return signatureData.base64EncodedString()
-            }
-        } catch {
-            print("Error: \(error.localizedDescription)")
+        let base64Data = CanonicalJSONWriter.shared.signatureData(signatureCodable)
+        if let signatureData = NCEndToEndEncryption.shared().generateSignatureCMS(base64Data, certificate: certificate, privateKey: NCPreferences().getEndToEndPrivateKey(account: session.account), userId: session.userId) {
+            return signatureData.base64EncodedString()
         }
 
         return nil
     }
 
     func verifySignature(account: String, signature: String, userId: String, metadata: E2eeV2.Metadata, users: [E2eeV2.Users]?, version: String, certificate: String) -> Bool {
-        var signatureCodable: E2eeV2Signature?
+        let signatureCodable: E2eeV2Signature
         var certificates: [String] = []
 
         if let users {
@@ -482,21 +532,9 @@ extension NCEndToEndMetadata {
             certificates = [certificate]
         }
 
-        do {
-            let jsonEncoder = JSONEncoder()
-            let json = try jsonEncoder.encode(signatureCodable)
-            let dataSerialization = try JSONSerialization.jsonObject(with: json, options: [])
-            if var dataSerialization = dataSerialization as? [String: Any?] {
-                dataSerialization = dataSerialization.compactMapValues { $0 }
-                let decodedSignatureCodable = try JSONSerialization.data(withJSONObject: dataSerialization, options: [.sortedKeys, .withoutEscapingSlashes])
-                let base64 = decodedSignatureCodable.base64EncodedString()
-                if let data = base64.data(using: .utf8), let signatureData = Data(base64Encoded: signature) {
-                    return NCEndToEndEncryption.shared().verifySignatureCMS(signatureData, data: data, certificates: certificates)
-                }
-            }
-
-        } catch {
-            print("Error: \(error.localizedDescription)")
+        let data = CanonicalJSONWriter.shared.signatureData(signatureCodable)
+        if let signatureData = Data(base64Encoded: signature) {
+            return NCEndToEndEncryption.shared().verifySignatureCMS(signatureData, data: data, certificates: certificates)
         }
 
         return false
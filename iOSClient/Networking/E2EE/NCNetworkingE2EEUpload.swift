@@ -17,6 +17,71 @@ class NCNetworkingE2EEUpload: NSObject {
     let database = NCManageDatabase.shared
     var numChunks: Int = 0
 
+    /// Outcome of one file of a batch upload, in the order the metadatas were passed
+    struct BatchResult {
+        let ocIdTransfer: String
+        let fileName: String
+        let error: NKError
+    }
+
+    /// Files of a batch uploaded at the same time while the folder is locked (chunked files go one by one)
+    private let batchConcurrentUploads = 4
+
+    /// Files the pipeline sends in one run to encrypted folders; they take no transfer slot, this bounds the run instead
+    static let batchMaximumFiles = 50
+
+    private struct Encryption {
+        let key: String
+        let initializationVector: String
+        let authenticationTag: String
+    }
+
+    /// Requests and chunk tasks of the files a batch is sending, cancelled together with the batch
+    private final class BatchTransfers: @unchecked Sendable {
+        private let lock = NSLock()
+        private var requests: [UploadRequest] = []
+        private var tasks: [Task<(account: String, file: NKFile?, error: NKError), Never>] = []
+        private var cancelled = false
+
+        func add(_ request: UploadRequest) {
+            lock.lock()
+            let cancelled = self.cancelled
+            if !cancelled {
+                requests.append(request)
+            }
+            lock.unlock()
+            if cancelled {
+                request.cancel()
+            }
+        }
+
+        func add(_ task: Task<(account: String, file: NKFile?, error: NKError), Never>?) {
+            guard let task else { return }
+            lock.lock()
+            let cancelled = self.cancelled
+            if !cancelled {
+                tasks.append(task)
+            }
+            lock.unlock()
+            if cancelled {
+                task.cancel()
+            }
+        }
+
+        func cancel() {
+            lock.lock()
+            cancelled = true
+            let requests = self.requests
+            let tasks = self.tasks
+            self.requests.removeAll()
+            self.tasks.removeAll()
+            lock.unlock()
+
+            requests.forEach { $0.cancel() }
+            tasks.forEach { $0.cancel() }
+        }
+    }
+
     @discardableResult
     @MainActor
     func upload(metadata: tableMetadata,
@@ -49,27 +114,18 @@ class NCNetworkingE2EEUpload: NSObject {
             }
         }
 
-        var payload = LucidBannerPayload.Update()
-        payload.title = NSLocalizedString("_wait_file_encryption_", comment: "")
-        payload.subtitle = NSLocalizedString("_e2ee_upload_tip_", comment: "")
-        payload.systemImage = "lock.circle.fill"
+        updateBanner(banner, tokenBanner: tokenBanner)
 
-        banner?.update(payload: payload, for: tokenBanner)
-        banner?.requestRelayout(animated: true)
-
-        if let result = await self.database.getMetadataAsync(predicate: NSPredicate(format: "serverUrl == %@ AND fileNameView == %@ AND ocId != %@", metadata.serverUrl, metadata.fileNameView, metadata.ocId)) {
-            metadata.fileName = result.fileName
-        } else {
-            metadata.fileName = networkingE2EE.generateRandomIdentifier()
-        }
-        metadata.session = NCNetworking.shared.sessionUpload
-        metadata.status = global.metadataStatusUploading
-        metadata.sessionError = ""
-        metadata.serverUrlFileName = utilityFileSystem.createServerUrl(serverUrl: metadata.serverUrl, fileName: metadata.fileName)
-
-        guard let metadata = await self.database.addAndReturnMetadataAsync(metadata) else {
+        guard let metadata = await prepare(metadata: metadata) else {
             return .invalidData
         }
+#if !EXTENSION
+        defer {
+            Task {
+                await NCTransferJournal.shared.end(ocId: metadata.ocId)
+            }
+        }
+#endif
 
         guard let directory = await self.database.getTableDirectoryAsync(predicate: NSPredicate(format: "account == %@ AND serverUrl == %@", metadata.account, metadata.serverUrl)) else {
             finalError = NKError(errorCode: NCGlobal.shared.errorUnexpectedResponseFromDB,
@@ -78,19 +134,13 @@ class NCNetworkingE2EEUpload: NSObject {
         }
 
         func sendE2ee(e2eToken: String, fileId: String) async -> NKError {
-            var key: NSString?, initializationVector: NSString?, authenticationTag: NSString?
             var method = "POST"
 
             // ENCRYPT FILE
             //
-            if NCEndToEndEncryption.shared().encryptFile(metadata.fileNameView, fileNameIdentifier: metadata.fileName, directory: utilityFileSystem.getDirectoryProviderStorageOcId(metadata.ocId, userId: metadata.userId, urlBase: metadata.urlBase), key: &key, initializationVector: &initializationVector, authenticationTag: &authenticationTag) == false {
-                finalError = NKError(errorCode: NCGlobal.shared.errorE2EEEncryptFile,
-                                     errorDescription: NSLocalizedString("_e2ee_no_enc_file_", comment: ""))
-                return finalError
-            }
-            guard let key = key as? String, let initializationVector = initializationVector as? String else {
-                finalError = NKError(errorCode: NCGlobal.shared.errorE2EEEncodedKey,
-                                     errorDescription: NSLocalizedString("_e2ee_no_enc_key_", comment: ""))
+            let resultsEncrypt = await encrypt(metadata: metadata)
+            guard let encryption = resultsEncrypt.encryption else {
+                finalError = resultsEncrypt.error
                 return finalError
             }
 
@@ -106,28 +156,11 @@ class NCNetworkingE2EEUpload: NSObject {
 
             // CREATE E2E METADATA
             //
-            await self.database.deleteE2eEncryptionAsync(predicate: NSPredicate(format: "account == %@ AND serverUrl == %@ AND fileName == %@", metadata.account, metadata.serverUrl, metadata.fileNameView))
-            let object = tableE2eEncryption.init(account: metadata.account, ocIdServerUrl: directory.ocId, fileNameIdentifier: metadata.fileName)
-            if let results = await self.database.getE2eEncryptionAsync(predicate: NSPredicate(format: "account == %@ AND serverUrl == %@", metadata.account, metadata.serverUrl)) {
-                object.metadataKey = results.metadataKey
-                object.metadataKeyIndex = results.metadataKeyIndex
-            } else {
-                guard let key = NCEndToEndEncryption.shared().generateKey() as NSData? else {
-                    finalError = NKError(errorCode: NCGlobal.shared.errorE2EEGenerateKey,
-                                         errorDescription: NSLocalizedString("_e2ee_no_generate_key_", comment: ""))
-                    return finalError
-                }
-                object.metadataKey = key.base64EncodedString()
-                object.metadataKeyIndex = 0
+            let errorAddE2eEncryption = await addE2eEncryption(metadata: metadata, ocIdServerUrl: directory.ocId, encryption: encryption)
+            guard errorAddE2eEncryption == .success else {
+                finalError = errorAddE2eEncryption
+                return finalError
             }
-            object.authenticationTag = authenticationTag! as String
-            object.fileName = metadata.fileNameView
-            object.key = key
-            object.initializationVector = initializationVector
-            object.mimeType = metadata.contentType
-            object.serverUrl = metadata.serverUrl
-
-            await self.database.addE2eEncryptionAsync(object)
 
             // UPLOAD METADATA
             //
@@ -183,58 +216,396 @@ class NCNetworkingE2EEUpload: NSObject {
         await networkingE2EE.unlock(account: metadata.account, serverUrl: metadata.serverUrl)
 
         if resultsSendFile.error == .success, let ocId = resultsSendFile.ocId {
-            let metadata = metadata.detachedCopy()
+            await uploadSuccess(metadata: metadata, ocId: ocId, resultsSendFile: resultsSendFile)
+        }
+
+        finalError = resultsSendFile.error
+        return finalError
+    }
+
+    /// Uploads several files of the same encrypted folder under a single lock.
+    /// All files are encrypted and added to the metadata, which is sent once before the files; files that then fail to
+    /// upload are rolled back in the metadata with a second update: a new file is removed, a replaced file gets the entry
+    /// it had before the batch back. Every file gets its own result, and failed files are removed from the transfers
+    /// exactly as with `upload(metadata:)`.
+    /// Cancelling the task that runs the batch cancels the files being sent; the files not started yet fail as cancelled.
+    @discardableResult
+    @MainActor
+    func uploadBatch(metadatas: [tableMetadata],
+                     session: NCSession.Session? = nil,
+                     controller: UIViewController? = nil,
+                     banner: LucidBanner?,
+                     stageBanner: LucidBanner.Stage?,
+                     tokenBanner: Int?)
+    async -> [BatchResult] {
+        guard let first = metadatas.first else {
+            return []
+        }
+        guard metadatas.allSatisfy({ $0.account == first.account && $0.serverUrl == first.serverUrl }) else {
+            // One lock covers one folder: split the batch per folder
+            var results: [BatchResult] = []
+            var groups: [String: [tableMetadata]] = [:]
+            var order: [String] = []
+            for metadata in metadatas {
+                let key = metadata.account + "|" + metadata.serverUrl
+                if groups[key] == nil { order.append(key) }
+                groups[key, default: []].append(metadata)
+            }
+            for key in order {
+                results += await uploadBatch(metadatas: groups[key] ?? [], session: session, controller: controller, banner: banner, stageBanner: stageBanner, tokenBanner: tokenBanner)
+            }
+            let resultsByOcId = Dictionary(results.map { ($0.ocIdTransfer, $0) }, uniquingKeysWith: { first, _ in first })
+            return metadatas.compactMap { resultsByOcId[$0.ocIdTransfer] }
+        }
+
+        let account = first.account
+        let serverUrl = first.serverUrl
+        var errors: [String: NKError] = [:]
+
+        func results() -> [BatchResult] {
+            return metadatas.map { BatchResult(ocIdTransfer: $0.ocIdTransfer, fileName: $0.fileNameView, error: errors[$0.ocIdTransfer] ?? .success) }
+        }
+
+        func fail(_ metadata: tableMetadata, error: NKError) async {
+            errors[metadata.ocIdTransfer] = error
+#if !EXTENSION
+            await NCTransferJournal.shared.end(ocId: metadata.ocId)
+#endif
+            await self.database.deleteMetadataAsync(predicate: NSPredicate(format: "ocIdTransfer == %@", metadata.ocIdTransfer))
+        }
+
+        func failAll(_ metadatas: [tableMetadata], error: NKError) async -> [BatchResult] {
+            for metadata in metadatas where errors[metadata.ocIdTransfer] == nil {
+                await fail(metadata, error: error)
+            }
+            return results()
+        }
+
+        // Cancelled while an earlier folder of the batch was being sent
+        guard !Task.isCancelled else {
+            return await failAll(metadatas, error: NKError(errorCode: NCGlobal.shared.errorTaskCancelled, errorDescription: "Task cancelled"))
+        }
+
+        guard let session = session ?? NCSession.shared.getSession(account: account),
+              !session.account.isEmpty else {
+            return await failAll(metadatas, error: NKError(errorCode: NCGlobal.shared.errorNCSessionNotFound,
+                                                           errorDescription: NSLocalizedString("_e2ee_no_session_", comment: "")))
+        }
+
+        updateBanner(banner, tokenBanner: tokenBanner)
+
+        var prepared: [tableMetadata] = []
+        for metadata in metadatas {
+            if let metadata = await prepare(metadata: metadata) {
+                prepared.append(metadata)
+            } else {
+                await fail(metadata, error: .invalidData)
+            }
+        }
+
+        guard let directory = await self.database.getTableDirectoryAsync(predicate: NSPredicate(format: "account == %@ AND serverUrl == %@", account, serverUrl)) else {
+            return await failAll(prepared, error: NKError(errorCode: NCGlobal.shared.errorUnexpectedResponseFromDB,
+                                                          errorDescription: NSLocalizedString("_e2ee_no_dir_", comment: "")))
+        }
+
+        // LOCK
+        //
+        let resultsLock = await networkingE2EE.lock(account: account, serverUrl: serverUrl)
+        guard let e2eToken = resultsLock.e2eToken,
+              let fileId = resultsLock.fileId,
+              resultsLock.error == .success else {
+            return await failAll(prepared, error: NKError(errorCode: NCGlobal.shared.errorE2EELock,
+                                                          errorDescription: NSLocalizedString("_e2ee_no_lock_", comment: "")))
+        }
+
+        // DOWNLOAD METADATA
+        //
+        var method = "POST"
+        let errorDownloadMetadata = await networkingE2EE.downloadMetadata(serverUrl: serverUrl, fileId: fileId, e2eToken: e2eToken, session: session)
+        if errorDownloadMetadata == .success {
+            method = "PUT"
+        } else if errorDownloadMetadata.errorCode != NCGlobal.shared.errorResourceNotFound {
+            await networkingE2EE.unlock(account: account, serverUrl: serverUrl)
+            return await failAll(prepared, error: errorDownloadMetadata)
+        }
+
+        // Entries of the files the batch replaces, put back for the files that are not uploaded
+        let replaced = await self.database.getE2eEncryptionsAsync(predicate: NSPredicate(format: "account == %@ AND serverUrl == %@ AND fileName IN %@", account, serverUrl, prepared.map { $0.fileNameView }))
 
-            await self.database.deleteMetadataAsync(id: metadata.ocId)
-            await utilityFileSystem.moveFileAsync(atPath: utilityFileSystem.getDirectoryProviderStorageOcId(metadata.ocId, userId: metadata.userId, urlBase: metadata.urlBase),
-                                                  toPath: utilityFileSystem.getDirectoryProviderStorageOcId(ocId, userId: metadata.userId, urlBase: metadata.urlBase))
+        func rollback(_ metadatas: [tableMetadata]) async {
+            for metadata in metadatas {
+                await self.database.deleteE2eEncryptionAsync(predicate: NSPredicate(format: "account == %@ AND serverUrl == %@ AND fileNameIdentifier == %@", account, serverUrl, metadata.fileName))
+                if let previous = replaced.first(where: { $0.fileName == metadata.fileNameView }) {
+                    await self.database.addE2eEncryptionAsync(tableE2eEncryption(value: previous))
+                }
+            }
+        }
 
-            metadata.date = (resultsSendFile.date as? NSDate) ?? NSDate()
-            metadata.etag = resultsSendFile.etag ?? ""
-            metadata.ocId = ocId
-            if let fileId = self.utility.ocIdToFileId(ocId: ocId) {
-                metadata.fileId = fileId
+        // ENCRYPT FILES + CREATE E2E METADATA
+        //
+        var encrypted: [tableMetadata] = []
+        for metadata in prepared {
+            let resultsEncrypt = await encrypt(metadata: metadata)
+            guard let encryption = resultsEncrypt.encryption else {
+                await fail(metadata, error: resultsEncrypt.error)
+                continue
+            }
+            let error = await addE2eEncryption(metadata: metadata, ocIdServerUrl: directory.ocId, encryption: encryption)
+            guard error == .success else {
+                await rollback([metadata])
+                await fail(metadata, error: error)
+                continue
+            }
+            encrypted.append(metadata)
+        }
+
+        // UPLOAD METADATA (one update for the whole batch)
+        //
+        if !encrypted.isEmpty {
+            let uploadMetadataError = await networkingE2EE.uploadMetadata(serverUrl: serverUrl,
+                                                                          ocIdServerUrl: directory.ocId,
+                                                                          fileId: fileId,
+                                                                          e2eToken: e2eToken,
+                                                                          method: method,
+                                                                          session: session)
+            guard uploadMetadataError == .success else {
+                await rollback(encrypted)
+                await networkingE2EE.unlock(account: account, serverUrl: serverUrl)
+                return await failAll(encrypted, error: uploadMetadataError)
             }
-            if let ownerId = resultsSendFile.ownerId.isNotEmpty {
-                metadata.ownerId = ownerId
-                if let ownerDisplayName = await self.database.getOwnerDisplayName(account: metadata.account, ownerId: ownerId) {
-                    metadata.ownerDisplayName = ownerDisplayName
+        }
+
+        // UPLOAD
+        //
+        var completed: Set<String> = []
+        var failed: [tableMetadata] = []
+        let transfers = BatchTransfers()
+
+        await withTaskCancellationHandler {
+            await withTaskGroup(of: (tableMetadata, (ocId: String?, etag: String?, date: Date?, ownerId: String?, permissions: String?, error: NKError)).self) { group in
+                var iterator = encrypted.makeIterator()
+
+                func addNext() {
+                    guard !Task.isCancelled,
+                          let metadata = iterator.next() else { return }
+                    group.addTask { @MainActor in
+                        // Progress of single files would interleave in the banner: the batch reports files completed instead
+                        let resultsSendFile = await self.sendFile(metadata: metadata,
+                                                                  e2eToken: e2eToken,
+                                                                  controller: controller,
+                                                                  banner: nil,
+                                                                  stageBanner: stageBanner,
+                                                                  tokenBanner: nil,
+                                                                  requestHandle: { transfers.add($0) },
+                                                                  currentUploadTask: { transfers.add($0) })
+                        return (metadata, resultsSendFile)
+                    }
+                }
+
+                let width = encrypted.contains { $0.chunk > 0 } ? 1 : batchConcurrentUploads
+                for _ in 0..<width {
+                    addNext()
+                }
+
+                while let (metadata, resultsSendFile) = await group.next() {
+                    completed.insert(metadata.ocIdTransfer)
+                    if resultsSendFile.error == .success, let ocId = resultsSendFile.ocId {
+                        await uploadSuccess(metadata: metadata, ocId: ocId, resultsSendFile: resultsSendFile)
+                    } else {
+                        await fail(metadata, error: resultsSendFile.error)
+                        failed.append(metadata)
+                    }
+
+                    var payload = LucidBannerPayload.Update(progress: Double(completed.count) / Double(encrypted.count))
+                    payload.subtitle = "\(completed.count)/\(encrypted.count)"
+                    banner?.update(payload: payload, for: tokenBanner)
+
+                    addNext()
                 }
             }
-            if let permissions = resultsSendFile.permissions.isNotEmpty {
-                metadata.permissions = permissions
+        } onCancel: {
+            transfers.cancel()
+        }
+
+        // Files not started because the batch was cancelled
+        for metadata in encrypted where !completed.contains(metadata.ocIdTransfer) {
+            await fail(metadata, error: NKError(errorCode: NCGlobal.shared.errorTaskCancelled, errorDescription: "Task cancelled"))
+            failed.append(metadata)
+        }
+
+        // Not cancelled with the batch: the metadata must be fixed and the folder unlocked in any case
+        let notUploaded = failed
+        await Task { @MainActor in
+            // REMOVE FAILED FILES FROM METADATA
+            //
+            if !notUploaded.isEmpty {
+                await rollback(notUploaded)
+                let error = await networkingE2EE.uploadMetadata(serverUrl: serverUrl,
+                                                                ocIdServerUrl: directory.ocId,
+                                                                fileId: fileId,
+                                                                e2eToken: e2eToken,
+                                                                method: "PUT",
+                                                                session: session)
+                if error != .success {
+                    nkLog(error: "E2EE batch upload: metadata still lists \(notUploaded.count) files that were not uploaded: \(error.errorDescription)")
+                }
             }
-            metadata.chunk = 0
-            metadata.session = ""
-            metadata.sessionTaskIdentifier = 0
-            metadata.sessionError = ""
-            metadata.status = NCGlobal.shared.metadataStatusNormal
-
-            // Remove if exists same file name view
-            if let metadataExists = await self.database.getMetadataAsync(predicate: NSPredicate(format: "account == %@ AND serverUrl == %@ AND fileNameView == %@ ", metadata.account, metadata.serverUrl, metadata.fileNameView)) {
-                await self.database.deleteMetadataAsync(ocId: metadataExists.ocId)
-                await self.database.deleteLocalFileAsync(id: metadataExists.ocId)
+
+            // UNLOCK
+            //
+            await networkingE2EE.unlock(account: account, serverUrl: serverUrl)
+        }.value
+
+        nkLog(tag: self.global.logTagE2EE, message: "E2EE batch upload of \(metadatas.count) files in \(serverUrl): \(metadatas.count - errors.count) uploaded, \(errors.count) failed")
+
+        return results()
+    }
+
+    // MARK: -
+
+    @MainActor
+    private func updateBanner(_ banner: LucidBanner?, tokenBanner: Int?) {
+        var payload = LucidBannerPayload.Update()
+        payload.title = NSLocalizedString("_wait_file_encryption_", comment: "")
+        payload.subtitle = NSLocalizedString("_e2ee_upload_tip_", comment: "")
+        payload.systemImage = "lock.circle.fill"
+
+        banner?.update(payload: payload, for: tokenBanner)
+        banner?.requestRelayout(animated: true)
+    }
+
+    /// Random file name identifier (or the one of the file being replaced) and upload status.
+    /// The upload is journaled from here until its file is sent, through the lock and the encryption.
+    private func prepare(metadata: tableMetadata) async -> tableMetadata? {
+        if let result = await self.database.getMetadataAsync(predicate: NSPredicate(format: "serverUrl == %@ AND fileNameView == %@ AND ocId != %@", metadata.serverUrl, metadata.fileNameView, metadata.ocId)) {
+            metadata.fileName = result.fileName
+        } else {
+            metadata.fileName = networkingE2EE.generateRandomIdentifier()
+        }
+        metadata.session = NCNetworking.shared.sessionUpload
+        metadata.status = global.metadataStatusUploading
+        metadata.sessionError = ""
+        metadata.serverUrlFileName = utilityFileSystem.createServerUrl(serverUrl: metadata.serverUrl, fileName: metadata.fileName)
+
+        let added = await self.database.addAndReturnMetadataAsync(metadata)
+#if !EXTENSION
+        if let added {
+            await NCTransferJournal.shared.start(ocId: added.ocId,
+                                                 account: added.account,
+                                                 session: added.session,
+                                                 serverUrlFileName: added.serverUrlFileName,
+                                                 taskIdentifier: 0)
+        }
+#endif
+        return added
+    }
+
+    @MainActor
+    private func encrypt(metadata: tableMetadata) async -> (encryption: Encryption?, error: NKError) {
+        var key: NSString?, initializationVector: NSString?, authenticationTag: NSString?
+
+        let directoryLocal = utilityFileSystem.getDirectoryProviderStorageOcId(metadata.ocId, userId: metadata.userId, urlBase: metadata.urlBase)
+        if metadata.chunk > 0 {
+            // Encrypt straight into the upload chunks: the ciphertext is never written as a whole file
+            let chunkSize = NCNetworking.shared.networkReachability == NKTypeReachability.reachableEthernetOrWiFi ? global.chunkSizeMBEthernetOrWiFi : global.chunkSizeMBCellular
+            guard let chunks = NCEndToEndEncryption.shared().encryptFile(metadata.fileNameView, fileNameIdentifier: metadata.fileName, directory: directoryLocal, chunkSize: Int64(chunkSize), key: &key, initializationVector: &initializationVector, authenticationTag: &authenticationTag) else {
+                return (nil, NKError(errorCode: NCGlobal.shared.errorE2EEEncryptFile,
+                                     errorDescription: NSLocalizedString("_e2ee_no_enc_file_", comment: "")))
             }
+            let filesChunk = chunks.enumerated().map { (fileName: "\($0.offset + 1)", size: $0.element.int64Value) }
+            await self.database.addChunksAsync(account: metadata.account,
+                                               ocId: metadata.ocId,
+                                               chunkFolder: self.database.getChunkFolder(account: metadata.account, ocId: metadata.ocId),
+                                               filesChunk: filesChunk,
+                                               totalSize: filesChunk.reduce(0) { $0 + $1.size })
+        } else if NCEndToEndEncryption.shared().encryptFile(metadata.fileNameView, fileNameIdentifier: metadata.fileName, directory: directoryLocal, key: &key, initializationVector: &initializationVector, authenticationTag: &authenticationTag) == false {
+            return (nil, NKError(errorCode: NCGlobal.shared.errorE2EEEncryptFile,
+                                 errorDescription: NSLocalizedString("_e2ee_no_enc_file_", comment: "")))
+        }
+        guard let key = key as? String, let initializationVector = initializationVector as? String, let authenticationTag = authenticationTag as? String else {
+            return (nil, NKError(errorCode: NCGlobal.shared.errorE2EEEncodedKey,
+                                 errorDescription: NSLocalizedString("_e2ee_no_enc_key_", comment: "")))
+        }
 
-            await self.database.addMetadataAsync(metadata)
-            await self.database.addLocalFilesAsync(metadatas: [metadata])
+        return (Encryption(key: key, initializationVector: initializationVector, authenticationTag: authenticationTag), .success)
+    }
 
-            utility.createImageFileFrom(metadata: metadata)
+    private func addE2eEncryption(metadata: tableMetadata, ocIdServerUrl: String, encryption: Encryption) async -> NKError {
+        await self.database.deleteE2eEncryptionAsync(predicate: NSPredicate(format: "account == %@ AND serverUrl == %@ AND fileName == %@", metadata.account, metadata.serverUrl, metadata.fileNameView))
+        let object = tableE2eEncryption.init(account: metadata.account, ocIdServerUrl: ocIdServerUrl, fileNameIdentifier: metadata.fileName)
+        if let results = await self.database.getE2eEncryptionAsync(predicate: NSPredicate(format: "account == %@ AND serverUrl == %@", metadata.account, metadata.serverUrl)) {
+            object.metadataKey = results.metadataKey
+            object.metadataKeyIndex = results.metadataKeyIndex
+        } else {
+            guard let key = NCEndToEndEncryption.shared().generateKey() as NSData? else {
+                return NKError(errorCode: NCGlobal.shared.errorE2EEGenerateKey,
+                               errorDescription: NSLocalizedString("_e2ee_no_generate_key_", comment: ""))
+            }
+            object.metadataKey = key.base64EncodedString()
+            object.metadataKeyIndex = 0
+        }
+        object.authenticationTag = encryption.authenticationTag
+        object.fileName = metadata.fileNameView
+        object.key = encryption.key
+        object.initializationVector = encryption.initializationVector
+        object.mimeType = metadata.contentType
+        object.serverUrl = metadata.serverUrl
+
+        await self.database.addE2eEncryptionAsync(object)
 
-            await NCNetworking.shared.transferDispatcher.notifyAllDelegates { delegate in
-                delegate.transferChange(networkingStatus: self.global.networkingStatusUploaded,
-                                        account: metadata.account,
-                                        fileName: metadata.fileName,
-                                        serverUrl: metadata.serverUrl,
-                                        selector: metadata.sessionSelector,
-                                        ocId: metadata.ocId,
-                                        destination: nil,
-                                        error: .success)
+        return .success
+    }
+
+    @MainActor
+    private func uploadSuccess(metadata: tableMetadata, ocId: String, resultsSendFile: (ocId: String?, etag: String?, date: Date?, ownerId: String?, permissions: String?, error: NKError)) async {
+        let metadata = metadata.detachedCopy()
+
+        await self.database.deleteMetadataAsync(id: metadata.ocId)
+        await utilityFileSystem.moveFileAsync(atPath: utilityFileSystem.getDirectoryProviderStorageOcId(metadata.ocId, userId: metadata.userId, urlBase: metadata.urlBase),
+                                              toPath: utilityFileSystem.getDirectoryProviderStorageOcId(ocId, userId: metadata.userId, urlBase: metadata.urlBase))
+
+        metadata.date = (resultsSendFile.date as? NSDate) ?? NSDate()
+        metadata.etag = resultsSendFile.etag ?? ""
+        metadata.ocId = ocId
+        if let fileId = self.utility.ocIdToFileId(ocId: ocId) {
+            metadata.fileId = fileId
+        }
+        if let ownerId = resultsSendFile.ownerId.isNotEmpty {
+            metadata.ownerId = ownerId
+            if let ownerDisplayName = await self.database.getOwnerDisplayName(account: metadata.account, ownerId: ownerId) {
+                metadata.ownerDisplayName = ownerDisplayName
             }
         }
+        if let permissions = resultsSendFile.permissions.isNotEmpty {
+            metadata.permissions = permissions
+        }
+        metadata.chunk = 0
+        metadata.session = ""
+        metadata.sessionTaskIdentifier = 0
+        metadata.sessionError = ""
+        metadata.status = NCGlobal.shared.metadataStatusNormal
 
-        finalError = resultsSendFile.error
-        return finalError
+        // Remove if exists same file name view
+        if let metadataExists = await self.database.getMetadataAsync(predicate: NSPredicate(format: "account == %@ AND serverUrl == %@ AND fileNameView == %@ ", metadata.account, metadata.serverUrl, metadata.fileNameView)) {
+            await self.database.deleteMetadataAsync(ocId: metadataExists.ocId)
+            await self.database.deleteLocalFileAsync(id: metadataExists.ocId)
+        }
+
+        await self.database.addMetadataAsync(metadata)
+        await self.database.addLocalFilesAsync(metadatas: [metadata])
+
+        utility.createImageFileFrom(metadata: metadata)
+
+        await NCNetworking.shared.transferDispatcher.notifyAllDelegates { delegate in
+            delegate.transferChange(networkingStatus: self.global.networkingStatusUploaded,
+                                    account: metadata.account,
+                                    fileName: metadata.fileName,
+                                    serverUrl: metadata.serverUrl,
+                                    selector: metadata.sessionSelector,
+                                    ocId: metadata.ocId,
+                                    destination: nil,
+                                    error: .success)
+        }
     }
 
     @MainActor
@@ -258,7 +629,8 @@ class NCNetworkingE2EEUpload: NSObject {
             banner?.update(payload: payload, for: tokenBanner)
 
             let task = Task { () -> (account: String, file: NKFile?, error: NKError) in
-                let results = await NCNetworking.shared.uploadChunkFile(metadata: metadata) { total, counter in
+                // The encryption wrote the chunks, there is no ciphertext file to split
+                let results = await NCNetworking.shared.uploadChunkFile(metadata: metadata, chunksOnly: true) { total, counter in
                     Task {@MainActor in
                         let progress = Double(counter) / Double(total)
                         banner?.update(payload: LucidBannerPayload.Update(progress: progress), for: tokenBanner)
@@ -332,6 +704,9 @@ class NCNetworkingE2EEUpload: NSObject {
                         for: tokenBanner)
                 }
             }
+#if !EXTENSION
+            await NCTransferJournal.shared.end(ocId: metadata.ocId)
+#endif
 
             return (results.ocId,
                     results.etag,
@@ -361,14 +361,15 @@ class NCAutoUpload: NSObject {
             .prefix(availableProcess)
         )
 
-        let cameraRoll = NCCameraRoll()
+        var metadatasToExtract: [tableMetadata] = []
 
         for metadata in metadatasToUpload {
             guard !Task.isCancelled else { return }
 
             // Check whether the file already exists remotely.
-            let existsResult = await NCNetworking.shared.fileExists(
-                serverUrlFileName: metadata.serverUrlFileName,
+            let existsResult = await NCRemoteExistenceResolver.shared.fileExists(
+                serverUrl: metadata.serverUrl,
+                fileName: metadata.fileName,
                 account: metadata.account
             )
 
@@ -379,12 +380,21 @@ class NCAutoUpload: NSObject {
                 continue
             }
 
-            // Expand the seed into concrete metadata entries (for example, Live Photo pairs).
-            let extractedMetadatas = await cameraRoll.extractCameraRoll(from: metadata)
+            metadatasToExtract.append(metadata)
+        }
+
+        // Expand the seeds into concrete metadata entries (for example, Live Photo pairs),
+        // extracting the next ones while the previous are queued.
+        let prefetcher = NCCameraRollPrefetcher(metadatas: metadatasToExtract)
+        defer {
+            prefetcher.cancel()
+            nkLog(tag: self.global.logTagBgSync, message: "Camera roll prefetch: \(prefetcher.report().description)")
+        }
 
+        while let item = await prefetcher.next() {
             guard !Task.isCancelled else { return }
 
-            for extractedMetadata in extractedMetadatas {
+            for extractedMetadata in item.extracted {
                 guard !Task.isCancelled else { return }
 
                 let err = await NCNetworking.shared.uploadFileInBackground(
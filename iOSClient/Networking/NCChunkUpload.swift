@@ -0,0 +1,376 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import NextcloudKit
+import Alamofire
+
+/// Chunked upload (WebDAV chunking v2) with several chunk PUTs of the same file in flight.
+///
+/// The file is split once into numbered chunk files next to it; the chunks still to send are the ones
+/// persisted in `tableChunk`, so after the app is killed the upload resumes from that set without
+/// splitting again. With `chunksOnly` the chunks were written ahead (E2EE encrypts straight into them)
+/// and there is no source file: they are sent as they are and never split. The number of parallel PUTs
+/// starts at two and grows by one while the aggregate throughput keeps improving, a failed chunk halves
+/// it and is retried.
+final class NCChunkUpload: @unchecked Sendable {
+    typealias Chunk = (fileName: String, size: Int64)
+
+    /// What to send once the chunk folder has been created (or found) on the server
+    enum Start: Equatable {
+        /// Split the source file into new chunks
+        case split
+        /// Send the persisted chunks as they are
+        case resume
+        /// The folder made by a previous attempt expired with the chunks sent to it: start over
+        case restart
+    }
+
+    /// `folderCreatedNow` is a successful MKCOL: the folder did not exist. That is an expiry only when a
+    /// previous attempt created it, chunks written ahead by the encryption have never been sent.
+    static func start(resuming: Bool, folderCreatedBefore: Bool, folderCreatedNow: Bool) -> Start {
+        guard resuming else {
+            return .split
+        }
+        return folderCreatedBefore && folderCreatedNow ? .restart : .resume
+    }
+
+    /// Parallel PUTs of one file, adapted to the aggregate throughput
+    struct Window {
+        let maximum: Int
+        private(set) var width: Int
+        private var bestThroughput: Double = 0
+        private var bytes: Int64 = 0
+        private var completions = 0
+        private var start: Date
+
+        init(maximum: Int, width: Int = 2, now: Date = Date()) {
+            self.maximum = max(1, maximum)
+            self.width = min(max(1, width), self.maximum)
+            self.start = now
+        }
+
+        /// A chunk has been sent; every `width` chunks the throughput of the window is compared with the best
+        mutating func success(bytes: Int64, now: Date = Date()) {
+            self.bytes += bytes
+            completions += 1
+            guard completions >= width else {
+                return
+            }
+
+            let throughput = Double(self.bytes) / max(0.001, now.timeIntervalSince(start))
+            if throughput > bestThroughput * 1.1 {
+                bestThroughput = throughput
+                width = min(maximum, width + 1)
+            } else if throughput < bestThroughput * 0.7 {
+                width = max(1, width - 1)
+            }
+            self.bytes = 0
+            completions = 0
+            start = now
+        }
+
+        mutating func failure(now: Date = Date()) {
+            width = max(1, width / 2)
+            bytes = 0
+            completions = 0
+            start = now
+        }
+    }
+
+    private let metadata: tableMetadata
+    private let directory: String
+    private let chunkFolder: String
+    private let chunkSize: Int
+    private let chunksOnly: Bool
+    private let customHeaders: [String: String]
+    private let queue: DispatchQueue
+    private let utilityFileSystem = NCUtilityFileSystem()
+    private let maximumAttempts = 3
+
+    private let lock = NSLock()
+    private var requests: [String: UploadRequest] = [:]
+    // Progress: bytes of the chunks sent and of the ones in flight
+    private var completedBytes: Int64 = 0
+    private var sentBytes: [String: Int64] = [:]
+
+    init(metadata: tableMetadata,
+         directory: String,
+         chunkFolder: String,
+         chunkSize: Int,
+         chunksOnly: Bool = false,
+         customHeaders: [String: String]?,
+         queue: DispatchQueue) {
+        self.metadata = metadata
+        self.directory = directory
+        self.chunkFolder = chunkFolder
+        self.chunkSize = chunkSize
+        self.chunksOnly = chunksOnly
+        self.customHeaders = customHeaders ?? [:]
+        self.queue = queue
+    }
+
+    // MARK: -
+
+    /// Same callbacks as `NextcloudKit.uploadChunkAsync`: the chunks left to send are passed to `uploadStart`
+    /// to be persisted, with the total length and the chunk folder now on the server, and every sent chunk
+    /// to `uploaded` to be removed. `state` is the one persisted with `filesChunk`.
+    func upload(filesChunk: [Chunk],
+                state: (totalSize: Int64, folderCreated: Bool)?,
+                chunkProgressHandler: @escaping (_ total: Int, _ counter: Int) -> Void,
+                uploadStart: @escaping (_ filesChunk: [Chunk], _ totalSize: Int64) async -> Void,
+                uploadTaskHandler: @escaping (_ task: URLSessionTask) -> Void,
+                uploadProgressHandler: @escaping (_ totalBytesExpected: Int64, _ totalBytes: Int64, _ fractionCompleted: Double) -> Void,
+                uploaded: @escaping (_ fileChunk: Chunk) -> Void,
+                assembling: @escaping () -> Void) async throws -> NKFile {
+        let account = metadata.account
+        let fileNameLocalPath = directory + "/" + metadata.fileName
+        let serverUrlChunkFolder = metadata.urlBase + "/remote.php/dav/uploads/" + metadata.userId + "/" + chunkFolder
+
+        // Resume from the persisted chunks when all their files are still there
+        let resuming = !filesChunk.isEmpty && filesChunk.allSatisfy { FileManager.default.fileExists(atPath: directory + "/" + $0.fileName) }
+        if chunksOnly, !resuming {
+            throw NKError(errorCode: NCGlobal.shared.errorReadFile, errorDescription: "Chunks of \(metadata.fileNameView) are missing")
+        }
+
+        let totalSize: Int64
+        if chunksOnly {
+            totalSize = max(state?.totalSize ?? 0, filesChunk.reduce(0) { $0 + $1.size })
+        } else {
+            totalSize = utilityFileSystem.getFileSize(filePath: fileNameLocalPath)
+        }
+        var headers = customHeaders
+        headers["Destination"] = metadata.serverUrlFileName.addingPercentEncoding(withAllowedCharacters: .urlQueryAllowed) ?? metadata.serverUrlFileName
+        headers["OC-Total-Length"] = String(totalSize)
+
+        let resultsCreateFolder = await NextcloudKit.shared.createFolderAsync(serverUrlFileName: serverUrlChunkFolder,
+                                                                              account: account,
+                                                                              options: NKRequestOptions(customHeader: headers, queue: queue)) { task in
+            Task {
+                let identifier = await NCNetworking.shared.networkingTasks.createIdentifier(account: account,
+                                                                                            path: serverUrlChunkFolder,
+                                                                                            name: "createFolder")
+                await NCNetworking.shared.networkingTasks.track(identifier: identifier, task: task)
+            }
+        }
+        if resultsCreateFolder.error != .success, resultsCreateFolder.error.errorCode != 405 {
+            throw resultsCreateFolder.error
+        }
+
+        let chunks: [Chunk]
+        switch Self.start(resuming: resuming,
+                          folderCreatedBefore: state?.folderCreated ?? false,
+                          folderCreatedNow: resultsCreateFolder.error == .success) {
+        case .split:
+            chunks = try split(fileNameLocalPath: fileNameLocalPath, progressHandler: chunkProgressHandler)
+        case .resume:
+            chunks = filesChunk
+        case .restart:
+            // The server no longer has the chunks sent before
+            guard !chunksOnly else {
+                throw NKError(errorCode: NCGlobal.shared.errorReadFile, errorDescription: "Chunk folder of \(metadata.fileNameView) expired on the server")
+            }
+            nkLog(debug: "Chunk folder of \(metadata.fileNameView) expired on the server, uploading all chunks")
+            chunks = try split(fileNameLocalPath: fileNameLocalPath, progressHandler: chunkProgressHandler)
+        }
+
+        await uploadStart(chunks, totalSize)
+
+        lock.lock()
+        completedBytes = totalSize - chunks.reduce(0) { $0 + $1.size }
+        lock.unlock()
+
+        try await withTaskCancellationHandler {
+            try await send(chunks: chunks,
+                           serverUrlChunkFolder: serverUrlChunkFolder,
+                           headers: headers,
+                           totalSize: totalSize,
+                           uploadTaskHandler: uploadTaskHandler,
+                           uploadProgressHandler: uploadProgressHandler,
+                           uploaded: uploaded)
+        } onCancel: {
+            cancelRequests()
+        }
+
+        // Assemble
+        assembling()
+        var assembleHeaders = headers
+        assembleHeaders.removeValue(forKey: "Destination")
+        assembleHeaders["X-OC-Mtime"] = String(Int(metadata.date.timeIntervalSince1970))
+        assembleHeaders["X-OC-CTime"] = String(Int(metadata.creationDate.timeIntervalSince1970))
+
+        let resultsMove = await NextcloudKit.shared.moveFileOrFolderAsync(serverUrlFileNameSource: serverUrlChunkFolder + "/.file",
+                                                                          serverUrlFileNameDestination: metadata.serverUrlFileName,
+                                                                          overwrite: true,
+                                                                          account: account,
+                                                                          options: NKRequestOptions(customHeader: assembleHeaders, timeout: 600, queue: queue)) { task in
+            Task {
+                let identifier = await NCNetworking.shared.networkingTasks.createIdentifier(account: account,
+                                                                                            path: serverUrlChunkFolder,
+                                                                                            name: "moveFileOrFolder")
+                await NCNetworking.shared.networkingTasks.track(identifier: identifier, task: task)
+            }
+        }
+        guard resultsMove.error == .success else {
+            throw resultsMove.error
+        }
+
+        let resultsRead = await NextcloudKit.shared.readFileOrFolderAsync(serverUrlFileName: metadata.serverUrlFileName,
+                                                                          depth: "0",
+                                                                          account: account,
+                                                                          options: NKRequestOptions(customHeader: customHeaders, queue: queue))
+        guard resultsRead.error == .success, let file = resultsRead.files?.first else {
+            throw resultsRead.error
+        }
+
+        return file
+    }
+
+    // MARK: -
+
+    private func send(chunks: [Chunk],
+                      serverUrlChunkFolder: String,
+                      headers: [String: String],
+                      totalSize: Int64,
+                      uploadTaskHandler: @escaping (_ task: URLSessionTask) -> Void,
+                      uploadProgressHandler: @escaping (_ totalBytesExpected: Int64, _ totalBytes: Int64, _ fractionCompleted: Double) -> Void,
+                      uploaded: @escaping (_ fileChunk: Chunk) -> Void) async throws {
+        var pending = chunks
+        var attempts: [String: Int] = [:]
+        var inFlight = 0
+        var window = Window(maximum: min(8, NCBrandOptions.shared.httpMaximumConnectionsPerHostInUpload))
+
+        try await withThrowingTaskGroup(of: (chunk: Chunk, error: NKError).self) { group in
+            while !pending.isEmpty || inFlight > 0 {
+                try Task.checkCancellation()
+
+                while inFlight < window.width, !pending.isEmpty {
+                    let chunk = pending.removeFirst()
+                    inFlight += 1
+                    group.addTask {
+                        let error = await self.put(chunk: chunk,
+                                                   serverUrlChunkFolder: serverUrlChunkFolder,
+                                                   headers: headers,
+                                                   uploadTaskHandler: uploadTaskHandler) { totalBytes in
+                            uploadProgressHandler(totalSize, totalBytes, totalSize > 0 ? Double(totalBytes) / Double(totalSize) : 0)
+                        }
+                        return (chunk, error)
+                    }
+                }
+
+                guard let result = try await group.next() else {
+                    break
+                }
+                inFlight -= 1
+
+                if result.error == .success {
+                    window.success(bytes: result.chunk.size)
+                    uploaded(result.chunk)
+                    continue
+                }
+
+                try Task.checkCancellation()
+                let attempt = attempts[result.chunk.fileName, default: 0] + 1
+                attempts[result.chunk.fileName] = attempt
+                guard attempt < maximumAttempts, isRetryable(result.error) else {
+                    group.cancelAll()
+                    cancelRequests()
+                    throw result.error
+                }
+                nkLog(debug: "Chunk \(result.chunk.fileName) of \(metadata.fileNameView) failed (\(result.error.errorCode)), retrying with \(max(1, window.width / 2)) in flight")
+                window.failure()
+                pending.insert(result.chunk, at: 0)
+            }
+        }
+    }
+
+    // Sends one chunk, `progress` receives the bytes of the file sent so far
+    private func put(chunk: Chunk,
+                     serverUrlChunkFolder: String,
+                     headers: [String: String],
+                     uploadTaskHandler: @escaping (_ task: URLSessionTask) -> Void,
+                     progress: @escaping (_ totalBytes: Int64) -> Void) async -> NKError {
+        let serverUrlFileName = serverUrlChunkFolder + "/" + chunk.fileName
+        let results = await NextcloudKit.shared.uploadAsync(serverUrlFileName: serverUrlFileName,
+                                                            fileNameLocalPath: directory + "/" + chunk.fileName,
+                                                            autoMkcol: false,
+                                                            account: metadata.account,
+                                                            options: NKRequestOptions(customHeader: headers, queue: queue)) { request in
+            self.lock.lock()
+            self.requests[chunk.fileName] = request
+            self.lock.unlock()
+        } taskHandler: { task in
+            Task {
+                let identifier = await NCNetworking.shared.networkingTasks.createIdentifier(account: self.metadata.account,
+                                                                                            path: serverUrlFileName,
+                                                                                            name: "upload")
+                await NCNetworking.shared.networkingTasks.track(identifier: identifier, task: task)
+            }
+            uploadTaskHandler(task)
+        } progressHandler: { value in
+            self.lock.lock()
+            self.sentBytes[chunk.fileName] = value.completedUnitCount
+            let totalBytes = self.completedBytes + self.sentBytes.values.reduce(0, +)
+            self.lock.unlock()
+            progress(totalBytes)
+        }
+
+        lock.lock()
+        requests.removeValue(forKey: chunk.fileName)
+        sentBytes.removeValue(forKey: chunk.fileName)
+        if results.error == .success {
+            completedBytes += chunk.size
+        }
+        lock.unlock()
+
+        return results.error
+    }
+
+    private func cancelRequests() {
+        lock.lock()
+        let requests = Array(self.requests.values)
+        lock.unlock()
+
+        requests.forEach { $0.cancel() }
+    }
+
+    // Splits the file into chunk files named 1, 2, 3... in the directory of the file
+    private func split(fileNameLocalPath: String, progressHandler: @escaping (_ total: Int, _ counter: Int) -> Void) throws -> [Chunk] {
+        let fileHandle = try FileHandle(forReadingFrom: URL(fileURLWithPath: fileNameLocalPath))
+        defer {
+            try? fileHandle.close()
+        }
+        let totalSize = utilityFileSystem.getFileSize(filePath: fileNameLocalPath)
+        let total = max(1, Int((totalSize + Int64(chunkSize) - 1) / Int64(chunkSize)))
+        var chunks: [Chunk] = []
+
+        for counter in 1...total {
+            try Task.checkCancellation()
+
+            let data = try autoreleasepool {
+                try fileHandle.read(upToCount: chunkSize) ?? Data()
+            }
+            if data.isEmpty, counter > 1 {
+                break
+            }
+            let fileName = String(counter)
+            try data.write(to: URL(fileURLWithPath: directory + "/" + fileName), options: .atomic)
+            chunks.append((fileName: fileName, size: Int64(data.count)))
+            progressHandler(total, counter)
+        }
+
+        return chunks
+    }
+
+    private func isRetryable(_ error: NKError) -> Bool {
+        switch error.errorCode {
+        case NSURLErrorTimedOut, NSURLErrorNetworkConnectionLost, NSURLErrorCannotConnectToHost:
+            return true
+        case 429, 500...599:
+            return true
+        default:
+            return false
+        }
+    }
+}
@@ -30,63 +30,122 @@ extension NCNetworking {
 
         await updateMetadataPlaceholder(metadata)
 
-        let results = await NextcloudKit.shared.downloadAsync(serverUrlFileName: metadata.serverUrlFileName,
-                                                              fileNameLocalPath: fileNameLocalPath,
-                                                              account: metadata.account,
-                                                              options: options) { request in
-            requestHandler(request)
-        } taskHandler: { task in
-            Task {
-                let identifier = await NCNetworking.shared.networkingTasks.createIdentifier(account: metadata.account,
-                                                                                            path: metadata.serverUrlFileName,
-                                                                                            name: "download")
-                await NCNetworking.shared.networkingTasks.track(identifier: identifier, task: task)
-
-                await NCManageDatabase.shared.setMetadataSessionAsync(
-                    ocId: metadata.ocId,
-                    session: self.sessionDownload,
-                    sessionTaskIdentifier: task.taskIdentifier,
-                    status: self.global.metadataStatusDownloading)
-
-                await self.transferDispatcher.notifyAllDelegates { delegate in
-                    delegate.transferChange(networkingStatus: self.global.networkingStatusDownloading,
-                                            account: metadata.account,
-                                            fileName: metadata.fileName,
-                                            serverUrl: metadata.serverUrl,
-                                            selector: metadata.sessionSelector,
-                                            ocId: metadata.ocId,
-                                            destination: nil,
-                                            error: .success)
-                }
-            }
-            taskHandler(task)
-        } progressHandler: { progress in
-            Task {
-                guard await self.progressQuantizer.shouldEmit(serverUrlFileName: metadata.serverUrlFileName, fraction: progress.fractionCompleted) else {
-                    return
-                }
-                await self.transferDispatcher.notifyAllDelegates { delegate in
-                    delegate.transferProgressDidUpdate(progress: Float(progress.fractionCompleted),
-                                                       totalBytes: progress.totalUnitCount,
-                                                       totalBytesExpected: progress.completedUnitCount,
-                                                       fileName: metadata.fileName,
-                                                       serverUrl: metadata.serverUrl)
+        var results: (etag: String?, error: NKError)?
+        if metadata.size >= NCSegmentedDownload.minimumSize {
+            results = await downloadFileSegmented(metadata: metadata,
+                                                  fileNameLocalPath: fileNameLocalPath,
+                                                  requestHandler: requestHandler,
+                                                  taskHandler: taskHandler,
+                                                  progressHandler: progressHandler)
+        }
+
+        if results == nil {
+            let resultsDownload = await NextcloudKit.shared.downloadAsync(serverUrlFileName: metadata.serverUrlFileName,
+                                                                          fileNameLocalPath: fileNameLocalPath,
+                                                                          account: metadata.account,
+                                                                          options: options) { request in
+                requestHandler(request)
+            } taskHandler: { task in
+                Task {
+                    let identifier = await NCNetworking.shared.networkingTasks.createIdentifier(account: metadata.account,
+                                                                                                path: metadata.serverUrlFileName,
+                                                                                                name: "download")
+                    await NCNetworking.shared.networkingTasks.track(identifier: identifier, task: task)
+                    await self.downloadStarted(metadata: metadata, task: task)
                 }
+                taskHandler(task)
+            } progressHandler: { progress in
+                self.progressBus.post(progress: Float(progress.fractionCompleted),
+                                      totalBytes: progress.totalUnitCount,
+                                      totalBytesExpected: progress.completedUnitCount,
+                                      fileName: metadata.fileName,
+                                      serverUrl: metadata.serverUrl)
+                progressHandler(progress)
             }
-            progressHandler(progress)
+
+            let allHeaderFields = resultsDownload.response?.response?.allHeaderFields
+            results = (nkComm.normalizedETag(nkComm.findHeader("oc-etag", allHeaderFields: allHeaderFields)), resultsDownload.nkError)
         }
 
-        await progressQuantizer.clear(serverUrlFileName: metadata.serverUrlFileName)
-        let allHeaderFields = results.response?.response?.allHeaderFields
-        let etag = nkComm.normalizedETag(nkComm.findHeader("oc-etag", allHeaderFields: allHeaderFields))
+        progressBus.clear(serverUrlFileName: metadata.serverUrlFileName)
+#if !EXTENSION
+        await NCTransferJournal.shared.end(ocId: metadata.ocId)
+#endif
+        let etag = results?.etag
+        let error = results?.error ?? NKError()
 
-        if results.nkError == .success {
+        if error == .success {
             await downloadSuccess(withMetadata: metadata, etag: etag)
         } else {
-            await downloadError(withMetadata: metadata, error: results.nkError)
+            await downloadError(withMetadata: metadata, error: error)
         }
 
-        return(metadata.account, etag, metadata.date as Date, metadata.size, results.nkError)
+        return(metadata.account, etag, metadata.date as Date, metadata.size, error)
+    }
+
+    /// Large file in byte ranges, resumed from the segments already received.
+    /// Returns nil when the file changed on the server since the metadata was read: it is then downloaded
+    /// again in one stream.
+    private func downloadFileSegmented(metadata: tableMetadata,
+                                       fileNameLocalPath: String,
+                                       requestHandler: @escaping (_ request: DownloadRequest) -> Void,
+                                       taskHandler: @escaping (_ task: URLSessionTask) -> Void,
+                                       progressHandler: @escaping (_ progress: Progress) -> Void) async -> (etag: String?, error: NKError)? {
+        let segmentedDownload = NCSegmentedDownload(metadata: metadata, fileNameLocalPath: fileNameLocalPath, queue: nkComm.backgroundQueue)
+
+        do {
+            let etag = try await segmentedDownload.download(requestHandler: requestHandler) { task in
+                Task {
+                    await self.downloadStarted(metadata: metadata, task: task)
+                }
+            } taskHandler: { task in
+                taskHandler(task)
+            } progressHandler: { progress in
+                self.progressBus.post(progress: Float(progress.fractionCompleted),
+                                      totalBytes: progress.totalUnitCount,
+                                      totalBytesExpected: progress.completedUnitCount,
+                                      fileName: metadata.fileName,
+                                      serverUrl: metadata.serverUrl)
+                progressHandler(progress)
+            }
+            return (etag, .success)
+        } catch let error as NKError {
+            if error.errorCode == NCSegmentedDownload.etagChanged.errorCode {
+                nkLog(debug: "File changed on the server during the segmented download of \(metadata.fileNameView), downloading it again")
+                return nil
+            }
+            return (nil, error)
+        } catch is CancellationError {
+            return (nil, NKError(errorCode: NSURLErrorCancelled, errorDescription: "Download was cancelled."))
+        } catch {
+            return (nil, NKError(error: error))
+        }
+    }
+
+    private func downloadStarted(metadata: tableMetadata, task: URLSessionTask) async {
+        await NCManageDatabase.shared.setMetadataSessionAsync(
+            ocId: metadata.ocId,
+            session: self.sessionDownload,
+            sessionTaskIdentifier: task.taskIdentifier,
+            status: self.global.metadataStatusDownloading)
+#if !EXTENSION
+        await NCTransferJournal.shared.start(ocId: metadata.ocId,
+                                             account: metadata.account,
+                                             session: self.sessionDownload,
+                                             serverUrlFileName: metadata.serverUrlFileName,
+                                             taskIdentifier: task.taskIdentifier)
+#endif
+
+        await self.transferDispatcher.notifyAllDelegates { delegate in
+            delegate.transferChange(networkingStatus: self.global.networkingStatusDownloading,
+                                    account: metadata.account,
+                                    fileName: metadata.fileName,
+                                    serverUrl: metadata.serverUrl,
+                                    selector: metadata.sessionSelector,
+                                    ocId: metadata.ocId,
+                                    destination: nil,
+                                    error: .success)
+        }
     }
 
     // MARK: - Download file in background
@@ -113,6 +172,13 @@ extension NCNetworking {
                                                                   session: self.sessionDownloadBackground,
                                                                   sessionTaskIdentifier: task.taskIdentifier,
                                                                   status: self.global.metadataStatusDownloading)
+#if !EXTENSION
+            await NCTransferJournal.shared.start(ocId: metadata.ocId,
+                                                 account: metadata.account,
+                                                 session: self.sessionDownloadBackground,
+                                                 serverUrlFileName: metadata.serverUrlFileName,
+                                                 taskIdentifier: task.taskIdentifier)
+#endif
 
             await self.transferDispatcher.notifyAllDelegates { delegate in
                 delegate.transferChange(networkingStatus: self.global.networkingStatusDownloading,
@@ -227,15 +293,41 @@ extension NCNetworking {
 
     // MARK: - Synchronization Download
 
+    /// State of one offline synchronization, shared by the folders of the tree
+    private final class SynchronizationDownload {
+        let account: String
+        let showHiddenFiles: Bool
+        let ocIdsInDownload: Set<String>
+        var listed = 0
+        var skipped = 0
+        var queued = 0
+
+        init(account: String, showHiddenFiles: Bool, ocIdsInDownload: Set<String>) {
+            self.account = account
+            self.showHiddenFiles = showHiddenFiles
+            self.ocIdsInDownload = ocIdsInDownload
+        }
+    }
+
+    /// Delta synchronization of an offline folder.
+    ///
+    /// Folders are compared top-down by etag: a folder whose etag is the one recorded when its subtree was
+    /// last found fully downloaded is skipped with its whole subtree. Changed folders are listed with depth 1,
+    /// their files resolved against the local file etags and their subfolders against the recorded etags,
+    /// one query each per folder, so the cost follows what changed rather than the size of the tree.
+    /// A file is trusted when its local file etag matches, without reading the file system: a local copy
+    /// removed outside the app is downloaded again when its folder changes on the server or when the folder
+    /// is set offline again, which resets the recorded etags.
     internal func synchronizationDownload(account: String,
                                           serverUrl: String,
                                           userId: String,
                                           urlBase: String,
                                           metadatasInDownload: [tableMetadata]?) async {
+        let showHiddenFiles = NCPreferences().getShowHiddenFiles(account: account)
         let results = await NextcloudKit.shared.readFileOrFolderAsync(
             serverUrlFileName: serverUrl,
-            depth: "infinity",
-            showHiddenFiles: NCPreferences().getShowHiddenFiles(account: account),
+            depth: "0",
+            showHiddenFiles: showHiddenFiles,
             account: account
         ) { task in
             Task {
@@ -247,38 +339,82 @@ extension NCNetworking {
             }
         }
 
-        guard results.error == .success, let files = results.files else {
+        guard results.error == .success, let folder = results.files?.first else {
             nkLog(tag: self.global.logTagSync,
                   emoji: .error,
-                  message: "Read infinite folder: \(serverUrl), error: \(results.error.errorCode)")
+                  message: "Read offline folder: \(serverUrl), error: \(results.error.errorCode)")
             return
         }
 
+        let offlineEtags = await NCManageDatabase.shared.getDirectoryOfflineEtagsAsync(account: account, serverUrls: [serverUrl])
+        let synchronization = SynchronizationDownload(account: account,
+                                                      showHiddenFiles: showHiddenFiles,
+                                                      ocIdsInDownload: Set(metadatasInDownload?.map(\.ocId) ?? []))
+
+        let synchronized = await synchronizationDownload(serverUrl: serverUrl,
+                                                         etag: folder.etag,
+                                                         offlineEtag: offlineEtags[serverUrl],
+                                                         synchronization: synchronization)
+
         nkLog(tag: self.global.logTagSync,
-              emoji: .success,
-              message: "Read infinite folder: \(serverUrl)")
+              emoji: .start,
+              message: "Queued \(synchronization.queued) files for offline synchronization: \(serverUrl), folders listed \(synchronization.listed), unchanged subtrees skipped \(synchronization.skipped)\(synchronized ? ", in sync" : "")")
+    }
+
+    /// Synchronizes one folder and the changed folders below it.
+    /// Returns true when the whole subtree is downloaded, its etag is then recorded.
+    private func synchronizationDownload(serverUrl: String, etag: String, offlineEtag: String?, synchronization: SynchronizationDownload) async -> Bool {
+        if offlineEtag == etag {
+            synchronization.skipped += 1
+            return true
+        }
 
-        let ocIdsInDownload = Set(metadatasInDownload?.map(\.ocId) ?? [])
+        let account = synchronization.account
+        let results = await NextcloudKit.shared.readFileOrFolderAsync(
+            serverUrlFileName: serverUrl,
+            depth: "1",
+            showHiddenFiles: synchronization.showHiddenFiles,
+            account: account
+        ) { task in
+            Task {
+                let identifier = await self.networkingTasks.createIdentifier(
+                    account: account,
+                    path: serverUrl,
+                    name: "synchronizationDownload"
+                )
+                await self.networkingTasks.track(identifier: identifier, task: task)
+            }
+        }
+
+        guard results.error == .success, let files = results.files else {
+            nkLog(tag: self.global.logTagSync,
+                  emoji: .error,
+                  message: "Read offline folder: \(serverUrl), error: \(results.error.errorCode)")
+            return false
+        }
+        synchronization.listed += 1
+
+        // The first entry is the folder itself, created with its subfolders
+        let children = files.dropFirst()
+        let directories = children.filter { $0.directory }
+        let plainFiles = children.filter { !$0.directory }
+        let serverUrlDirectories = directories.map { utilityFileSystem.createServerUrl(serverUrl: $0.serverUrl, fileName: $0.fileName) }
+        let localEtags = await NCManageDatabase.shared.getLocalFileEtagsAsync(ocIds: plainFiles.map { $0.ocId })
+        let offlineEtags = await NCManageDatabase.shared.getDirectoryOfflineEtagsAsync(account: account, serverUrls: serverUrlDirectories)
         var directoriesToCreate: [tableMetadata] = []
         var metadatasToDownload: [tableMetadata] = []
+        var isComplete = true
 
-        for file in files {
-            let metadata = await NCManageDatabaseCreateMetadata().convertFileToMetadataAsync(file)
-
-            if file.directory {
-                directoriesToCreate.append(metadata)
+        for file in plainFiles {
+            if synchronization.ocIdsInDownload.contains(file.ocId) {
+                isComplete = false
                 continue
             }
-
-            guard await isFileDifferent(ocId: file.ocId,
-                                        fileName: file.fileName,
-                                        etag: file.etag,
-                                        ocIdsInDownload: ocIdsInDownload,
-                                        userId: userId,
-                                        urlBase: urlBase) else {
+            if localEtags[file.ocId] == file.etag {
                 continue
             }
 
+            let metadata = await NCManageDatabaseCreateMetadata().convertFileToMetadataAsync(file)
             metadata.session = self.sessionDownloadBackground
             metadata.sessionSelector = NCGlobal.shared.selectorSynchronizationOffline
             metadata.sessionTaskIdentifier = 0
@@ -289,13 +425,29 @@ extension NCNetworking {
             metadatasToDownload.append(metadata)
         }
 
+        for file in files.prefix(1) + directories {
+            directoriesToCreate.append(await NCManageDatabaseCreateMetadata().convertFileToMetadataAsync(file))
+        }
+
         await NCManageDatabase.shared.createDirectoriesAsync(metadatas: directoriesToCreate)
         await NCManageDatabase.shared.addMetadatasAsync(metadatasToDownload)
+        synchronization.queued += metadatasToDownload.count
+        isComplete = isComplete && metadatasToDownload.isEmpty
+
+        for (directory, serverUrlDirectory) in zip(directories, serverUrlDirectories) {
+            let synchronized = await synchronizationDownload(serverUrl: serverUrlDirectory,
+                                                             etag: directory.etag,
+                                                             offlineEtag: offlineEtags[serverUrlDirectory],
+                                                             synchronization: synchronization)
+            isComplete = isComplete && synchronized
+        }
 
-        nkLog(tag: self.global.logTagSync,
-              emoji: .start,
-              message: "Queued \(metadatasToDownload.count) files for offline synchronization: \(serverUrl)")
+        // Downloads just queued are verified by the next synchronization, then the etag is recorded
+        if isComplete {
+            await NCManageDatabase.shared.setDirectoryOfflineEtagAsync(account: account, serverUrl: serverUrl, etag: etag)
+        }
 
+        return isComplete
     }
 
     internal func isFileDifferent(ocId: String,
@@ -39,7 +39,7 @@ extension NCNetworking {
 
     func downloadComplete(fileName: String, serverUrl: String, allHeaderFields: [AnyHashable: Any]?, task: URLSessionTask, error: NKError) {
         Task {
-            await progressQuantizer.clear(serverUrlFileName: serverUrl + "/" + fileName)
+            progressBus.clear(serverUrlFileName: serverUrl + "/" + fileName)
 
             let etag = nkComm.normalizedETag(nkComm.findHeader("oc-etag", allHeaderFields: allHeaderFields))
 
@@ -53,6 +53,10 @@ extension NCNetworking {
             guard let metadata = await NCManageDatabase.shared.getMetadataAsync(predicate: NSPredicate(format: "serverUrl == %@ AND fileName == %@", serverUrl, fileName)) else {
                 return
             }
+#if !EXTENSION
+            NCTransferConcurrency.shared.finish(serverUrlFileName: metadata.serverUrlFileName, bytes: metadata.size, error: error)
+            await NCTransferJournal.shared.end(ocId: metadata.ocId)
+#endif
             if error == .success {
                 if isInBackground() {
                     await downloadSuccess(withMetadata: metadata, etag: etag)
@@ -100,26 +104,18 @@ extension NCNetworking {
                           serverUrl: String,
                           session: URLSession,
                           task: URLSessionTask) {
-        Task {
-            guard await progressQuantizer.shouldEmit(serverUrlFileName: serverUrl + "/" + fileName, fraction: Double(progress)) else {
-                return
-            }
-
-            await self.transferDispatcher.notifyAllDelegates { delegate in
-                delegate.transferProgressDidUpdate(progress: progress,
-                                                   totalBytes: totalBytes,
-                                                   totalBytesExpected: totalBytesExpected,
-                                                   fileName: fileName,
-                                                   serverUrl: serverUrl)
-            }
-        }
+        progressBus.post(progress: progress,
+                         totalBytes: totalBytes,
+                         totalBytesExpected: totalBytesExpected,
+                         fileName: fileName,
+                         serverUrl: serverUrl)
     }
 
     // MARK: - Upload NextcloudKitDelegate
 
     func uploadComplete(fileName: String, serverUrl: String, allHeaderFields: [AnyHashable: Any]?, task: URLSessionTask, error: NKError) {
         Task {
-            await progressQuantizer.clear(serverUrlFileName: serverUrl + "/" + fileName)
+            progressBus.clear(serverUrlFileName: serverUrl + "/" + fileName)
 
             let ocId = nkComm.findHeader("oc-fileid", allHeaderFields: allHeaderFields)
             let etag = nkComm.normalizedETag(nkComm.findHeader("oc-etag", allHeaderFields: allHeaderFields))
@@ -143,6 +139,10 @@ extension NCNetworking {
                 await NCManageDatabase.shared.deleteMetadataAsync(predicate: NSPredicate(format: "fileName == %@ AND serverUrl == %@", fileName, serverUrl))
                 return
             }
+#if !EXTENSION
+            NCTransferConcurrency.shared.finish(serverUrlFileName: metadata.serverUrlFileName, bytes: metadata.size, error: error)
+            await NCTransferJournal.shared.end(ocId: metadata.ocId)
+#endif
 
             if error == .success {
                 if let ocId {
@@ -168,6 +168,12 @@ extension NCNetworking {
                     await NCManageDatabase.shared.deleteMetadataAsync(predicate: NSPredicate(format: "fileName == %@ AND serverUrl == %@", fileName, serverUrl))
                 }
             } else {
+#if !EXTENSION
+                // Conflict: the server folder changed, the listing used by auto upload is stale
+                if [409, 412, 423].contains(error.errorCode) {
+                    await NCRemoteExistenceResolver.shared.invalidate(serverUrl: metadata.serverUrl, account: metadata.account)
+                }
+#endif
                 await uploadError(withMetadata: metadata, error: error)
             }
 #endif
@@ -181,18 +187,10 @@ extension NCNetworking {
                         serverUrl: String,
                         session: URLSession,
                         task: URLSessionTask) {
-        Task {
-            guard await progressQuantizer.shouldEmit(serverUrlFileName: serverUrl + "/" + fileName, fraction: Double(progress)) else {
-                return
-            }
-
-            await self.transferDispatcher.notifyAllDelegates { delegate in
-                delegate.transferProgressDidUpdate(progress: progress,
-                                                   totalBytes: totalBytes,
-                                                   totalBytesExpected: totalBytesExpected,
-                                                   fileName: fileName,
-                                                   serverUrl: serverUrl)
-            }
-        }
+        progressBus.post(progress: progress,
+                         totalBytes: totalBytes,
+                         totalBytesExpected: totalBytesExpected,
+                         fileName: fileName,
+                         serverUrl: serverUrl)
     }
 }
@@ -259,163 +259,157 @@ extension NCNetworking {
         return taskArray
     }
 
-    // MARK: -
-
-    func verifyZombie() async {
-        func removeMetadataAndLocalFile(_ metadata: tableMetadata) async {
-            await NCManageDatabase.shared.deleteMetadataAsync(id: metadata.ocId)
-            utilityFileSystem.removeFile(atPath: utilityFileSystem.getDirectoryProviderStorageOcId(metadata.ocId,
-                                                                                                   userId: metadata.userId,
-                                                                                                   urlBase: metadata.urlBase))
-        }
-
-        func restoreUploadIfPossible(_ metadata: tableMetadata) async {
-            guard NCUtilityFileSystem().fileProviderStorageExists(metadata) else {
-                await NCManageDatabase.shared.deleteMetadataAsync(id: metadata.ocId)
-                return
+    // MARK: - Recovery
+
+    /// Releases the transfers whose task is gone, from the transfer journal.
+    ///
+    /// Only the journal entries that may be dead are looked at: a foreground task of a previous launch is
+    /// released without asking URLSession, a background task is looked up in the task list of its own
+    /// session. Once per `unjournaledInterval` the in-progress metadatas missing from the journal are
+    /// looked up too, foreground ones included, against the task list of their session.
+    /// - Returns: The number of transfers released.
+    @discardableResult
+    func recoverTransfers() async -> Int {
+        let date = Date()
+        let journal = NCTransferJournal.shared
+        let foregroundSessions: Set<String> = [sessionDownload, sessionUpload]
+        var entries = await journal.entriesToVerify(foregroundSessions: foregroundSessions)
+
+        if await journal.claimUnjournaledCheck(),
+           let metadatas = await NCManageDatabase.shared.getMetadatasAsync(
+            predicate: NSPredicate(format: "status IN %@ OR (session == %@ AND status IN %@)",
+                                   global.metadatasStatusDownloadingUploading,
+                                   sessionDownload,
+                                   global.metadataStatusDownloadingAllMode)) {
+            for metadata in metadatas where await !journal.isActive(ocId: metadata.ocId) {
+                entries.append(NCTransferJournal.Entry(ocId: metadata.ocId,
+                                                       account: metadata.account,
+                                                       session: metadata.session,
+                                                       serverUrlFileName: metadata.serverUrlFileName,
+                                                       taskIdentifier: metadata.sessionTaskIdentifier,
+                                                       launch: journal.launch,
+                                                       lastActivity: metadata.sessionDate ?? Date(),
+                                                       bytes: 0))
             }
-
-            await NCManageDatabase.shared.setMetadataSessionAsync(ocId: metadata.ocId,
-                                                                  sessionError: "",
-                                                                  status: self.global.metadataStatusWaitUpload)
         }
 
-        func restoreDownload(_ metadata: tableMetadata) async {
-            await NCManageDatabase.shared.setMetadataSessionAsync(ocId: metadata.ocId,
-                                                                  session: "",
-                                                                  sessionError: "",
-                                                                  selector: "",
-                                                                  status: self.global.metadataStatusNormal)
+        guard !entries.isEmpty else {
+            return 0
         }
 
-        // UPLOADING-FOREGROUND
-        //
-        if let metadatas = await NCManageDatabase.shared.getMetadatasAsync(
-            predicate: NSPredicate(format: "session == %@ AND status == %d",
-                                   sessionUpload,
-                                   global.metadataStatusUploading)) {
-            let metadatasByAccount = Dictionary(grouping: metadatas, by: \.account)
-
-            for (account, accountMetadatas) in metadatasByAccount {
-                guard let nkSession = nkComm.nksessions.session(forAccount: account) else {
-                    for metadata in accountMetadatas {
-                        await removeMetadataAndLocalFile(metadata)
-                    }
-                    continue
-                }
-
-                let tasks = await nkSession.sessionData.session.tasks
-                let taskIdentifiers = Set(tasks.1.map(\.taskIdentifier))
+        var taskIdentifiers: [String: Set<Int>] = [:]
+        var released = 0
 
-                for metadata in accountMetadatas {
-                    guard await !metadataUploadTranfersSuccess.exists(serverUrlFileName: metadata.serverUrlFileName) else {
-                        continue
-                    }
+        for entry in entries {
+            var isAlive = false
+            let nkSession = nkComm.nksessions.session(forAccount: entry.account)
 
-                    guard taskIdentifiers.contains(metadata.sessionTaskIdentifier) else {
-                        await restoreUploadIfPossible(metadata)
-                        continue
-                    }
+            if let nkSession, entry.launch == journal.launch || !foregroundSessions.contains(entry.session) {
+                let key = entry.account + "|" + entry.session
+                if taskIdentifiers[key] == nil {
+                    taskIdentifiers[key] = await getTaskIdentifiers(nkSession: nkSession, session: entry.session)
                 }
+                isAlive = taskIdentifiers[key]?.contains(entry.taskIdentifier) ?? false
             }
-        }
-
-        // UPLOADING-BACKGROUND
-        //
-        if let metadatas = await NCManageDatabase.shared.getMetadatasAsync(
-            predicate: NSPredicate(format: "session IN %@ AND status == %d",
-                                   [sessionUploadBackground,
-                                    sessionUploadBackgroundWWan],
-                                   global.metadataStatusUploading)) {
-            let metadatasByAccount = Dictionary(grouping: metadatas, by: \.account)
-
-            for (account, accountMetadatas) in metadatasByAccount {
-                guard let nkSession = nkComm.nksessions.session(forAccount: account) else {
-                    for metadata in accountMetadatas {
-                        await removeMetadataAndLocalFile(metadata)
-                    }
-                    continue
-                }
-
-                let backgroundTaskIdentifiers = Set((await nkSession.sessionUploadBackground.allTasks).map(\.taskIdentifier))
-                let backgroundWWanTaskIdentifiers = Set((await nkSession.sessionUploadBackgroundWWan.allTasks).map(\.taskIdentifier))
-
-                for metadata in accountMetadatas {
-                    guard await !metadataUploadTranfersSuccess.exists(serverUrlFileName: metadata.serverUrlFileName) else {
-                        continue
-                    }
 
-                    let taskIdentifiers: Set<Int>
-                    switch metadata.session {
-                    case sessionUploadBackground:
-                        taskIdentifiers = backgroundTaskIdentifiers
-                    case sessionUploadBackgroundWWan:
-                        taskIdentifiers = backgroundWWanTaskIdentifiers
-                    default:
-                        taskIdentifiers = []
-                    }
-
-                    guard taskIdentifiers.contains(metadata.sessionTaskIdentifier) else {
-                        await restoreUploadIfPossible(metadata)
-                        continue
-                    }
-                }
+            if isAlive {
+                await journal.verified(ocId: entry.ocId)
+                continue
             }
-        }
 
-        // DOWNLOADING-FOREGROUND
-        //
-        if let metadatas = await NCManageDatabase.shared.getMetadatasAsync(
-            predicate: NSPredicate(format: "session == %@ AND status IN %@",
-                                   sessionDownload,
-                                   global.metadataStatusDownloadingAllMode)) {
-            let metadatasByAccount = Dictionary(grouping: metadatas, by: \.account)
+            await journal.end(ocId: entry.ocId)
+            guard let metadata = await NCManageDatabase.shared.getMetadataFromOcIdAsync(entry.ocId) else {
+                continue
+            }
 
-            for (account, accountMetadatas) in metadatasByAccount {
-                guard let nkSession = nkComm.nksessions.session(forAccount: account) else {
-                    for metadata in accountMetadatas {
-                        await removeMetadataAndLocalFile(metadata)
-                    }
+            if metadata.status == global.metadataStatusUploading {
+                guard await !metadataUploadTranfersSuccess.exists(serverUrlFileName: metadata.serverUrlFileName) else {
                     continue
                 }
-
-                let tasks = await nkSession.sessionData.session.tasks
-                let taskIdentifiers = Set(tasks.2.map(\.taskIdentifier))
-
-                for metadata in accountMetadatas where !taskIdentifiers.contains(metadata.sessionTaskIdentifier) {
-                    guard await !metadataDownloadTranfersSuccess.exists(serverUrlFileName: metadata.serverUrlFileName) else {
-                        continue
-                    }
+                if nkSession == nil {
+                    await removeMetadataAndLocalFile(metadata)
+                } else {
+                    await restoreUploadIfPossible(metadata)
+                }
+            } else if global.metadataStatusDownloadingAllMode.contains(metadata.status) {
+                guard await !metadataDownloadTranfersSuccess.exists(serverUrlFileName: metadata.serverUrlFileName) else {
+                    continue
+                }
+                if nkSession == nil {
+                    await removeMetadataAndLocalFile(metadata)
+                } else {
                     await restoreDownload(metadata)
                 }
+            } else {
+                continue
             }
+
+            NCTransferConcurrency.shared.discard(serverUrlFileName: metadata.serverUrlFileName)
+            released += 1
         }
 
-        // DOWNLOADING-BACKGROUND
-        //
-        if let metadatas = await NCManageDatabase.shared.getMetadatasAsync(
-            predicate: NSPredicate(format: "session == %@ AND status == %d",
-                                   sessionDownloadBackground,
-                                   global.metadataStatusDownloading)) {
-            let metadatasByAccount = Dictionary(grouping: metadatas, by: \.account)
-
-            for (account, accountMetadatas) in metadatasByAccount {
-                guard let nkSession = nkComm.nksessions.session(forAccount: account) else {
-                    for metadata in accountMetadatas {
-                        await removeMetadataAndLocalFile(metadata)
-                    }
-                    continue
-                }
+        let duration = Date().timeIntervalSince(date)
+        await journal.recovered(released: released, duration: duration)
+        nkLog(debug: "Transfer recovery: \(entries.count) verified, \(released) released in \(String(format: "%.3f", duration)) s")
 
-                let taskIdentifiers = Set((await nkSession.sessionDownloadBackground.allTasks).map(\.taskIdentifier))
+        return released
+    }
 
-                for metadata in accountMetadatas where !taskIdentifiers.contains(metadata.sessionTaskIdentifier) {
-                    guard await !metadataDownloadTranfersSuccess.exists(serverUrlFileName: metadata.serverUrlFileName) else {
-                        continue
-                    }
-                    await restoreDownload(metadata)
-                }
+    private func getTaskIdentifiers(nkSession: NKSession, session: String) async -> Set<Int> {
+        switch session {
+        case sessionUpload:
+            return Set((await nkSession.sessionData.session.tasks).1.map(\.taskIdentifier))
+        case sessionDownload:
+            return Set((await nkSession.sessionData.session.tasks).2.map(\.taskIdentifier))
+        case sessionUploadBackground:
+            return Set((await nkSession.sessionUploadBackground.allTasks).map(\.taskIdentifier))
+        case sessionUploadBackgroundWWan:
+            return Set((await nkSession.sessionUploadBackgroundWWan.allTasks).map(\.taskIdentifier))
+        case sessionDownloadBackground:
+            return Set((await nkSession.sessionDownloadBackground.allTasks).map(\.taskIdentifier))
+        default:
+            return []
+        }
+    }
+
+    private func removeMetadataAndLocalFile(_ metadata: tableMetadata) async {
+        await NCManageDatabase.shared.deleteMetadataAsync(id: metadata.ocId)
+        utilityFileSystem.removeFile(atPath: utilityFileSystem.getDirectoryProviderStorageOcId(metadata.ocId,
+                                                                                           userId: metadata.userId,
+                                                                                           urlBase: metadata.urlBase))
+    }
+
+    private func restoreUploadIfPossible(_ metadata: tableMetadata) async {
+        guard NCUtilityFileSystem().fileProviderStorageExists(metadata) else {
+            await NCManageDatabase.shared.deleteMetadataAsync(id: metadata.ocId)
+            return
+        }
+
+        await NCManageDatabase.shared.setMetadataSessionAsync(ocId: metadata.ocId,
+                                                              sessionError: "",
+                                                              status: self.global.metadataStatusWaitUpload)
+    }
+
+    private func restoreDownload(_ metadata: tableMetadata) async {
+        // A segmented download killed with the app resumes from the segments already received
+        if metadata.size >= NCSegmentedDownload.minimumSize {
+            let fileNameLocalPath = utilityFileSystem.getDirectoryProviderStorageOcId(metadata.ocId, fileName: metadata.fileName, userId: metadata.userId, urlBase: metadata.urlBase)
+            let segmentedDownload = NCSegmentedDownload(metadata: metadata, fileNameLocalPath: fileNameLocalPath, queue: nkComm.backgroundQueue)
+
+            if segmentedDownload.isResumable {
+                await NCManageDatabase.shared.setMetadataSessionInWaitDownloadAsync(ocId: metadata.ocId,
+                                                                                    session: sessionDownloadBackground,
+                                                                                    selector: metadata.sessionSelector,
+                                                                                    sceneIdentifier: metadata.sceneIdentifier)
+                return
             }
+            segmentedDownload.discard()
         }
+
+        await NCManageDatabase.shared.setMetadataSessionAsync(ocId: metadata.ocId,
+                                                              session: "",
+                                                              sessionError: "",
+                                                              selector: "",
+                                                              status: self.global.metadataStatusNormal)
     }
 }
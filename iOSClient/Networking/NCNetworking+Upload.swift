@@ -70,6 +70,7 @@ extension NCNetworking {
     @discardableResult
     func uploadChunkFile(metadata: tableMetadata,
                          performPostProcessing: Bool = true,
+                         chunksOnly: Bool = false,
                          customHeaders: [String: String]? = nil,
                          chunkProgressHandler: @escaping (_ total: Int, _ counter: Int) -> Void = { _, _ in },
                          uploadStart: @escaping (_ filesChunk: [(fileName: String, size: Int64)]) -> Void = { _ in },
@@ -82,33 +83,34 @@ extension NCNetworking {
                                                                           urlBase: metadata.urlBase)
         let chunkFolder = NCManageDatabase.shared.getChunkFolder(account: metadata.account, ocId: metadata.ocId)
         let filesChunk = NCManageDatabase.shared.getChunks(account: metadata.account, ocId: metadata.ocId)
+        let chunkState = NCManageDatabase.shared.getChunkUploadState(account: metadata.account, ocId: metadata.ocId)
         var chunkSize = self.global.chunkSizeMBCellular
         if networkReachability == NKTypeReachability.reachableEthernetOrWiFi {
             chunkSize = self.global.chunkSizeMBEthernetOrWiFi
         }
-        let options = NKRequestOptions(customHeader: customHeaders, queue: nkComm.backgroundQueue)
         var backupError = NKError()
         var backupFile: NKFile?
 
         do {
-            let (_, file) = try await NextcloudKit.shared.uploadChunkAsync(
-                directory: directory,
-                fileName: metadata.fileName,
-                date: metadata.date as Date,
-                creationDate: metadata.creationDate as Date,
-                serverUrl: metadata.serverUrl,
-                chunkFolder: chunkFolder,
-                filesChunk: filesChunk,
-                chunkSize: chunkSize,
-                account: metadata.account,
-                options: options) { total, counter in
+            // Several chunks in flight, resumed from the persisted chunks
+            let chunkUpload = NCChunkUpload(metadata: metadata,
+                                            directory: directory,
+                                            chunkFolder: chunkFolder,
+                                            chunkSize: chunkSize,
+                                            chunksOnly: chunksOnly,
+                                            customHeaders: customHeaders,
+                                            queue: nkComm.backgroundQueue)
+            let file = try await chunkUpload.upload(filesChunk: filesChunk, state: chunkState) { total, counter in
                     chunkProgressHandler(total, counter)
-                } uploadStart: { filesChunk in
+                } uploadStart: { filesChunk, totalSize in
+                    // Persisted before any chunk is sent: the folder now exists on the server
+                    await NCManageDatabase.shared.addChunksAsync(account: metadata.account,
+                                                                 ocId: metadata.ocId,
+                                                                 chunkFolder: chunkFolder,
+                                                                 filesChunk: filesChunk,
+                                                                 totalSize: totalSize,
+                                                                 folderCreated: true)
                     Task {
-                        await NCManageDatabase.shared.addChunksAsync(account: metadata.account,
-                                                                     ocId: metadata.ocId,
-                                                                     chunkFolder: chunkFolder,
-                                                                     filesChunk: filesChunk)
                         await self.transferDispatcher.notifyAllDelegates { delegate in
                             delegate.transferChange(networkingStatus: self.global.networkingStatusUploading,
                                                     account: metadata.account,
@@ -131,20 +133,20 @@ extension NCNetworking {
                         await NCManageDatabase.shared.setMetadataSessionAsync(ocId: metadata.ocId,
                                                                               sessionTaskIdentifier: task.taskIdentifier,
                                                                               status: self.global.metadataStatusUploading)
+#if !EXTENSION
+                        await NCTransferJournal.shared.start(ocId: metadata.ocId,
+                                                             account: metadata.account,
+                                                             session: metadata.session,
+                                                             serverUrlFileName: metadata.serverUrlFileName,
+                                                             taskIdentifier: task.taskIdentifier)
+#endif
                     }
                 } uploadProgressHandler: { totalBytesExpected, totalBytes, fractionCompleted in
-                    Task {
-                        guard await self.progressQuantizer.shouldEmit(serverUrlFileName: metadata.serverUrlFileName, fraction: fractionCompleted) else {
-                            return
-                        }
-                        await self.transferDispatcher.notifyAllDelegates { delegate in
-                            delegate.transferProgressDidUpdate(progress: Float(fractionCompleted),
-                                                               totalBytes: totalBytes,
-                                                               totalBytesExpected: totalBytesExpected,
-                                                               fileName: metadata.fileName,
-                                                               serverUrl: metadata.serverUrl)
-                        }
-                    }
+                    self.progressBus.post(progress: Float(fractionCompleted),
+                                          totalBytes: totalBytes,
+                                          totalBytesExpected: totalBytesExpected,
+                                          fileName: metadata.fileName,
+                                          serverUrl: metadata.serverUrl)
                     uploadProgressHandler(totalBytesExpected, totalBytes, fractionCompleted)
                 } uploaded: { fileChunk in
                     Task {
@@ -189,6 +191,9 @@ extension NCNetworking {
                 await uploadError(withMetadata: metadata, error: backupError)
             }
         }
+#if !EXTENSION
+        await NCTransferJournal.shared.end(ocId: metadata.ocId)
+#endif
 
         return(metadata.account, backupFile, backupError)
     }
@@ -278,6 +283,13 @@ extension NCNetworking {
             sessionTaskIdentifier: task.taskIdentifier,
             status: global.metadataStatusUploading
         )
+#if !EXTENSION
+        await NCTransferJournal.shared.start(ocId: metadata.ocId,
+                                             account: metadata.account,
+                                             session: metadata.session,
+                                             serverUrlFileName: metadata.serverUrlFileName,
+                                             taskIdentifier: task.taskIdentifier)
+#endif
 
         await self.transferDispatcher.notifyAllDelegates { delegate in
             delegate.transferChange(networkingStatus: self.global.networkingStatusUploading,
@@ -92,7 +92,24 @@ class NCNetworking: @unchecked Sendable, NextcloudKitDelegate {
     // Actors
     let transferDispatcher = NCTransferDelegateDispatcher()
     let networkingTasks = NetworkingTasks()
-    let progressQuantizer = ProgressQuantizer()
+
+    // Progress of the transfers, delivered once per frame
+    let progressBus = NCTransferProgressBus { updates in
+#if !EXTENSION
+        for update in updates {
+            await NCTransferJournal.shared.checkpoint(serverUrlFileName: update.serverUrl + "/" + update.fileName, bytes: update.totalBytes)
+        }
+#endif
+        await NCNetworking.shared.transferDispatcher.notifyAllDelegates { delegate in
+            for update in updates {
+                delegate.transferProgressDidUpdate(progress: update.progress,
+                                                   totalBytes: update.totalBytes,
+                                                   totalBytesExpected: update.totalBytesExpected,
+                                                   fileName: update.fileName,
+                                                   serverUrl: update.serverUrl)
+            }
+        }
+    }
 
 #if !EXTENSION
     let metadataDownloadTranfersSuccess = NCMetadataDownloadTranfersSuccess()
@@ -19,6 +19,11 @@ actor NCNetworkingProcess {
     private let networking = NCNetworking.shared
 
     private var currentTask: Task<Void, Never>?
+    // A change arrived while the pipeline was running: run it again when it ends
+    private var needsRerun = false
+    private let transferQueue = NCTransferQueue.shared
+    private let concurrency = NCTransferConcurrency.shared
+    private var lastQueueStatisticsLog: Date = .distantPast
 
     @MainActor
     private var currentUploadTask: Task<(account: String, file: NKFile?, error: NKError), Never>?
@@ -26,11 +31,13 @@ actor NCNetworkingProcess {
     @MainActor
     private var currentUploadRequest: UploadRequest?
 
+    // Runs an E2EE batch: cancelling it stops every file of the batch
+    @MainActor
+    private var currentUploadBatch: Task<Void, Never>?
+
     private var enableControllingScreenAwake = true
     private var currentAccount = ""
     private var lastScheduledAndInProgressCount: Int = 0
-    private var lastVerifyZombieDate: Date = .distantPast
-    private let verifyZombieInterval: TimeInterval = 12
 
     private var timer: DispatchSourceTimer?
     private let timerQueue = DispatchQueue(label: "com.nextcloud.timerProcess", qos: .utility)
@@ -87,6 +94,15 @@ actor NCNetworkingProcess {
                                     NextcloudKit.shared.nkCommonInstance.identifierSessionUploadBackgroundWWan]
 
     private init() {
+        // New work starts the pipeline right away, the timer only paces retries and housekeeping
+        transferQueue.onEnqueue = { [weak self] in
+            guard let self else { return }
+
+            Task {
+                await self.handleTimerTick(rerunIfBusy: true)
+            }
+        }
+
         NotificationCenter.default.addObserver(forName: NSNotification.Name(rawValue: NCGlobal.shared.notificationCenterPlayerIsPlaying), object: nil, queue: nil) { [weak self] _ in
             guard let self else { return }
 
@@ -174,9 +190,52 @@ actor NCNetworkingProcess {
     private func scheduledAndInProgressCount() async -> Int {
         let statuses = NCGlobal.shared.metadatasStatusInWaitingDownloadUpload + NCGlobal.shared.metadatasStatusDownloadingUploading
 
+        if let count = transferQueue.count(status: statuses) {
+            return count
+        }
         return await NCManageDatabase.shared.getMetadatasStatusCountAsync(status: statuses)
     }
 
+    private func getMetadataProcess() async -> [tableMetadata] {
+        if let entries = transferQueue.next(limit: NCBrandOptions.shared.numMaximumProcess * 4) {
+            // Full rows read only for the batch, in queue order
+            let metadatas = await NCManageDatabase.shared.getMetadatasFromOcIdsAsync(entries.map { $0.ocId })
+            let metadatasByOcId = Dictionary(metadatas.map { ($0.ocId, $0) }, uniquingKeysWith: { first, _ in first })
+            return entries.compactMap { metadatasByOcId[$0.ocId] }
+        }
+        return await NCManageDatabase.shared.getMetadataProcess()
+    }
+
+    private func logQueueStatisticsIfNeeded() async {
+        guard Date().timeIntervalSince(lastQueueStatisticsLog) >= 60 else {
+            return
+        }
+        lastQueueStatisticsLog = Date()
+
+        let statistics = transferQueue.statistics()
+        guard statistics.depth > 0 else {
+            return
+        }
+        nkLog(debug: "Transfer queue: depth \(statistics.depth), waiting \(statistics.waiting), in progress \(statistics.inProgress), dispatched \(statistics.dispatched), latency avg \(String(format: "%.2f", statistics.averageDispatchLatency)) s max \(String(format: "%.2f", statistics.maxDispatchLatency)) s")
+
+        let existence = await NCRemoteExistenceResolver.shared.statistics()
+        if existence.checks > 0 {
+            nkLog(debug: "Auto upload existence: \(existence.checks) checks, \(existence.listings) folder listings, \(existence.fallbacks) single requests, \(existence.saved) PROPFIND saved")
+        }
+
+        let journal = await NCTransferJournal.shared.statistics()
+        nkLog(debug: "Transfer journal: \(journal.active) active, \(journal.records) records, \(journal.compactions) compactions, replay \(journal.replayedRecords) records in \(String(format: "%.3f", journal.replayTime)) s, released \(journal.released), last recovery \(String(format: "%.3f", journal.recoveryTime)) s")
+
+        let progress = NCNetworking.shared.progressBus.statistics()
+        if progress.posted > 0 {
+            nkLog(debug: "Transfer progress: \(progress.posted) updates, \(progress.filtered) filtered, \(progress.merged) merged, \(progress.delivered) delivered in \(progress.batches) batches")
+        }
+
+        for budget in concurrency.statistics() {
+            nkLog(debug: "Transfer concurrency \(budget.host) \(budget.sizeClass.rawValue): limit \(budget.limit), in flight \(budget.inFlight), completed \(budget.completed), failed \(budget.failed), throughput \(ByteCountFormatter.string(fromByteCount: Int64(budget.throughput), countStyle: .binary))/s, latency \(String(format: "%.2f", budget.latency)) s")
+        }
+    }
+
     func startTimer(interval: TimeInterval) async {
         let isActive = await MainActor.run {
             UIApplication.shared.applicationState == .active
@@ -216,19 +275,31 @@ actor NCNetworkingProcess {
     private func cancelCurrentUpload() async {
         self.currentUploadTask?.cancel()
         self.currentUploadRequest?.cancel()
+        self.currentUploadBatch?.cancel()
         self.currentUploadTask = nil
         self.currentUploadRequest = nil
+        self.currentUploadBatch = nil
     }
 
-    private func handleTimerTick() async {
+    private func handleTimerTick(rerunIfBusy: Bool = false) async {
         if currentTask != nil {
-            print("[NKLOG] current task is running")
+            if rerunIfBusy {
+                needsRerun = true
+            }
             return
         }
 
+        transferQueue.start()
+        needsRerun = false
+
         currentTask = Task {
             defer {
                 currentTask = nil
+                if needsRerun {
+                    Task {
+                        await self.handleTimerTick()
+                    }
+                }
             }
 
             if Task.isCancelled {
@@ -258,7 +329,8 @@ actor NCNetworkingProcess {
 
             // METADATAS
             //
-            var metadatas = await NCManageDatabase.shared.getMetadataProcess()
+            var metadatas = await getMetadataProcess()
+            await logQueueStatisticsIfNeeded()
 
             // TRANSFERS UPLOAD SUCCESS
             //
@@ -277,15 +349,10 @@ actor NCNetworkingProcess {
             }
 
             // ZOMBIE
-            // Check periodically while transfers are marked as in progress. Do not let a
-            // stalled download keep a process slot occupied, but avoid querying all URLSession
-            // task lists on every pipeline tick.
-            let countProgress = metadatas.filter { global.metadatasStatusDownloadingUploading.contains($0.status) }.count
-            if countProgress > 0,
-               Date().timeIntervalSince(lastVerifyZombieDate) >= verifyZombieInterval {
-                lastVerifyZombieDate = Date()
-                await NCNetworking.shared.verifyZombie()
-                metadatas = await NCManageDatabase.shared.getMetadataProcess()
+            // The transfer journal gives the transfers that may be dead, the others are not checked.
+            // A released transfer frees its process slot right away.
+            if await NCNetworking.shared.recoverTransfers() > 0 {
+                metadatas = await getMetadataProcess()
             }
 
             if !metadatas.isEmpty {
@@ -356,11 +423,8 @@ actor NCNetworkingProcess {
 
     private func runMetadataPipelineAsync(metadatas: [tableMetadata]) async {
         let database = NCManageDatabase.shared
-        let countDownloadTransferSuccess = await NCNetworking.shared.metadataDownloadTranfersSuccess.count()
-        let countUploadTransferSuccess = await NCNetworking.shared.metadataUploadTranfersSuccess.count()
-        let countDownloading = max(0, metadatas.filter { $0.status == self.global.metadataStatusDownloading }.count - countDownloadTransferSuccess)
-        let countUploading = max(0, metadatas.filter { $0.status == self.global.metadataStatusUploading }.count - countUploadTransferSuccess)
-        var availableProcess = NCBrandOptions.shared.numMaximumProcess - (countDownloading + countUploading)
+        // Slots per host and file size, adapted to the measured latency and throughput
+        var slots = concurrency.availableSlots(metadatas: metadatas)
         let isWiFi = self.networking.networkReachability == NKTypeReachability.reachableEthernetOrWiFi
         // Banner
         var banner: LucidBanner?
@@ -389,30 +453,44 @@ actor NCNetworkingProcess {
             return
         }
 
-        // TEST AVAILABLE PROCESS
-        //
-        guard availableProcess > 0, timer != nil else {
+        guard timer != nil else {
             return
         }
 
         // DOWNLOAD
         //
-        let filteredDownload = metadatas
+        let metadatasWaitDownload = metadatas
             .filter { $0.session == self.networking.sessionDownloadBackground && $0.status == NCGlobal.shared.metadataStatusWaitDownload }
             .sorted { ($0.sessionDate ?? Date.distantFuture) < ($1.sessionDate ?? Date.distantFuture) }
-            .prefix(availableProcess)
-        let metadatasWaitDownload = Array(filteredDownload)
 
-        for metadata in metadatasWaitDownload {
-            availableProcess -= 1
-            if !isAppInBackground {
-                await networking.downloadFileInBackground(metadata: metadata)
+        for metadata in metadatasWaitDownload where !isAppInBackground {
+            guard slots.take(concurrency.key(for: metadata)) else {
+                continue
+            }
+            concurrency.begin(metadata)
+
+            // LARGE FILE: byte ranges in parallel while the app is active, resumed after a kill
+            if metadata.size >= NCSegmentedDownload.minimumSize {
+                // Marked as downloading before the task starts, so that the next run does not dispatch it again
+                await database.setMetadataSessionAsync(ocId: metadata.ocId,
+                                                       session: networking.sessionDownload,
+                                                       sessionTaskIdentifier: 0,
+                                                       status: global.metadataStatusDownloading)
+                await NCTransferJournal.shared.start(ocId: metadata.ocId,
+                                                     account: metadata.account,
+                                                     session: networking.sessionDownload,
+                                                     serverUrlFileName: metadata.serverUrlFileName,
+                                                     taskIdentifier: 0)
+                Task {
+                    let results = await self.networking.downloadFile(metadata: metadata)
+                    NCTransferConcurrency.shared.finish(serverUrlFileName: metadata.serverUrlFileName, bytes: metadata.size, error: results.nkError)
+                }
+            } else if await networking.downloadFileInBackground(metadata: metadata) != .success {
+                concurrency.discard(serverUrlFileName: metadata.serverUrlFileName)
             }
         }
 
-        // TEST AVAILABLE PROCESS
-        //
-        guard availableProcess > 0, timer != nil else {
+        guard timer != nil else {
             return
         }
 
@@ -434,18 +512,34 @@ actor NCNetworkingProcess {
             }
             .sorted { // Earlier dates first; nils go to the end
                 ($0.sessionDate ?? .distantFuture) < ($1.sessionDate ?? .distantFuture)
-            }
-            .prefix(availableProcess))
+            })
+        // Uploads into encrypted folders are sent together at the end, one lock per folder
+        var metadatasE2EE: [tableMetadata] = []
 
-        for metadata in metadatasWaitUpload {
-            guard availableProcess > 0, timer != nil else { return }
-            // WiFi check
-            if !isWiFi && metadata.session == networking.sessionUploadBackgroundWWan {
-                continue
+        // WiFi check, no slot left for the host
+        let metadatasExtract = metadatasWaitUpload.filter {
+            (isWiFi || $0.session != networking.sessionUploadBackgroundWWan) && slots.hasAny(host: concurrency.key(for: $0).host)
+        }
+        // extract image/video ahead of the uploads
+        let prefetcher = NCCameraRollPrefetcher(metadatas: metadatasExtract)
+        defer {
+            prefetcher.cancel()
+            let report = prefetcher.report()
+            if report.items > 1 {
+                nkLog(debug: "Camera roll prefetch: \(report.description)")
             }
-            // extract image/video
-            let extractMetadatas = await NCCameraRoll().extractCameraRoll(from: metadata)
+        }
+
+        let hosts = Set(metadatasExtract.map { concurrency.key(for: $0).host })
+
+        while let item = await prefetcher.next() {
+            let metadata = item.metadata
+            let extractMetadatas = item.extracted
             guard timer != nil else { return }
+            // All the slots have been taken, what is prefetched stays extracted for the next run
+            if !hosts.contains(where: { slots.hasAny(host: $0) }) {
+                break
+            }
             // no extract photo
             if extractMetadatas.isEmpty {
                 await database.deleteMetadataAsync(id: metadata.ocId)
@@ -467,7 +561,7 @@ actor NCNetworkingProcess {
                 // AUTO-UPLOAD: CHECK FILE EXISTS
                 //
                 if metadata.sessionSelector == global.selectorUploadAutoUpload {
-                    let existsResult = await networking.fileExists(serverUrlFileName: metadata.serverUrlFileName, account: metadata.account)
+                    let existsResult = await NCRemoteExistenceResolver.shared.fileExists(serverUrl: metadata.serverUrl, fileName: metadata.fileName, account: metadata.account)
                     if existsResult == .success {
                         // File exists → delete from local metadata and skip
                         await NCManageDatabase.shared.deleteMetadataAsync(id: metadata.ocId)
@@ -482,52 +576,93 @@ actor NCNetworkingProcess {
                 }
 
                 // UPLOAD E2EE
+                // The batch does not report to the AIMD budgets, so its files take no slot:
+                // it is bounded by its own cap
                 //
-                if metadata.isDirectoryE2EE,
-                   let windowScene = await SceneManager.shared.getWindow(sceneIdentifier: metadata.sceneIdentifier)?.windowScene {
-                    let controller = await getController(account: metadata.account, sceneIdentifier: metadata.sceneIdentifier)
-                    let payload = LucidBannerPayload(blocksTouches: true,
-                                                     draggable: false)
-                    if banner == nil {
-                        (banner, token) = await showUploadBanner(windowScene: windowScene,
-                                                                 payload: payload,
-                                                                 allowMinimizeOnTap: false,
-                                                                 onButtonTap: {
-                            Task {
-                                await self.cancelCurrentUpload()
-                            }
-                        })
+                if metadata.isDirectoryE2EE {
+                    if metadatasE2EE.count < NCNetworkingE2EEUpload.batchMaximumFiles {
+                        metadatasE2EE.append(metadata)
                     }
+                    continue
+                }
 
-                    await NCNetworkingE2EEUpload().upload(metadata: metadata,
-                                                          controller: controller,
-                                                          banner: banner,
-                                                          stageBanner: .button,
-                                                          tokenBanner: token) { uploadRequest in
-                        Task {@MainActor in
-                            self.currentUploadRequest = uploadRequest
-                        }
-                    } currentUploadTask: { task in
-                        Task {@MainActor in
-                            self.currentUploadTask = task
-                        }
-                    }
+                // AVAILABLE SLOT
+                // Taken right before the dispatch, a file skipped above does not hold one
+                guard slots.take(concurrency.key(for: metadata)) else {
+                    continue
+                }
 
                 // UPLOAD CHUNK
                 //
-                } else if metadata.chunk > 0 {
+                if metadata.chunk > 0 {
                     await uploadChunk(metadata: metadata)
                 // UPLOAD IN BACKGROUND
                 //
                 } else {
-                    await networking.uploadFileInBackground(metadata: metadata)
+                    concurrency.begin(metadata)
+                    if await networking.uploadFileInBackground(metadata: metadata) != .success {
+                        concurrency.discard(serverUrlFileName: metadata.serverUrlFileName)
+                    }
                 }
+            }
+        }
+
+        // UPLOAD E2EE
+        //
+        if timer != nil,
+           !isAppInBackground,
+           let metadata = metadatasE2EE.first,
+           let windowScene = await SceneManager.shared.getWindow(sceneIdentifier: metadata.sceneIdentifier)?.windowScene {
+            let controller = await getController(account: metadata.account, sceneIdentifier: metadata.sceneIdentifier)
+            let payload = LucidBannerPayload(blocksTouches: true,
+                                             draggable: false)
+            if banner == nil {
+                (banner, token) = await showUploadBanner(windowScene: windowScene,
+                                                         payload: payload,
+                                                         allowMinimizeOnTap: false,
+                                                         onButtonTap: {
+                    Task {
+                        await self.cancelCurrentUpload()
+                    }
+                })
+            }
 
-                availableProcess -= 1
+            if metadatasE2EE.count == 1 {
+                await NCNetworkingE2EEUpload().upload(metadata: metadata,
+                                                      controller: controller,
+                                                      banner: banner,
+                                                      stageBanner: .button,
+                                                      tokenBanner: token) { uploadRequest in
+                    Task {@MainActor in
+                        self.currentUploadRequest = uploadRequest
+                    }
+                } currentUploadTask: { task in
+                    Task {@MainActor in
+                        self.currentUploadTask = task
+                    }
+                }
+            } else {
+                await uploadBatchE2EE(metadatas: metadatasE2EE, controller: controller, banner: banner, token: token)
             }
         }
     }
 
+    @MainActor
+    private func uploadBatchE2EE(metadatas: [tableMetadata], controller: NCMainTabBarController?, banner: LucidBanner?, token: Int?) async {
+        let task = Task { @MainActor in
+            _ = await NCNetworkingE2EEUpload().uploadBatch(metadatas: metadatas,
+                                                           controller: controller,
+                                                           banner: banner,
+                                                           stageBanner: .button,
+                                                           tokenBanner: token)
+        }
+        currentUploadBatch = task
+        await task.value
+        if currentUploadBatch == task {
+            currentUploadBatch = nil
+        }
+    }
+
     // MARK: - Upload in chunk mode
 
     @MainActor
@@ -0,0 +1,394 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import NextcloudKit
+import Alamofire
+
+/// Download of a large file in byte ranges fetched concurrently.
+///
+/// The file is preallocated as `<file>.part` and every segment is written at its offset; the segments
+/// received are kept in a bitmap persisted as `<file>.segments`, so after the app is killed the download
+/// resumes with the missing ones. Every range is requested with `If-Match` on the etag of the metadata
+/// and the etag of each response is checked: when the file changed on the server the partial file is
+/// dropped and `download` throws `etagChanged`. The number of segments in flight follows the same window
+/// as the parallel chunk upload.
+final class NCSegmentedDownload: @unchecked Sendable {
+    /// Files from this size are downloaded in segments
+    static let minimumSize: Int64 = 64 * 1024 * 1024
+    static let segmentSize: Int64 = 8 * 1024 * 1024
+    static let copyBlockSize = 256 * 1024
+
+    static let etagChanged = NKError(errorCode: NCGlobal.shared.errorPreconditionFailed, errorDescription: "The file changed on the server during the download")
+
+    /// Segments received, persisted next to the partial file
+    struct State: Codable, Equatable {
+        let etag: String
+        let size: Int64
+        let segmentSize: Int64
+        private(set) var bitmap: [UInt8]
+
+        init(etag: String, size: Int64, segmentSize: Int64) {
+            self.etag = etag
+            self.size = size
+            self.segmentSize = segmentSize
+            self.bitmap = [UInt8](repeating: 0, count: (Self.count(size: size, segmentSize: segmentSize) + 7) / 8)
+        }
+
+        var count: Int {
+            Self.count(size: size, segmentSize: segmentSize)
+        }
+
+        var missing: [Int] {
+            (0..<count).filter { !isReceived($0) }
+        }
+
+        var receivedBytes: Int64 {
+            (0..<count).filter { isReceived($0) }.reduce(0) { $0 + Int64(range(of: $1).count) }
+        }
+
+        func range(of index: Int) -> Range<Int64> {
+            let lowerBound = Int64(index) * segmentSize
+            return lowerBound..<min(size, lowerBound + segmentSize)
+        }
+
+        func isReceived(_ index: Int) -> Bool {
+            bitmap[index / 8] & (1 << UInt8(index % 8)) != 0
+        }
+
+        mutating func setReceived(_ index: Int) {
+            bitmap[index / 8] |= 1 << UInt8(index % 8)
+        }
+
+        private static func count(size: Int64, segmentSize: Int64) -> Int {
+            Int((size + segmentSize - 1) / segmentSize)
+        }
+    }
+
+    private let metadata: tableMetadata
+    private let fileNameLocalPath: String
+    private let partialPath: String
+    private let statePath: String
+    private let queue: DispatchQueue
+    private let maximumAttempts = 3
+
+    private let lock = NSLock()
+    private var state: State
+    private var requests: [Int: DownloadRequest] = [:]
+    // Progress: bytes of the segments written and of the ones in flight
+    private var writtenBytes: Int64 = 0
+    private var receivedBytes: [Int: Int64] = [:]
+    private var isStarted = false
+
+    init(metadata: tableMetadata, fileNameLocalPath: String, queue: DispatchQueue) {
+        self.metadata = metadata
+        self.fileNameLocalPath = fileNameLocalPath
+        self.partialPath = fileNameLocalPath + ".part"
+        self.statePath = fileNameLocalPath + ".segments"
+        self.queue = queue
+        self.state = State(etag: metadata.etag, size: metadata.size, segmentSize: Self.segmentSize)
+    }
+
+    // MARK: -
+
+    /// Downloads the missing segments and moves the completed file to `fileNameLocalPath`.
+    /// `started` receives the first task, `taskHandler` every task.
+    /// - Returns: The etag of the file.
+    func download(requestHandler: @escaping (_ request: DownloadRequest) -> Void,
+                  started: @escaping (_ task: URLSessionTask) -> Void,
+                  taskHandler: @escaping (_ task: URLSessionTask) -> Void,
+                  progressHandler: @escaping (_ progress: Progress) -> Void) async throws -> String {
+        try prepare()
+
+        let missing = state.missing
+        if missing.count < state.count {
+            nkLog(debug: "Resuming download of \(metadata.fileNameView): \(missing.count) of \(state.count) segments missing")
+        }
+
+        try await withTaskCancellationHandler {
+            try await fetch(segments: missing,
+                            requestHandler: requestHandler,
+                            started: started,
+                            taskHandler: taskHandler,
+                            progressHandler: progressHandler)
+        } onCancel: {
+            cancelRequests()
+        }
+
+        try? FileManager.default.removeItem(atPath: fileNameLocalPath)
+        try FileManager.default.moveItem(atPath: partialPath, toPath: fileNameLocalPath)
+        try? FileManager.default.removeItem(atPath: statePath)
+
+        return state.etag
+    }
+
+    /// Removes the partial file and its segments
+    func discard() {
+        try? FileManager.default.removeItem(atPath: partialPath)
+        try? FileManager.default.removeItem(atPath: statePath)
+    }
+
+    /// True when a partial file of the same version of the file is on disk with its segments
+    var isResumable: Bool {
+        persistedState() != nil
+    }
+
+    // MARK: -
+
+    // Reuses the partial file of the same version of the file, or preallocates a new one
+    private func prepare() throws {
+        if let persisted = persistedState() {
+            state = persisted
+            return
+        }
+
+        discard()
+        state = State(etag: metadata.etag, size: metadata.size, segmentSize: Self.segmentSize)
+        guard FileManager.default.createFile(atPath: partialPath, contents: nil) else {
+            throw NKError(errorCode: NCGlobal.shared.errorCreationFile, errorDescription: "Cannot create \(partialPath)")
+        }
+        let fileHandle = try FileHandle(forWritingTo: URL(fileURLWithPath: partialPath))
+        defer {
+            try? fileHandle.close()
+        }
+        try fileHandle.truncate(atOffset: UInt64(metadata.size))
+        try persist()
+    }
+
+    private func persistedState() -> State? {
+        guard let data = FileManager.default.contents(atPath: statePath),
+              let persisted = try? JSONDecoder().decode(State.self, from: data),
+              persisted.etag == metadata.etag,
+              persisted.size == metadata.size,
+              persisted.segmentSize == Self.segmentSize,
+              NCUtilityFileSystem().getFileSize(filePath: partialPath) == metadata.size else {
+            return nil
+        }
+        return persisted
+    }
+
+    private func fetch(segments: [Int],
+                       requestHandler: @escaping (_ request: DownloadRequest) -> Void,
+                       started: @escaping (_ task: URLSessionTask) -> Void,
+                       taskHandler: @escaping (_ task: URLSessionTask) -> Void,
+                       progressHandler: @escaping (_ progress: Progress) -> Void) async throws {
+        var pending = segments
+        var attempts: [Int: Int] = [:]
+        var inFlight = 0
+        var window = NCChunkUpload.Window(maximum: min(8, NCBrandOptions.shared.httpMaximumConnectionsPerHostInDownload))
+        // The bitmap changes while the segments are written, the layout does not
+        let layout = state
+        let progress = Progress(totalUnitCount: layout.size)
+        let completedBytes = layout.receivedBytes
+
+        try await withThrowingTaskGroup(of: (index: Int, error: NKError).self) { group in
+            while !pending.isEmpty || inFlight > 0 {
+                try Task.checkCancellation()
+
+                while inFlight < window.width, !pending.isEmpty {
+                    let index = pending.removeFirst()
+                    inFlight += 1
+                    group.addTask {
+                        let error = await self.fetch(segment: index,
+                                                     range: layout.range(of: index),
+                                                     etag: layout.etag,
+                                                     requestHandler: requestHandler,
+                                                     started: started,
+                                                     taskHandler: taskHandler) {
+                            self.lock.lock()
+                            progress.completedUnitCount = completedBytes + self.writtenBytes + self.receivedBytes.values.reduce(0, +)
+                            self.lock.unlock()
+                            progressHandler(progress)
+                        }
+                        return (index, error)
+                    }
+                }
+
+                guard let result = try await group.next() else {
+                    break
+                }
+                inFlight -= 1
+
+                if result.error == .success {
+                    window.success(bytes: Int64(layout.range(of: result.index).count))
+                    continue
+                }
+
+                if result.error.errorCode == Self.etagChanged.errorCode {
+                    group.cancelAll()
+                    cancelRequests()
+                    discard()
+                    throw Self.etagChanged
+                }
+
+                try Task.checkCancellation()
+                let attempt = attempts[result.index, default: 0] + 1
+                attempts[result.index] = attempt
+                guard attempt < maximumAttempts, isRetryable(result.error) else {
+                    group.cancelAll()
+                    cancelRequests()
+                    throw result.error
+                }
+                nkLog(debug: "Segment \(result.index) of \(metadata.fileNameView) failed (\(result.error.errorCode)), retrying with \(max(1, window.width / 2)) in flight")
+                window.failure()
+                pending.insert(result.index, at: 0)
+            }
+        }
+    }
+
+    // Downloads one range into its own file and copies it at its offset in the partial file
+    private func fetch(segment index: Int,
+                       range: Range<Int64>,
+                       etag expectedEtag: String,
+                       requestHandler: @escaping (_ request: DownloadRequest) -> Void,
+                       started: @escaping (_ task: URLSessionTask) -> Void,
+                       taskHandler: @escaping (_ task: URLSessionTask) -> Void,
+                       progress: @escaping () -> Void) async -> NKError {
+        let segmentPath = partialPath + "." + String(index)
+        let headers = ["Range": "bytes=\(range.lowerBound)-\(range.upperBound - 1)",
+                       "If-Match": "\"" + expectedEtag + "\""]
+
+        let results = await NextcloudKit.shared.downloadAsync(serverUrlFileName: metadata.serverUrlFileName,
+                                                              fileNameLocalPath: segmentPath,
+                                                              account: metadata.account,
+                                                              options: NKRequestOptions(customHeader: headers, queue: queue)) { request in
+            self.lock.lock()
+            self.requests[index] = request
+            self.lock.unlock()
+            requestHandler(request)
+        } taskHandler: { task in
+            Task {
+                let identifier = await NCNetworking.shared.networkingTasks.createIdentifier(account: self.metadata.account,
+                                                                                            path: self.metadata.serverUrlFileName + "_" + String(index),
+                                                                                            name: "download")
+                await NCNetworking.shared.networkingTasks.track(identifier: identifier, task: task)
+            }
+            self.lock.lock()
+            let isFirst = !self.isStarted
+            self.isStarted = true
+            self.lock.unlock()
+            if isFirst {
+                started(task)
+            }
+            taskHandler(task)
+        } progressHandler: { value in
+            self.lock.lock()
+            if self.requests[index] != nil {
+                self.receivedBytes[index] = value.completedUnitCount
+            }
+            self.lock.unlock()
+            progress()
+        }
+
+        defer {
+            try? FileManager.default.removeItem(atPath: segmentPath)
+        }
+
+        lock.lock()
+        requests.removeValue(forKey: index)
+        lock.unlock()
+
+        let error = store(error: results.nkError, response: results.response?.response, segmentPath: segmentPath, range: range, etag: expectedEtag, segment: index)
+        if error != .success {
+            // Counted again from zero when the segment is retried
+            lock.lock()
+            receivedBytes.removeValue(forKey: index)
+            lock.unlock()
+        }
+
+        return error
+    }
+
+    // Checks the response of a segment and copies it in the partial file
+    private func store(error: NKError,
+                       response: HTTPURLResponse?,
+                       segmentPath: String,
+                       range: Range<Int64>,
+                       etag expectedEtag: String,
+                       segment index: Int) -> NKError {
+        guard error == .success else {
+            return error
+        }
+
+        // The server must answer with the range of the same version of the file
+        let etag = NextcloudKit.shared.nkCommonInstance.normalizedETag(NextcloudKit.shared.nkCommonInstance.findHeader("etag", allHeaderFields: response?.allHeaderFields))
+        if let etag, !etag.isEmpty, etag != expectedEtag {
+            return Self.etagChanged
+        }
+        guard response?.statusCode == 206,
+              NCUtilityFileSystem().getFileSize(filePath: segmentPath) == Int64(range.count) else {
+            return NKError(errorCode: NCGlobal.shared.errorBadServerResponse, errorDescription: "Unexpected response for the range \(range) of \(metadata.fileNameView)")
+        }
+
+        do {
+            try copy(segmentPath, at: range.lowerBound)
+        } catch {
+            return NKError(error: error)
+        }
+
+        // Bytes in flight become bytes written in one step, so the progress never goes back
+        lock.lock()
+        defer { lock.unlock() }
+        state.setReceived(index)
+        receivedBytes.removeValue(forKey: index)
+        writtenBytes += Int64(range.count)
+        do {
+            try persistLocked()
+        } catch {
+            return NKError(error: error)
+        }
+
+        return .success
+    }
+
+    /// Copies the segment at its offset `copyBlockSize` bytes at a time. Every segment has its own
+    /// handle on the partial file, so they are copied concurrently. The data is not synchronized: the page
+    /// cache survives the app being killed, which is what the bitmap resumes from.
+    private func copy(_ segmentPath: String, at offset: Int64) throws {
+        let reader = try FileHandle(forReadingFrom: URL(fileURLWithPath: segmentPath))
+        defer {
+            try? reader.close()
+        }
+        let writer = try FileHandle(forWritingTo: URL(fileURLWithPath: partialPath))
+        defer {
+            try? writer.close()
+        }
+
+        try writer.seek(toOffset: UInt64(offset))
+        while let data = try reader.read(upToCount: Self.copyBlockSize), !data.isEmpty {
+            try writer.write(contentsOf: data)
+        }
+    }
+
+    private func persist() throws {
+        lock.lock()
+        defer { lock.unlock() }
+        try persistLocked()
+    }
+
+    // Must be called with lock held
+    private func persistLocked() throws {
+        let data = try JSONEncoder().encode(state)
+        try data.write(to: URL(fileURLWithPath: statePath), options: .atomic)
+    }
+
+    private func cancelRequests() {
+        lock.lock()
+        let requests = Array(self.requests.values)
+        lock.unlock()
+
+        requests.forEach { $0.cancel() }
+    }
+
+    private func isRetryable(_ error: NKError) -> Bool {
+        switch error.errorCode {
+        case NSURLErrorTimedOut, NSURLErrorNetworkConnectionLost, NSURLErrorCannotConnectToHost:
+            return true
+        case 429, 500...599:
+            return true
+        default:
+            return false
+        }
+    }
+}
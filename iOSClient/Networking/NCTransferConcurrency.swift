@@ -0,0 +1,259 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import NextcloudKit
+
+/// Per-host transfer limits adapted to the link with AIMD (additive increase, multiplicative decrease).
+///
+/// Every host has two budgets, small and large files, so a long upload never holds the slots of hundreds of
+/// small ones. A completed transfer is a sample: small files measure the latency of a request, large files
+/// the throughput of the link. While the samples stay close to the best seen the limit grows by one slot per
+/// window of completions; when latency builds up, throughput stops scaling or the network fails, it is halved.
+final class NCTransferConcurrency: @unchecked Sendable {
+    static let shared = NCTransferConcurrency()
+
+    enum SizeClass: String {
+        case small
+        case large
+    }
+
+    struct Key: Hashable {
+        let host: String
+        let sizeClass: SizeClass
+    }
+
+    struct Statistics {
+        let host: String
+        let sizeClass: SizeClass
+        let limit: Int
+        let inFlight: Int
+        let completed: Int
+        let failed: Int
+        /// Aggregate bytes per second of the host in this budget
+        let throughput: Double
+        let latency: TimeInterval
+    }
+
+    /// Slots left in each budget, taken while the pipeline dispatches
+    struct Slots {
+        fileprivate var available: [Key: Int]
+        fileprivate let controller: NCTransferConcurrency
+
+        func hasAny(host: String) -> Bool {
+            available[Key(host: host, sizeClass: .small), default: controller.initialLimit(.small)] > 0 ||
+            available[Key(host: host, sizeClass: .large), default: controller.initialLimit(.large)] > 0
+        }
+
+        mutating func take(_ key: Key) -> Bool {
+            let count = available[key, default: controller.initialLimit(key.sizeClass)]
+            guard count > 0 else {
+                return false
+            }
+            available[key] = count - 1
+            return true
+        }
+    }
+
+    /// Files from this size are in the large budget
+    static let largeFileSize: Int64 = 5 * 1024 * 1024
+
+    private struct Budget {
+        var limit: Double
+        var inFlight = 0
+        var completed = 0
+        var failed = 0
+        var latency: TimeInterval = 0
+        var minLatency: TimeInterval = .infinity
+        var throughput: Double = 0
+        var bestThroughput: Double = 0
+        var lastDecrease: Date = .distantPast
+    }
+
+    private struct Transfer {
+        let key: Key
+        let start: Date
+        let concurrent: Int
+    }
+
+    private let lock = NSLock()
+    private var budgets: [Key: Budget] = [:]
+    private var transfers: [String: Transfer] = [:]
+    // Completed but still in progress in the database until the success buffers are flushed
+    private var finished: Set<String> = []
+
+    private let smoothing = 0.25
+    private let maximumSmall: Int
+    private let maximumLarge: Int
+
+    init(maximumSmall: Int = NCBrandOptions.shared.numMaximumProcess,
+         maximumLarge: Int = NCBrandOptions.shared.httpMaximumConnectionsPerHost) {
+        self.maximumSmall = max(1, maximumSmall)
+        self.maximumLarge = max(1, maximumLarge)
+    }
+
+    // MARK: -
+
+    func key(for metadata: tableMetadata) -> Key {
+        let host = URL(string: metadata.urlBase)?.host ?? metadata.urlBase
+        return Key(host: host, sizeClass: metadata.size >= Self.largeFileSize || metadata.chunk > 0 ? .large : .small)
+    }
+
+    /// Slots left per budget, given the metadatas of the pipeline and the transfers begun since they were read
+    func availableSlots(metadatas: [tableMetadata], now: Date = Date()) -> Slots {
+        let inProgress = metadatas.filter { NCGlobal.shared.metadatasStatusDownloadingUploading.contains($0.status) }
+        let inProgressNames = Set(inProgress.map { $0.serverUrlFileName })
+
+        lock.lock()
+        defer { lock.unlock() }
+
+        finished.formIntersection(inProgressNames)
+        // Transfers reset by the zombie check never complete
+        transfers = transfers.filter { inProgressNames.contains($0.key) || now.timeIntervalSince($0.value.start) < 60 }
+
+        var inFlight: [Key: Int] = [:]
+        var counted: Set<String> = []
+        for metadata in inProgress where !finished.contains(metadata.serverUrlFileName) {
+            inFlight[key(for: metadata), default: 0] += 1
+            counted.insert(metadata.serverUrlFileName)
+        }
+        // Started, but the database does not say so yet
+        for (serverUrlFileName, transfer) in transfers where !counted.contains(serverUrlFileName) {
+            inFlight[transfer.key, default: 0] += 1
+        }
+
+        var available: [Key: Int] = [:]
+        for key in Set(budgets.keys).union(inFlight.keys) {
+            let count = inFlight[key] ?? 0
+            budgets[key, default: Budget(limit: Double(initialLimit(key.sizeClass)))].inFlight = count
+            available[key] = max(0, Int(budgets[key]?.limit ?? 1) - count)
+        }
+
+        return Slots(available: available, controller: self)
+    }
+
+    /// A transfer of the metadata has been started
+    func begin(_ metadata: tableMetadata, now: Date = Date()) {
+        let key = key(for: metadata)
+
+        lock.lock()
+        defer { lock.unlock() }
+
+        var budget = budgets[key] ?? Budget(limit: Double(initialLimit(key.sizeClass)))
+        budget.inFlight += 1
+        budgets[key] = budget
+        transfers[metadata.serverUrlFileName] = Transfer(key: key, start: now, concurrent: budget.inFlight)
+    }
+
+    /// The transfer could not be started
+    func discard(serverUrlFileName: String) {
+        lock.lock()
+        defer { lock.unlock() }
+
+        if let transfer = transfers.removeValue(forKey: serverUrlFileName) {
+            budgets[transfer.key]?.inFlight -= 1
+        }
+    }
+
+    /// Feeds the outcome of a transfer to the budget it was started in
+    func finish(serverUrlFileName: String, bytes: Int64, error: NKError, now: Date = Date()) {
+        lock.lock()
+        defer { lock.unlock() }
+
+        finished.insert(serverUrlFileName)
+
+        guard let transfer = transfers.removeValue(forKey: serverUrlFileName),
+              var budget = budgets[transfer.key] else {
+            return
+        }
+        budget.inFlight = max(0, budget.inFlight - 1)
+
+        if error == .success {
+            let duration = max(0.001, now.timeIntervalSince(transfer.start))
+            let aggregate = Double(bytes) / duration * Double(max(1, transfer.concurrent))
+            budget.completed += 1
+            budget.latency = budget.latency == 0 ? duration : budget.latency + smoothing * (duration - budget.latency)
+            budget.throughput = budget.throughput == 0 ? aggregate : budget.throughput + smoothing * (aggregate - budget.throughput)
+            budget.minLatency = min(budget.minLatency, duration)
+            budget.bestThroughput = max(budget.bestThroughput * 0.99, budget.throughput)
+
+            let congested: Bool
+            switch transfer.key.sizeClass {
+            case .small:
+                congested = budget.latency > 2 * budget.minLatency + 0.1
+            case .large:
+                congested = budget.throughput < 0.8 * budget.bestThroughput && transfer.concurrent > 1
+            }
+
+            if congested {
+                decrease(&budget, key: transfer.key, now: now)
+            } else {
+                budget.limit = min(Double(maximum(transfer.key.sizeClass)), budget.limit + 1 / budget.limit)
+            }
+        } else if isCongestion(error) {
+            budget.failed += 1
+            decrease(&budget, key: transfer.key, now: now)
+        }
+
+        budgets[transfer.key] = budget
+    }
+
+    func statistics() -> [Statistics] {
+        lock.lock()
+        defer { lock.unlock() }
+
+        return budgets
+            .sorted { ($0.key.host, $0.key.sizeClass.rawValue) < ($1.key.host, $1.key.sizeClass.rawValue) }
+            .map { key, budget in
+                Statistics(host: key.host,
+                           sizeClass: key.sizeClass,
+                           limit: Int(budget.limit),
+                           inFlight: budget.inFlight,
+                           completed: budget.completed,
+                           failed: budget.failed,
+                           throughput: budget.throughput,
+                           latency: budget.latency)
+            }
+    }
+
+    // MARK: -
+
+    fileprivate func initialLimit(_ sizeClass: SizeClass) -> Int {
+        switch sizeClass {
+        case .small:
+            return min(4, maximumSmall)
+        case .large:
+            return min(2, maximumLarge)
+        }
+    }
+
+    private func maximum(_ sizeClass: SizeClass) -> Int {
+        sizeClass == .small ? maximumSmall : maximumLarge
+    }
+
+    // Halves the limit at most once per latency window, the transfers started at the old limit
+    // report the same congestion
+    private func decrease(_ budget: inout Budget, key: Key, now: Date) {
+        guard now.timeIntervalSince(budget.lastDecrease) >= max(1, budget.latency) else {
+            return
+        }
+        budget.limit = max(1, budget.limit / 2)
+        budget.lastDecrease = now
+        nkLog(debug: "Transfer concurrency \(key.host) \(key.sizeClass.rawValue): limit decreased to \(Int(budget.limit))")
+    }
+
+    // Errors of the link or of an overloaded server, not of the request
+    private func isCongestion(_ error: NKError) -> Bool {
+        switch error.errorCode {
+        case NSURLErrorCancelled:
+            return false
+        case NSURLErrorTimedOut, NSURLErrorNetworkConnectionLost, NSURLErrorCannotConnectToHost, NSURLErrorNotConnectedToInternet:
+            return true
+        case 429, 500...599:
+            return true
+        default:
+            return false
+        }
+    }
+}
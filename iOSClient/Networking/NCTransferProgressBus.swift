@@ -0,0 +1,143 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import NextcloudKit
+
+/// Collects the progress of the transfers and delivers it to the delegates in batches.
+///
+/// `post` is called from the URLSession callbacks: it keeps only the latest progress of each transfer under a
+/// short lock, without creating a task or hopping to an actor. At most once per `interval` (one display frame
+/// by default) the pending updates are delivered together, so the delegates get one main actor hop per frame
+/// whatever the number of transfers. Updates that do not change the integer percent are dropped, as the
+/// former quantizer did, and a delivery never overlaps the previous one.
+final class NCTransferProgressBus: @unchecked Sendable {
+    struct Update: Sendable {
+        let progress: Float
+        let totalBytes: Int64
+        let totalBytesExpected: Int64
+        let fileName: String
+        let serverUrl: String
+    }
+
+    struct Statistics {
+        /// Updates received
+        let posted: Int
+        /// Updates dropped because the integer percent did not change
+        let filtered: Int
+        /// Updates replaced by a newer one of the same transfer before the delivery
+        let merged: Int
+        /// Updates delivered to the delegates
+        let delivered: Int
+        /// Batches delivered, one main actor hop each
+        let batches: Int
+    }
+
+    typealias Delivery = @Sendable ([Update]) async -> Void
+
+    private let interval: TimeInterval
+    private let deliver: Delivery
+
+    private let lock = NSLock()
+    private var pending: [String: Update] = [:]
+    private var lastPercent: [String: Int] = [:]
+    private var isScheduled = false
+    private var lastDelivery: TimeInterval = 0
+
+    private var countPosted = 0
+    private var countFiltered = 0
+    private var countMerged = 0
+    private var countDelivered = 0
+    private var countBatches = 0
+
+    init(interval: TimeInterval = 1.0 / 60, deliver: @escaping Delivery) {
+        self.interval = interval
+        self.deliver = deliver
+    }
+
+    // MARK: -
+
+    func post(progress: Float, totalBytes: Int64, totalBytesExpected: Int64, fileName: String, serverUrl: String) {
+        let key = serverUrl + "/" + fileName
+        let percent = min(max(Int((Double(progress) * 100).rounded(.down)), 0), 100)
+        let update = Update(progress: progress, totalBytes: totalBytes, totalBytesExpected: totalBytesExpected, fileName: fileName, serverUrl: serverUrl)
+
+        lock.lock()
+        countPosted += 1
+
+        guard lastPercent[key] != percent || percent == 100 else {
+            countFiltered += 1
+            lock.unlock()
+            return
+        }
+        lastPercent[key] = percent
+
+        if pending.updateValue(update, forKey: key) != nil {
+            countMerged += 1
+        }
+        let delay = scheduleIfNeeded()
+        lock.unlock()
+
+        if let delay {
+            flush(after: delay)
+        }
+    }
+
+    /// Clears the state of a finished transfer, its last update is still delivered
+    func clear(serverUrlFileName: String) {
+        lock.lock()
+        lastPercent.removeValue(forKey: serverUrlFileName)
+        lock.unlock()
+    }
+
+    func statistics() -> Statistics {
+        lock.lock()
+        defer { lock.unlock() }
+
+        return Statistics(posted: countPosted, filtered: countFiltered, merged: countMerged, delivered: countDelivered, batches: countBatches)
+    }
+
+    // MARK: -
+
+    // Must be called with lock held, returns the delay of the delivery to schedule
+    private func scheduleIfNeeded() -> TimeInterval? {
+        guard !isScheduled else {
+            return nil
+        }
+        isScheduled = true
+
+        let elapsed = ProcessInfo.processInfo.systemUptime - lastDelivery
+        return max(0, interval - elapsed)
+    }
+
+    private func flush(after delay: TimeInterval) {
+        Task {
+            if delay > 0 {
+                try? await Task.sleep(nanoseconds: UInt64(delay * 1_000_000_000))
+            }
+
+            lock.lock()
+            let updates = Array(pending.values)
+            pending.removeAll(keepingCapacity: true)
+            countDelivered += updates.count
+            countBatches += updates.isEmpty ? 0 : 1
+            lock.unlock()
+
+            if !updates.isEmpty {
+                await deliver(updates)
+            }
+
+            // Updates posted during the delivery go in the next batch
+            lock.lock()
+            lastDelivery = ProcessInfo.processInfo.systemUptime
+            isScheduled = false
+            let delay = pending.isEmpty ? nil : scheduleIfNeeded()
+            lock.unlock()
+
+            if let delay {
+                flush(after: delay)
+            }
+        }
+    }
+}
@@ -0,0 +1,242 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import RealmSwift
+import NextcloudKit
+
+/// In-memory, priority-ordered view of the metadatas waiting for or in transfer.
+///
+/// Realm stays the persistent store (after a crash the queue is rebuilt from it on the first notification):
+/// the queue mirrors `status != normal` sorted as the process pipeline wants it (status descending, then
+/// sessionDate) and is kept current by the collection notifications, so taking the next batch does not query
+/// the table. Only the ocId, status, session and sessionDate of every row are kept; the full rows of a batch
+/// are read when it is about to be dispatched. Every change that puts work in a waiting state calls
+/// `onEnqueue` right away.
+final class NCTransferQueue: @unchecked Sendable {
+    static let shared = NCTransferQueue()
+
+    struct Statistics {
+        let depth: Int
+        let waiting: Int
+        let inProgress: Int
+        let dispatched: Int
+        let averageDispatchLatency: TimeInterval
+        let maxDispatchLatency: TimeInterval
+    }
+
+    /// The columns of a row the queue orders and counts on
+    struct Entry: Equatable {
+        let ocId: String
+        let status: Int
+        let session: String
+        let sessionDate: Date?
+
+        init(_ metadata: tableMetadata) {
+            self.ocId = metadata.ocId
+            self.status = metadata.status
+            self.session = metadata.session
+            self.sessionDate = metadata.sessionDate
+        }
+    }
+
+    /// Called on the queue when metadatas enter a waiting status
+    var onEnqueue: (() -> Void)?
+
+    private let queue = DispatchQueue(label: "com.nextcloud.transferQueue", qos: .utility)
+    private let lock = NSLock()
+    private var notificationToken: NotificationToken?
+    private var isReady = false
+
+    // Mirror of the Realm results, in their order
+    private var ocIds: [String] = []
+    private var entries: [String: Entry] = [:]
+    private var statusCounts: [Int: Int] = [:]
+
+    // Dispatch latency: time from entering a waiting status to the transfer start
+    private var waitingSince: [String: Date] = [:]
+    private var dispatched: Int = 0
+    private var totalDispatchLatency: TimeInterval = 0
+    private var maxDispatchLatency: TimeInterval = 0
+
+    private let global = NCGlobal.shared
+
+    // MARK: -
+
+    /// Starts observing the metadata table; does nothing if already started
+    func start() {
+        queue.async {
+            guard self.notificationToken == nil else {
+                return
+            }
+
+            do {
+                let realm = try Realm(queue: self.queue)
+                let results = realm.objects(tableMetadata.self)
+                    .filter("status != %d", self.global.metadataStatusNormal)
+                    .sorted(by: [RealmSwift.SortDescriptor(keyPath: "status", ascending: false),
+                                 RealmSwift.SortDescriptor(keyPath: "sessionDate", ascending: true)])
+
+                self.notificationToken = results.observe { [weak self] changes in
+                    switch changes {
+                    case .initial(let results):
+                        self?.reset(results)
+                    case .update(let results, let deletions, let insertions, let modifications):
+                        self?.update(results, deletions: deletions, insertions: insertions, modifications: modifications)
+                    case .error(let error):
+                        nkLog(tag: NCGlobal.shared.logTagDatabase, emoji: .error, message: "Transfer queue observation error: \(error)")
+                        self?.stop()
+                    }
+                }
+            } catch {
+                nkLog(tag: NCGlobal.shared.logTagDatabase, emoji: .error, message: "Transfer queue could not open the database: \(error)")
+            }
+        }
+    }
+
+    func stop() {
+        queue.async {
+            self.notificationToken?.invalidate()
+            self.notificationToken = nil
+
+            self.lock.lock()
+            self.isReady = false
+            self.lock.unlock()
+        }
+    }
+
+    /// The first `limit` entries in priority order, the caller reads their rows to dispatch them.
+    /// Nil until the queue has been built, callers then read the database directly.
+    func next(limit: Int) -> [Entry]? {
+        lock.lock()
+        defer { lock.unlock() }
+
+        guard isReady else {
+            return nil
+        }
+
+        return ocIds.prefix(limit).compactMap { entries[$0] }
+    }
+
+    /// Number of metadatas in the given statuses, nil until the queue has been built
+    func count(status: [Int]) -> Int? {
+        lock.lock()
+        defer { lock.unlock() }
+
+        guard isReady else {
+            return nil
+        }
+
+        return status.reduce(0) { $0 + (statusCounts[$1] ?? 0) }
+    }
+
+    func statistics() -> Statistics {
+        lock.lock()
+        defer { lock.unlock() }
+
+        let waiting = global.metadatasStatusInWaiting.reduce(0) { $0 + (statusCounts[$1] ?? 0) }
+        let inProgress = global.metadatasStatusDownloadingUploading.reduce(0) { $0 + (statusCounts[$1] ?? 0) }
+
+        return Statistics(depth: ocIds.count,
+                          waiting: waiting,
+                          inProgress: inProgress,
+                          dispatched: dispatched,
+                          averageDispatchLatency: dispatched > 0 ? totalDispatchLatency / Double(dispatched) : 0,
+                          maxDispatchLatency: maxDispatchLatency)
+    }
+
+    // MARK: - Realm notifications (on queue)
+
+    private func reset(_ results: Results<tableMetadata>) {
+        var entries: [Entry] = []
+        entries.reserveCapacity(results.count)
+
+        for result in results {
+            entries.append(Entry(result))
+        }
+
+        lock.lock()
+        self.ocIds = entries.map { $0.ocId }
+        self.entries = [:]
+        self.statusCounts = [:]
+        self.waitingSince = [:]
+        var enqueued = false
+        for entry in entries {
+            enqueued = set(entry) || enqueued
+        }
+        isReady = true
+        lock.unlock()
+
+        if enqueued {
+            onEnqueue?()
+        }
+    }
+
+    private func update(_ results: Results<tableMetadata>, deletions: [Int], insertions: [Int], modifications: [Int]) {
+        // Read the changed objects before taking the lock: deletions are indices of the previous version,
+        // insertions and modifications of the new one
+        let inserted = insertions.map { (index: $0, entry: Entry(results[$0])) }
+        let modified = modifications.map { Entry(results[$0]) }
+        var enqueued = false
+
+        lock.lock()
+
+        var removed: [String] = []
+        for index in deletions.sorted(by: >) where index < ocIds.count {
+            removed.append(ocIds.remove(at: index))
+        }
+        for item in inserted {
+            ocIds.insert(item.entry.ocId, at: min(item.index, ocIds.count))
+            enqueued = set(item.entry) || enqueued
+        }
+        for entry in modified {
+            enqueued = set(entry) || enqueued
+        }
+        // A status change moves the object in the sorted results: it comes back as a deletion plus an insertion
+        let reinserted = Set(inserted.map { $0.entry.ocId })
+        for ocId in removed where !reinserted.contains(ocId) {
+            remove(ocId: ocId)
+        }
+
+        lock.unlock()
+
+        if enqueued {
+            onEnqueue?()
+        }
+    }
+
+    // Must be called with lock held. Returns true when the entry enters a waiting status
+    private func set(_ entry: Entry) -> Bool {
+        let ocId = entry.ocId
+        let previous = entries[ocId]
+        if let previous {
+            statusCounts[previous.status, default: 1] -= 1
+        }
+        entries[ocId] = entry
+        statusCounts[entry.status, default: 0] += 1
+
+        if global.metadatasStatusInWaiting.contains(entry.status) {
+            if waitingSince[ocId] == nil {
+                waitingSince[ocId] = Date()
+            }
+            return previous.map { !global.metadatasStatusInWaiting.contains($0.status) } ?? true
+        } else if let since = waitingSince.removeValue(forKey: ocId),
+                  global.metadatasStatusDownloadingUploading.contains(entry.status) {
+            let latency = Date().timeIntervalSince(since)
+            dispatched += 1
+            totalDispatchLatency += latency
+            maxDispatchLatency = max(maxDispatchLatency, latency)
+        }
+
+        return false
+    }
+
+    // Must be called with lock held
+    private func remove(ocId: String) {
+        if let previous = entries.removeValue(forKey: ocId) {
+            statusCounts[previous.status, default: 1] -= 1
+        }
+        waitingSince.removeValue(forKey: ocId)
+    }
+}
@@ -71,13 +71,13 @@ class NCOffline: NCCollectionViewCommon {
             predicate = NSPredicate(format: "account == %@ AND ocId IN %@ AND NOT (status IN %@)", session.account, ocIds, global.metadataStatusHideInView)
         }
 
-        let metadatas = await self.database.getMetadatasAsyncDataSource(withServerUrl: self.serverUrl,
-                                                                        withUserId: self.session.userId,
-                                                                        withAccount: self.session.account,
-                                                                        withLayout: self.layoutForView,
-                                                                        withPreficate: predicate)
+        let listing = await self.database.getMetadataListingAsync(withServerUrl: self.serverUrl,
+                                                                  withUserId: self.session.userId,
+                                                                  withAccount: self.session.account,
+                                                                  withLayout: self.layoutForView,
+                                                                  withPreficate: predicate)
 
-        self.dataSource = NCCollectionViewDataSource(metadatas: metadatas,
+        self.dataSource = NCCollectionViewDataSource(listing: listing,
                                                      layoutForView: layoutForView,
                                                      account: session.account)
         await super.reloadDataSource()
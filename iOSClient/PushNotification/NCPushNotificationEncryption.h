@@ -13,11 +13,25 @@
 
 @end
 
+// Device private key parsed once, with prepared RSA decryption contexts and a fixed scratch buffer.
+// Messages are tried with OAEP first, then with PKCS#1 v1.5.
+@interface NCPushDecryptionContext : NSObject
+
+- (instancetype)initWithDevicePrivateKey:(NSData *)privateKey;
+- (NSString *)decryptMessage:(NSString *)message;
+// One entry per message, NSNull when a message cannot be decrypted
+- (NSArray *)decryptMessages:(NSArray<NSString *> *)messages;
+
+@end
+
 @interface NCPushNotificationEncryption : NSObject
 
 + (instancetype)shared;
 - (NCPushKeyPair *)generatePushNotificationsKeyPair;
 - (NSString *)decryptPushNotification:(NSString *)message withDevicePrivateKey:(NSData *)privateKey;
+- (NSArray *)decryptPushNotifications:(NSArray<NSString *> *)messages withDevicePrivateKey:(NSData *)privateKey;
+// Context cached for the life of the process (nil if the key cannot be parsed)
+- (NCPushDecryptionContext *)decryptionContextWithDevicePrivateKey:(NSData *)privateKey;
 - (NSString *)stringWithDeviceToken:(NSData *)deviceToken;
 
 @end
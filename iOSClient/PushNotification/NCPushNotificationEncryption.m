@@ -7,9 +7,12 @@
 #import <OpenSSL/OpenSSL.h>
 #import <CommonCrypto/CommonDigest.h>
 #import "NCEndToEndEncryption.h"
+#import <os/lock.h>
 
 #pragma clang diagnostic ignored "-Wdeprecated-declarations"
 
+#define PUSH_CONTEXT_CACHE_LIMIT    8
+
 @implementation NCPushKeyPair
 
 - (instancetype)initWithPublicKey:(NSData *)publicKey privateKey:(NSData *)privateKey {
@@ -23,7 +26,133 @@
 
 @end
 
+@implementation NCPushDecryptionContext
+{
+    EVP_PKEY *_pkey;
+    EVP_PKEY_CTX *_oaepCtx;
+    EVP_PKEY_CTX *_pkcs1Ctx;
+    unsigned char *_scratch;
+    size_t _scratchLength;
+    os_unfair_lock _lock;
+}
+
+- (instancetype)initWithDevicePrivateKey:(NSData *)privateKey
+{
+    self = [super init];
+    if (!self || privateKey.length == 0) {
+        return nil;
+    }
+
+    _lock = OS_UNFAIR_LOCK_INIT;
+
+    BIO *bio = BIO_new_mem_buf(privateKey.bytes, (int)privateKey.length);
+    if (bio) {
+        _pkey = PEM_read_bio_PrivateKey(bio, NULL, NULL, NULL);
+        BIO_free(bio);
+    }
+    if (!_pkey) {
+        return nil;
+    }
+
+    _oaepCtx = [self decryptionContextWithPadding:RSA_PKCS1_OAEP_PADDING];
+    _pkcs1Ctx = [self decryptionContextWithPadding:RSA_PKCS1_PADDING];
+
+    // OpenSSL 3.2+ answers an invalid PKCS#1 v1.5 ciphertext with a synthetic plaintext (implicit rejection):
+    // a message that is not v1.5 must fail here, not decrypt to random bytes
+    if (_pkcs1Ctx && EVP_PKEY_CTX_ctrl_str(_pkcs1Ctx, "rsa_pkcs1_implicit_rejection", "0") <= 0) {
+        ERR_clear_error();
+    }
+
+    // The plaintext of an RSA decryption is never longer than the modulus
+    _scratchLength = (size_t)EVP_PKEY_size(_pkey);
+    _scratch = malloc(_scratchLength);
+
+    if (!_oaepCtx || !_pkcs1Ctx || !_scratch) {
+        return nil;
+    }
+
+    return self;
+}
+
+- (void)dealloc
+{
+    if (_oaepCtx) EVP_PKEY_CTX_free(_oaepCtx);
+    if (_pkcs1Ctx) EVP_PKEY_CTX_free(_pkcs1Ctx);
+    if (_pkey) EVP_PKEY_free(_pkey);
+    if (_scratch) {
+        OPENSSL_cleanse(_scratch, _scratchLength);
+        free(_scratch);
+    }
+}
+
+- (EVP_PKEY_CTX *)decryptionContextWithPadding:(int)padding
+{
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(_pkey, NULL);
+    if (!ctx) {
+        return NULL;
+    }
+    if (EVP_PKEY_decrypt_init(ctx) <= 0 || EVP_PKEY_CTX_set_rsa_padding(ctx, padding) <= 0) {
+        EVP_PKEY_CTX_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+// Must be called with _lock held: the contexts and the scratch buffer are shared
+- (NSString *)decryptData:(NSData *)data padding:(int)padding
+{
+    size_t length = _scratchLength;
+    EVP_PKEY_CTX *ctx = padding == RSA_PKCS1_OAEP_PADDING ? _oaepCtx : _pkcs1Ctx;
+
+    if (EVP_PKEY_decrypt(ctx, _scratch, &length, data.bytes, data.length) <= 0) {
+        ERR_clear_error();
+        return nil;
+    }
+
+    NSString *decryptString = [[NSString alloc] initWithBytes:_scratch length:length encoding:NSUTF8StringEncoding];
+    OPENSSL_cleanse(_scratch, length);
+
+    return decryptString;
+}
+
+- (NSString *)decryptMessage:(NSString *)message
+{
+    NSData *decodedData = message ? [[NSData alloc] initWithBase64EncodedString:message options:0] : nil;
+    if (decodedData.length == 0) {
+        return nil;
+    }
+
+    os_unfair_lock_lock(&_lock);
+
+    // OAEP first, it fails reliably on a v1.5 message
+    NSString *decryptString = [self decryptData:decodedData padding:RSA_PKCS1_OAEP_PADDING];
+    if (decryptString == nil) {
+        decryptString = [self decryptData:decodedData padding:RSA_PKCS1_PADDING];
+    }
+
+    os_unfair_lock_unlock(&_lock);
+
+    return decryptString;
+}
+
+- (NSArray *)decryptMessages:(NSArray<NSString *> *)messages
+{
+    NSMutableArray *results = [NSMutableArray arrayWithCapacity:messages.count];
+
+    for (NSString *message in messages) {
+        NSString *decryptString = [self decryptMessage:message];
+        [results addObject:decryptString ?: [NSNull null]];
+    }
+
+    return results;
+}
+
+@end
+
 @implementation NCPushNotificationEncryption
+{
+    NSMutableDictionary<NSData *, NCPushDecryptionContext *> *_decryptionContexts;
+}
 
 //Singleton
 + (instancetype)shared {
@@ -35,6 +164,15 @@
     return shared;
 }
 
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _decryptionContexts = [NSMutableDictionary new];
+    }
+    return self;
+}
+
 - (NCPushKeyPair *)generatePushNotificationsKeyPair
 {
     EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
@@ -89,51 +227,51 @@
     return [[NCPushKeyPair alloc] initWithPublicKey:publicKey privateKey:privateKey];
 }
 
-- (NSString *)decryptPushNotification:(NSString *)message withDevicePrivateKey:(NSData *)privateKey
+- (NCPushDecryptionContext *)decryptionContextWithDevicePrivateKey:(NSData *)privateKey
 {
-    if (message == nil || privateKey == nil) { return nil; }
-    
-    NSString *privateKeyString = [[NSString alloc] initWithData:privateKey encoding:NSUTF8StringEncoding];
-    NSData *decodedData = [[NSData alloc] initWithBase64EncodedString:message options:0];
-    char *privKey = (char *)[privateKeyString UTF8String];
-    
-    // Get Device Private Key from PEM
-    BIO *bio = BIO_new(BIO_s_mem());
-    BIO_write(bio, privKey, (int)strlen(privKey));
-    
-    EVP_PKEY *pkey = 0;
-    PEM_read_bio_PrivateKey(bio, &pkey, 0, 0);
+    if (privateKey == nil) { return nil; }
 
-    RSA *rsa = EVP_PKEY_get1_RSA(pkey);
+    @synchronized (_decryptionContexts) {
+        NCPushDecryptionContext *context = _decryptionContexts[privateKey];
+        if (context) {
+            return context;
+        }
 
-    // Decrypt the message
-    unsigned char *decrypted = (unsigned char *) malloc(4096);
+        context = [[NCPushDecryptionContext alloc] initWithDevicePrivateKey:privateKey];
+        if (context == nil) {
+            NSLog(@"Push notification private key could not be parsed");
+            return nil;
+        }
 
-    // Try decrypting with RSA OAEP padding
-    int decrypted_length = RSA_private_decrypt((int)[decodedData length], [decodedData bytes], decrypted, rsa, RSA_PKCS1_OAEP_PADDING);
-    NSString *decryptString = decrypted_length == -1 ? nil : [[NSString alloc] initWithBytes:decrypted length:decrypted_length encoding:NSUTF8StringEncoding];
+        // One key per account: the limit only matters after keys have been regenerated
+        if (_decryptionContexts.count >= PUSH_CONTEXT_CACHE_LIMIT) {
+            [_decryptionContexts removeAllObjects];
+        }
+        _decryptionContexts[[privateKey copy]] = context;
 
-    // Try decrypting with RSA PKCS#1 v1.5 padding
-    if(decrypted_length == -1 || decryptString == nil) {
-        ERR_clear_error();
-        decrypted_length = RSA_private_decrypt((int)[decodedData length], [decodedData bytes], decrypted, rsa, RSA_PKCS1_PADDING);
-        decryptString = decrypted_length == -1 ? nil : [[NSString alloc] initWithBytes:decrypted length:decrypted_length encoding:NSUTF8StringEncoding];
+        return context;
     }
+}
 
-    // Could not decrypt
-    if(decrypted_length == -1 || decryptString == nil) {
-        char buffer[500];
-        ERR_error_string(ERR_get_error(), buffer);
-        NSLog(@"%@",[NSString stringWithUTF8String:buffer]);
-        return nil;
+- (NSString *)decryptPushNotification:(NSString *)message withDevicePrivateKey:(NSData *)privateKey
+{
+    if (message == nil || privateKey == nil) { return nil; }
+
+    return [[self decryptionContextWithDevicePrivateKey:privateKey] decryptMessage:message];
+}
+
+- (NSArray *)decryptPushNotifications:(NSArray<NSString *> *)messages withDevicePrivateKey:(NSData *)privateKey
+{
+    NCPushDecryptionContext *context = [self decryptionContextWithDevicePrivateKey:privateKey];
+    if (context == nil) {
+        NSMutableArray *results = [NSMutableArray arrayWithCapacity:messages.count];
+        for (NSUInteger i = 0; i < messages.count; i++) {
+            [results addObject:[NSNull null]];
+        }
+        return results;
     }
-    
-    if (decrypted)
-        free(decrypted);
-    free(bio);
-    free(rsa);
-    
-    return decryptString;
+
+    return [context decryptMessages:messages];
 }
 
 - (NSString *)stringWithDeviceToken:(NSData *)deviceToken
@@ -553,7 +553,7 @@ class SceneDelegate: UIResponder, UIWindowSceneDelegate {
             await NCService().startRequestServicesServer(account: account, controller: controller)
 
             try? await Task.sleep(for: .seconds(2))
-            await NCNetworking.shared.verifyZombie()
+            await NCNetworking.shared.recoverTransfers()
         }
 
         NotificationCenter.default.postOnMainThread(name: global.notificationCenterRichdocumentGrabFocus)
@@ -55,6 +55,7 @@ class NCEndToEndSetup {
     func start() async throws {
         // Clear all keys
         preference.clearAllKeysEndToEnd(account: session.account)
+        NCEndToEndEncryption.shared().invalidateKeyCache()
         // get version E2EE
         let capabilities = await NKCapabilities.shared.getCapabilities(for: session.account)
         options = networkingE2EE.getOptions(account: session.account, capabilities: capabilities)
@@ -156,7 +157,7 @@ class NCEndToEndSetup {
 
             let passphrase = try await requestPassphraseAsync()
 
-            guard let privateKeyData = endToEndEncryption?.decryptPrivateKey(privateKeyCipher, passphrase: passphrase),
+            guard let privateKeyData = try await endToEndEncryption?.decryptPrivateKeyAsync(privateKeyCipher, passphrase: passphrase),
                   let keyData = Data(base64Encoded: privateKeyData),
                   let privateKey = String(data: keyData, encoding: .utf8)
             else {
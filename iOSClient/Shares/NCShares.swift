@@ -134,7 +134,7 @@ class NCShares: NCCollectionViewCommon {
             Task {
                 await self.stopGUIGetServerData()
                 await self.reloadDataSource()
-                await self.startSyncMetadata(metadatas: self.dataSource.getMetadatas())
+                await self.startSyncMetadata(metadatas: self.dataSource.getDirectoryMetadatas())
             }
         }
     }
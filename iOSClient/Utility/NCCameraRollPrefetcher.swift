@@ -0,0 +1,214 @@
+// SPDX-FileCopyrightText: Nextcloud GmbH
+// SPDX-FileCopyrightText: 2026 Marino Faggiana
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import Foundation
+import NextcloudKit
+
+/// Extracts camera roll assets ahead of the upload loop.
+///
+/// A producer extracts the metadatas in order while the consumer checks and hands the previous ones to the
+/// upload session, so exporting a HEIC or a video no longer holds the next upload. At most `lookahead`
+/// extracted items wait for the consumer, and no more than `diskBudget` bytes of extracted files (at least
+/// one item). Cancelling the task calling `next()` (BGTask expiration) or calling `cancel()` stops the
+/// producer after the extraction in progress; items already extracted keep their state and are picked up
+/// by the next run.
+final class NCCameraRollPrefetcher: @unchecked Sendable {
+    struct Item {
+        let metadata: tableMetadata
+        let extracted: [tableMetadata]
+        let bytes: Int64
+    }
+
+    struct Report {
+        let items: Int
+        let extractionTime: TimeInterval
+        /// Time the consumer waited for an extraction
+        let stallTime: TimeInterval
+        let elapsed: TimeInterval
+
+        /// Extraction time hidden behind the consumer work
+        var overlap: TimeInterval {
+            max(0, extractionTime - stallTime)
+        }
+
+        var description: String {
+            let percent = extractionTime > 0 ? Int(overlap / extractionTime * 100) : 0
+            return "\(items) items in \(String(format: "%.2f", elapsed)) s, extraction \(String(format: "%.2f", extractionTime)) s, overlapped with uploads \(String(format: "%.2f", overlap)) s (\(percent)%)"
+        }
+    }
+
+    private let metadatas: [tableMetadata]
+    private let extractor: CameraRollExtractor
+    private let lookahead: Int
+    private let diskBudget: Int64
+
+    private let lock = NSLock()
+    private var buffer: [Item] = []
+    private var bufferedBytes: Int64 = 0
+    private var isFinished = false
+    private var isCancelled = false
+    private var consumer: CheckedContinuation<Item?, Never>?
+    private var producer: CheckedContinuation<Void, Never>?
+    private var task: Task<Void, Never>?
+
+    private let start = Date()
+    private var items = 0
+    private var extractionTime: TimeInterval = 0
+    private var stallTime: TimeInterval = 0
+
+    init(metadatas: [tableMetadata],
+         extractor: CameraRollExtractor = NCCameraRoll(),
+         lookahead: Int = 3,
+         diskBudget: Int64 = 512 * 1024 * 1024) {
+        self.metadatas = metadatas
+        self.extractor = extractor
+        self.lookahead = max(1, lookahead)
+        self.diskBudget = diskBudget
+    }
+
+    deinit {
+        task?.cancel()
+    }
+
+    // MARK: -
+
+    /// The next metadata with its extracted metadatas, in the original order; nil when all have been
+    /// extracted or the prefetch has been cancelled
+    func next() async -> Item? {
+        startIfNeeded()
+        let date = Date()
+
+        let item = await withTaskCancellationHandler {
+            await withCheckedContinuation { (continuation: CheckedContinuation<Item?, Never>) in
+                lock.lock()
+                if isCancelled {
+                    lock.unlock()
+                    continuation.resume(returning: nil)
+                } else if !buffer.isEmpty {
+                    let item = take()
+                    let producer = self.producer
+                    self.producer = nil
+                    lock.unlock()
+                    producer?.resume()
+                    continuation.resume(returning: item)
+                } else if isFinished {
+                    lock.unlock()
+                    continuation.resume(returning: nil)
+                } else {
+                    consumer = continuation
+                    lock.unlock()
+                }
+            }
+        } onCancel: {
+            cancel()
+        }
+
+        lock.lock()
+        stallTime += Date().timeIntervalSince(date)
+        lock.unlock()
+
+        return item
+    }
+
+    func cancel() {
+        lock.lock()
+        isCancelled = true
+        let consumer = self.consumer
+        let producer = self.producer
+        let task = self.task
+        self.consumer = nil
+        self.producer = nil
+        lock.unlock()
+
+        consumer?.resume(returning: nil)
+        producer?.resume()
+        task?.cancel()
+    }
+
+    func report() -> Report {
+        lock.lock()
+        defer { lock.unlock() }
+
+        return Report(items: items, extractionTime: extractionTime, stallTime: stallTime, elapsed: Date().timeIntervalSince(start))
+    }
+
+    // MARK: -
+
+    private func startIfNeeded() {
+        lock.lock()
+        defer { lock.unlock() }
+
+        guard task == nil else {
+            return
+        }
+
+        task = Task { [metadatas, extractor] in
+            for metadata in metadatas {
+                await self.waitForRoom()
+                guard !self.cancelled, !Task.isCancelled else {
+                    break
+                }
+
+                let date = Date()
+                let extracted = await extractor.extractCameraRoll(from: metadata)
+                let item = Item(metadata: metadata, extracted: extracted, bytes: extracted.reduce(0) { $0 + $1.size })
+
+                self.push(item, duration: Date().timeIntervalSince(date))
+            }
+            self.finish()
+        }
+    }
+
+    private var cancelled: Bool {
+        lock.lock()
+        defer { lock.unlock() }
+        return isCancelled
+    }
+
+    private func waitForRoom() async {
+        await withCheckedContinuation { (continuation: CheckedContinuation<Void, Never>) in
+            lock.lock()
+            if isCancelled || buffer.isEmpty || (buffer.count < lookahead && bufferedBytes < diskBudget) {
+                lock.unlock()
+                continuation.resume()
+            } else {
+                producer = continuation
+                lock.unlock()
+            }
+        }
+    }
+
+    private func push(_ item: Item, duration: TimeInterval) {
+        lock.lock()
+        items += 1
+        extractionTime += duration
+
+        if let consumer {
+            self.consumer = nil
+            lock.unlock()
+            consumer.resume(returning: item)
+        } else {
+            buffer.append(item)
+            bufferedBytes += item.bytes
+            lock.unlock()
+        }
+    }
+
+    private func finish() {
+        lock.lock()
+        isFinished = true
+        let consumer = self.consumer
+        self.consumer = nil
+        lock.unlock()
+
+        consumer?.resume(returning: nil)
+    }
+
+    // Must be called with lock held
+    private func take() -> Item {
+        let item = buffer.removeFirst()
+        bufferedBytes -= item.bytes
+        return item
+    }
+}
@@ -63,6 +63,34 @@
  */
 + (NSString *)generateMnemonicString:(NSNumber *)strength
                             language:(NSString *)language;
+
+/**
+ Creates a mnemonic code from raw entropy.
+
+ @param entropy The random seed. Should be between 128-256 bits and divisible by 32
+ @param language The language file to use. Currently the only value is 'english'
+
+ @return a string containing the mnemonic code, nil if the entropy length or the wordlist is invalid
+ */
++ (NSString *)mnemonicStringFromEntropy:(NSData *)entropy
+                               language:(NSString *)language NS_SWIFT_NAME(mnemonicString(fromEntropy:language:));
+
+/**
+ Recovers the entropy of a mnemonic code, checking words and checksum.
+
+ @param mnemonic The mnemonic code, words separated by whitespace
+ @param language The language file to use. Currently the only value is 'english'
+
+ @return the entropy, nil if a word is unknown, the word count is wrong or the checksum does not match
+ */
++ (NSData *)entropyFromMnemonicString:(NSString *)mnemonic
+                             language:(NSString *)language NS_SWIFT_NAME(entropy(fromMnemonic:language:));
+
+/**
+ @return YES if the mnemonic code has known words and a valid checksum
+ */
++ (BOOL)isValidMnemonicString:(NSString *)mnemonic
+                     language:(NSString *)language NS_SWIFT_NAME(isValidMnemonic(_:language:));
 @end
 
 /**
@@ -21,42 +21,164 @@
 // THE SOFTWARE.
 #import "NYMnemonic.h"
 
+// BIP-39: every word carries 11 bits, the checksum is the first (entropy bits / 32) bits of SHA-256
+#define NY_WORDLIST_COUNT   2048
+#define NY_WORD_BITS        11
+#define NY_ENTROPY_MIN      16
+#define NY_ENTROPY_MAX      32
+
+/**
+ A wordlist loaded once per language: words by index and a hashed word -> index lookup.
+ */
+@interface NYMnemonicWordlist : NSObject
+@property (nonatomic, strong, readonly) NSArray<NSString *> *words;
+@property (nonatomic, strong, readonly) NSDictionary<NSString *, NSNumber *> *indexes;
+@end
+
+@implementation NYMnemonicWordlist
+
++ (instancetype)wordlistForLanguage:(NSString *)language {
+    static NSMutableDictionary<NSString *, NYMnemonicWordlist *> *wordlists;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        wordlists = [NSMutableDictionary new];
+    });
+
+    @synchronized (wordlists) {
+        NYMnemonicWordlist *wordlist = wordlists[language];
+        if (!wordlist) {
+            wordlist = [[NYMnemonicWordlist alloc] initWithLanguage:language];
+            if (wordlist) {
+                wordlists[language] = wordlist;
+            }
+        }
+        return wordlist;
+    }
+}
+
+- (instancetype)initWithLanguage:(NSString *)language {
+    NSString *path = [NSString stringWithFormat:@"%@/%@.txt", [[NSBundle mainBundle] bundlePath], language];
+    NSString *fileText = [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:NULL];
+    if (!fileText) {
+        return nil;
+    }
+
+    NSMutableArray<NSString *> *words = [NSMutableArray arrayWithCapacity:NY_WORDLIST_COUNT];
+    NSMutableDictionary<NSString *, NSNumber *> *indexes = [NSMutableDictionary dictionaryWithCapacity:NY_WORDLIST_COUNT];
+    for (NSString *line in [fileText componentsSeparatedByCharactersInSet:[NSCharacterSet newlineCharacterSet]]) {
+        if (line.length == 0) {
+            continue;
+        }
+        indexes[line] = @(words.count);
+        [words addObject:line];
+    }
+    if (words.count != NY_WORDLIST_COUNT) {
+        return nil;
+    }
+
+    self = [super init];
+    if (self) {
+        _words = [words copy];
+        _indexes = [indexes copy];
+    }
+    return self;
+}
+
+@end
+
 @implementation NYMnemonic
 + (NSString *)mnemonicStringFromRandomHexString:(NSString *)seed language:(NSString *)language {
+    return [self mnemonicStringFromEntropy:[seed ny_dataFromHexString] language:language];
+}
 
-    // Convert our hex string to NSData
-    NSData *seedData = [seed ny_dataFromHexString];
++ (NSString *)mnemonicStringFromEntropy:(NSData *)entropy language:(NSString *)language {
+    NSUInteger length = entropy.length;
+    if (length < NY_ENTROPY_MIN || length > NY_ENTROPY_MAX || length % 4 != 0) {
+        return nil;
+    }
+
+    NYMnemonicWordlist *wordlist = [NYMnemonicWordlist wordlistForLanguage:language];
+    if (!wordlist) {
+        return nil;
+    }
 
-    // Calculate the sha256 hash to use with a checksum
-    NSMutableData *hash = [NSMutableData dataWithLength:CC_SHA256_DIGEST_LENGTH];
-    CC_SHA256(seedData.bytes, (int)seedData.length, hash.mutableBytes);
+    // Entropy followed by the first byte of its hash: at most 8 checksum bits are ever needed
+    unsigned char bits[NY_ENTROPY_MAX + 1];
+    unsigned char hash[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256(entropy.bytes, (CC_LONG)length, hash);
+    memcpy(bits, entropy.bytes, length);
+    bits[length] = hash[0];
+
+    // Read 11 bits at a time through a small accumulator
+    NSUInteger wordCount = (length * 8 + length / 4) / NY_WORD_BITS;
+    NSMutableArray<NSString *> *words = [NSMutableArray arrayWithCapacity:wordCount];
+    uint32_t accumulator = 0;
+    int available = 0;
+    NSUInteger byte = 0;
+    for (NSUInteger i = 0; i < wordCount; i++) {
+        while (available < NY_WORD_BITS) {
+            accumulator = (accumulator << 8) | bits[byte++];
+            available += 8;
+        }
+        available -= NY_WORD_BITS;
+        [words addObject:wordlist.words[(accumulator >> available) & (NY_WORDLIST_COUNT - 1)]];
+    }
 
-    NSMutableArray *checksumBits = [NSMutableArray
-      arrayWithArray:[[NSData dataWithData:hash] ny_hexToBitArray]];
-    NSMutableArray *seedBits =
-      [NSMutableArray arrayWithArray:[seedData ny_hexToBitArray]];
+    memset(bits, 0, sizeof(bits));
+    return [words componentsJoinedByString:@" "];
+}
 
-    // Append the appropriate checksum bits to the seed
-    for (int i = 0; i < (int)seedBits.count / 32; i++) {
-        [seedBits addObject: checksumBits[i]];
++ (NSData *)entropyFromMnemonicString:(NSString *)mnemonic language:(NSString *)language {
+    NYMnemonicWordlist *wordlist = [NYMnemonicWordlist wordlistForLanguage:language];
+    if (!wordlist || !mnemonic) {
+        return nil;
     }
-    NSString *path = [NSString stringWithFormat:@"%@/%@.txt", [[NSBundle mainBundle] bundlePath], language];
-    NSString *fileText = [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:NULL];
-    NSArray *lines = [fileText componentsSeparatedByCharactersInSet: [NSCharacterSet newlineCharacterSet]];
 
-    // Split into groups of 11, and change to numbers
-    NSMutableArray *words = [NSMutableArray arrayWithCapacity:(int)seedBits.count / 11];
-    for (int i = 0; i < (int)seedBits.count / 11; i++) {
-        NSUInteger wordNumber =
-            strtol(
-                [[[seedBits subarrayWithRange: NSMakeRange(i * 11, 11)] componentsJoinedByString: @""] UTF8String],
-                NULL,
-                2);
+    NSArray<NSString *> *words = [[mnemonic lowercaseString] componentsSeparatedByCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+    words = [words filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"length > 0"]];
 
-        [words addObject: lines[wordNumber]];
+    // 12, 15, 18, 21 or 24 words
+    NSUInteger totalBits = words.count * NY_WORD_BITS;
+    NSUInteger length = (totalBits - totalBits / 33) / 8;
+    if (words.count % 3 != 0 || length < NY_ENTROPY_MIN || length > NY_ENTROPY_MAX) {
+        return nil;
     }
 
-    return [words componentsJoinedByString:@" "];
+    unsigned char bits[NY_ENTROPY_MAX + 1] = { 0 };
+    uint32_t accumulator = 0;
+    int available = 0;
+    NSUInteger byte = 0;
+    for (NSString *word in words) {
+        NSNumber *index = wordlist.indexes[word];
+        if (!index) {
+            return nil;
+        }
+        accumulator = (accumulator << NY_WORD_BITS) | index.unsignedIntValue;
+        available += NY_WORD_BITS;
+        while (available >= 8) {
+            available -= 8;
+            bits[byte++] = (unsigned char)(accumulator >> available);
+        }
+    }
+
+    // Whatever is left is the tail of the checksum, shift it to the top of the last byte
+    if (available > 0) {
+        bits[byte] = (unsigned char)(accumulator << (8 - available));
+    }
+
+    unsigned char hash[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256(bits, (CC_LONG)length, hash);
+    int checksumBits = (int)(length / 4);
+    unsigned char mask = (unsigned char)(0xff << (8 - checksumBits));
+    BOOL valid = (hash[0] & mask) == (bits[length] & mask);
+
+    NSData *entropy = valid ? [NSData dataWithBytes:bits length:length] : nil;
+    memset(bits, 0, sizeof(bits));
+    return entropy;
+}
+
++ (BOOL)isValidMnemonicString:(NSString *)mnemonic language:(NSString *)language {
+    return [self entropyFromMnemonicString:mnemonic language:language] != nil;
 }
 
 + (NSString *)deterministicSeedStringFromMnemonicString:(NSString *)mnemonic
@@ -98,8 +220,8 @@
     // Generate the random data
     int status = SecRandomCopyBytes(kSecRandomDefault, bytes.length, bytes.mutableBytes);
     // Make sure we were successful
-    if (status != -1) {
-        return [self mnemonicStringFromRandomHexString:[bytes ny_hexString] language:language];
+    if (status == errSecSuccess) {
+        return [self mnemonicStringFromEntropy:bytes language:language];
     } else {
         [NSException raise:@"Unable to get random data!"
                     format:@"Unable to get random data!"];